@@ -10,5 +10,9 @@
 
 GRAPPA_DEFINE_METRIC(SummarizingMetric<double>, iteration_time, 0);
 GRAPPA_DEFINE_METRIC(SummarizingMetric<int>, core_set_size, 0);
+GRAPPA_DEFINE_METRIC(SimpleMetric<int64_t>, async_updates, 0);
+GRAPPA_DEFINE_METRIC(SimpleMetric<int64_t>, async_scatters, 0);
 
 DEFINE_int32(max_iterations, 1024, "Stop after this many iterations, no matter what.");
+DEFINE_bool(async_priority, false, "Asynchronous engine runs scheduled vertices in order of their program's priority() rather than FIFO.");
+DEFINE_int32(async_tasks, 64, "Tasks per core draining the asynchronous engine's vertex queue.");
@@ -40,6 +40,7 @@
 #include <unordered_map>
 #include <vector>
 #include <numeric>
+#include <queue>
 using std::unordered_set;
 using std::unordered_map;
 using std::vector;
@@ -51,8 +52,12 @@ using delegate::call;
 static const Core INVALID = -1;
 
 GRAPPA_DECLARE_METRIC(SummarizingMetric<double>, iteration_time);
+GRAPPA_DECLARE_METRIC(SimpleMetric<int64_t>, async_updates);
+GRAPPA_DECLARE_METRIC(SimpleMetric<int64_t>, async_scatters);
 
 DECLARE_int32(max_iterations);
+DECLARE_bool(async_priority);
+DECLARE_int32(async_tasks);
 
 
 /////////////////////////////////////////////////////////
@@ -94,6 +99,10 @@ struct GraphlabVertexProgram {
 
   void post_delta(GatherType d) { cache += d; }
   void reset() { cache = GatherType(); }
+  
+  /// Scheduling priority for the asynchronous engine (higher runs first),
+  /// evaluated when the vertex is scheduled. Only used with --async_priority.
+  double priority(const Vertex& v) const { return 0.0; }
 };
 
 #include "graphlab_naive.hpp"
@@ -39,12 +39,27 @@
 template< typename Subclass >
 struct GraphlabVertexData {
   static Reducer<int64_t,ReducerType::Add> total_active;
-
+  
+  /// Vertices on this core activated since the engine last drained the list.
+  /// May hold entries that were deactivated again; the engine skips those.
+  static std::vector<GraphlabVertexData*> active_list;
+  /// Whether activate() adds to active_list (the asynchronous engine tracks
+  /// activations with 'scheduled' instead).
+  static bool list_activations;
+  
   void* prog;
-  bool active, active_minor_step;
+  void* vertex; // Graph vertex holding this data (set by the engine)
+  bool active;
+  bool scheduled; // queued to run in the asynchronous engine
 
-  GraphlabVertexData(): active(false) {}
-  void activate() { if (!active) { total_active++; active = true; } }
+  GraphlabVertexData(): vertex(nullptr), active(false), scheduled(false) {}
+  void activate() {
+    if (!active) {
+      total_active++;
+      active = true;
+      if (list_activations) active_list.push_back(this);
+    }
+  }
   void deactivate() { if (active) { total_active--; active = false; } }
 };
 
@@ -52,6 +67,12 @@ struct GraphlabVertexData {
 template< typename Subclass >
 Reducer<int64_t,ReducerType::Add> GraphlabVertexData<Subclass>::total_active;
 
+template< typename Subclass >
+std::vector<GraphlabVertexData<Subclass>*> GraphlabVertexData<Subclass>::active_list;
+
+template< typename Subclass >
+bool GraphlabVertexData<Subclass>::list_activations = true;
+
 /// Activate all vertices (for NaiveGraphlabEngine)
 template< typename V, typename E >
 void activate_all(GlobalAddress<Graph<V,E>> g) {
@@ -77,7 +98,19 @@ void activate(GlobalAddress<V> v) {
 /// - If the graph was constructed as "undirected", then both bools above
 ///   instead indicate ALL_EDGES | NONE.
 /// - Delta caching is assumed to be *enabled* (if you have no Gather type,
-///   this won't bother you)
+///   this won't bother you): gather runs once at startup and afterwards
+///   apply only sees the deltas posted by neighbors' scatters
+/// 
+/// Each iteration only visits vertices on the per-core active lists
+/// (see GraphlabVertexData::active_list), so cost is proportional to the
+/// active set rather than the whole graph.
+/// 
+/// `run_async` drops the iterations altogether: a vertex is queued on its
+/// core as soon as a neighbor's scatter activates it, and a few tasks per
+/// core drain the queue (FIFO, or by VertexProg::priority() with
+/// --async_priority). The only global synchronization is a
+/// GlobalCompletionEvent detecting that no vertex is queued or running and
+/// no scatter is in flight.
 /// 
 /// A couple additional caveats:
 /// - only one Engine can be executed at a time in the system
@@ -95,6 +128,32 @@ struct NaiveGraphlabEngine {
   static GlobalAddress<G> g;
   static Reducer<int64_t,ReducerType::Add> ct;
   
+  /// vertices on this core that were applied this iteration and must scatter
+  /// (or, in the asynchronous engine, were initially active)
+  static std::vector<Vertex*> scatter_list;
+  
+  /// Queued vertex for the asynchronous engine. Carries the completion owed
+  /// to the core whose scatter queued it.
+  struct AsyncEntry {
+    double priority;
+    int64_t seq;
+    Vertex* v;
+    Core origin;
+    bool operator<(const AsyncEntry& o) const {
+      return priority < o.priority || (priority == o.priority && seq > o.seq);
+    }
+  };
+  
+  /// per-core state of the asynchronous engine
+  struct AsyncState {
+    std::priority_queue<AsyncEntry> queue;
+    int64_t seq;
+    int tasks; // draining tasks running
+    AsyncState(): seq(0), tasks(0) {}
+  };
+  static AsyncState async_state;
+  static GlobalCompletionEvent async_gce;
+  
   static VertexProg& prog(Vertex& v) {
     return *static_cast<VertexProg*>(v->prog);
   }
@@ -119,18 +178,92 @@ struct NaiveGraphlabEngine {
     });
   }
   
-  /// Run synchronous engine, assumes:
-  /// - Delta caching enabled
-  /// - gather_edges:IN_EDGES, scatter_edges:(OUT_EDGES || NONE)
-  template< typename V, typename E >
-  static void run_sync(GlobalAddress<Graph<V,E>> _g) {
+  /// Queue a local vertex to run; may be called from a message handler.
+  static void async_schedule(Vertex& v, Core origin) {
+    v->scheduled = true;
+    auto pri = FLAGS_async_priority ? prog(v).priority(v) : 0.0;
+    async_state.queue.push(AsyncEntry{ pri, async_state.seq++, &v, origin });
+    if (async_state.tasks < FLAGS_async_tasks) {
+      async_state.tasks++;
+      spawn([]{ async_drain(); });
+    }
+  }
+  
+  /// Called on the target's core after a scatter posted its delta: queue the
+  /// target if the scatter activated it, handing it the scatter's completion.
+  static void async_signal(Vertex& ve, Core origin) {
+    if (ve->active && !ve->scheduled) {
+      async_schedule(ve, origin);
+    } else {
+      async_gce.send_completion(origin);
+    }
+  }
+  
+  static void _do_scatter_async(const VertexProg& prog_copy, Edge& e,
+                  Gather (VertexProg::*f)(Vertex&) const) {
+    auto origin = mycore();
+    async_gce.enroll();
+    call<async,nullptr>(e.ga, [=](Vertex& ve){
+      auto gather_delta = prog_copy.scatter(ve);
+      prog(ve).post_delta(gather_delta);
+      async_signal(ve, origin);
+    });
+  }
+  
+  static void _do_scatter_async(const VertexProg& prog_copy, Edge& e,
+                  Gather (VertexProg::*f)(const Edge&, Vertex&) const) {
+    auto e_id = e.id;
+    auto e_data = e.data;
+    auto origin = mycore();
+    async_gce.enroll();
+    call<async,nullptr>(e.ga, [=](Vertex& ve){
+      auto local_e_data = e_data;
+      Edge e = { e_id, g->vs+e_id, local_e_data };
+      auto gather_delta = prog_copy.scatter(e, ve);
+      prog(ve).post_delta(gather_delta);
+      async_signal(ve, origin);
+    });
+  }
+  
+  /// Apply a local vertex and scatter along its out-edges.
+  static void async_update(Vertex& v) {
+    v->deactivate();
+    auto& p = prog(v);
+    p.apply(v, p.cache);
+    async_updates++;
     
+    if (!p.scatter_edges(v)) return;
+    // the vertex may be queued and applied again while this scatters
+    auto prog_copy = p;
+    for (int64_t i = 0; i < v.nadj; i++) {
+      auto e = g->edge(v, i);
+      _do_scatter_async(prog_copy, e, &VertexProg::scatter);
+    }
+    async_scatters += v.nadj;
+  }
+  
+  static void async_drain() {
+    while (!async_state.queue.empty()) {
+      auto e = async_state.queue.top();
+      async_state.queue.pop();
+      auto& v = *e.v;
+      v->scheduled = false;
+      if (v->active) async_update(v);
+      async_gce.send_completion(e.origin);
+    }
+    async_state.tasks--;
+  }
+  
+  /// Set up vertex programs and do the initial gather (shared by both engines).
+  template< typename V, typename E >
+  static void init(GlobalAddress<Graph<V,E>> _g) {
     call_on_all_cores([=]{ g = _g; });
     
     ct = 0;
     // initialize GraphlabVertexProgram
     forall(g, [=](Vertex& v){
       v->prog = new VertexProg(v);
+      v->vertex = &v;
       if (prog(v).gather_edges(v)) ct++;
     });
     
@@ -146,6 +279,15 @@ struct NaiveGraphlabEngine {
         });
       });
     }
+  }
+  
+  /// Run synchronous engine, assumes:
+  /// - Delta caching enabled
+  /// - gather_edges:IN_EDGES, scatter_edges:(OUT_EDGES || NONE)
+  template< typename V, typename E >
+  static void run_sync(GlobalAddress<Graph<V,E>> _g) {
+    init(_g);
+    
     int iteration = 0;
     size_t active = V::total_active;
     while ( active > 0 && iteration < FLAGS_max_iterations )
@@ -155,28 +297,40 @@ struct NaiveGraphlabEngine {
 
       double t = walltime();
       
-      forall(g, [=](Vertex& v){
-        if (!v->active) return;
-        v->deactivate();
+      on_all_cores([]{
+        // take this iteration's active vertices; anything activated during
+        // scatter lands in a fresh list for the next iteration
+        std::vector<GraphlabVertexData<V>*> current;
+        current.swap(V::active_list);
         
-        auto& p = prog(v);
+        forall_here(0, current.size(), [&current](int64_t i){
+          auto d = current[i];
+          if (!d->active) return;
+          d->deactivate();
+          
+          auto& v = *static_cast<Vertex*>(d->vertex);
+          auto& p = prog(v);
 
-        // apply
-        p.apply(v, p.cache);
+          // apply
+          p.apply(v, p.cache);
 
-        v->active_minor_step = p.scatter_edges(v);
+          if (p.scatter_edges(v)) scatter_list.push_back(&v);
+        });
       });
 
-      forall(g, [=](Vertex& v){
-        if (v->active_minor_step) {
-          v->active_minor_step = false;
+      on_all_cores([]{
+        forall_here<TaskMode::Bound,SyncMode::Async,&impl::local_gce>(0, scatter_list.size(),
+            [](int64_t i){
+          auto& v = *scatter_list[i];
           auto prog_copy = prog(v);
           // scatter
           forall<async>(adj(g,v), [=](Edge& e){
             _do_scatter(prog_copy, e, &VertexProg::scatter);
           });
-        }
+        });
       });
+      impl::local_gce.wait();
+      call_on_all_cores([]{ scatter_list.clear(); });
     
       iteration++;
       VLOG(1) << "  time:   " << walltime()-t;
@@ -184,6 +338,46 @@ struct NaiveGraphlabEngine {
     }
 
     forall(g, [](Vertex& v){ delete static_cast<VertexProg*>(v->prog); });
+    call_on_all_cores([]{
+      std::vector<GraphlabVertexData<V>*>().swap(V::active_list);
+      std::vector<Vertex*>().swap(scatter_list);
+    });
+  }
+  
+  /// Run asynchronous engine (same assumptions as `run_sync`). Vertices run
+  /// as soon as they are activated, until none are active; there are no
+  /// iterations, so --max_iterations does not apply.
+  template< typename V, typename E >
+  static void run_async(GlobalAddress<Graph<V,E>> _g) {
+    init(_g);
+    
+    VLOG(1) << "async: initially active: " << V::total_active;
+    double t = walltime();
+    
+    // take every core's initially active vertices before any core starts
+    // running them, and stop listing activations from here on
+    call_on_all_cores([]{
+      for (auto d : V::active_list) scatter_list.push_back(static_cast<Vertex*>(d->vertex));
+      std::vector<GraphlabVertexData<V>*>().swap(V::active_list);
+      V::list_activations = false;
+    });
+    
+    on_all_cores([]{
+      std::vector<Vertex*> initial;
+      initial.swap(scatter_list);
+      for (auto vp : initial) {
+        auto& v = *vp;
+        if (!v->active || v->scheduled) continue;
+        async_gce.enroll();
+        async_schedule(v, mycore());
+      }
+    });
+    async_gce.wait();
+    
+    VLOG(1) << "  time:   " << walltime()-t;
+    
+    forall(g, [](Vertex& v){ delete static_cast<VertexProg*>(v->prog); });
+    call_on_all_cores([]{ V::list_activations = true; });
   }
 };
 
@@ -192,3 +386,12 @@ GlobalAddress<G> NaiveGraphlabEngine<G,VertexProg>::g;
 
 template< typename G, typename VertexProg >
 Reducer<int64_t,ReducerType::Add> NaiveGraphlabEngine<G,VertexProg>::ct;
+
+template< typename G, typename VertexProg >
+std::vector<typename G::Vertex*> NaiveGraphlabEngine<G,VertexProg>::scatter_list;
+
+template< typename G, typename VertexProg >
+typename NaiveGraphlabEngine<G,VertexProg>::AsyncState NaiveGraphlabEngine<G,VertexProg>::async_state;
+
+template< typename G, typename VertexProg >
+GlobalCompletionEvent NaiveGraphlabEngine<G,VertexProg>::async_gce;
@@ -33,6 +33,7 @@ DEFINE_int32(scale, 10, "Log2 number of vertices.");
 DEFINE_int32(edgefactor, 16, "Average number of edges per vertex.");
 
 DEFINE_int32(trials, 3, "Number of timed trials to run and average over.");
+DEFINE_bool( async, false, "Use the asynchronous engine instead of the synchronous one");
 
 DEFINE_string(path, "", "Path to graph source file.");
 DEFINE_string(format, "bintsv4", "Format of graph source file.");
@@ -55,8 +56,12 @@ using G = Graph<PagerankVertexData,Empty>;
 
 struct PagerankVertexProgram : public GraphlabVertexProgram<G,double> {
   double delta;
+  double residual; // magnitude of deltas received since the last apply
   
-  PagerankVertexProgram(Vertex& v) {}
+  PagerankVertexProgram(Vertex& v): residual(0) {}
+  
+  void post_delta(double d) { cache += d; residual += std::fabs(d); }
+  double priority(const Vertex& v) const { return residual; }
   
   bool gather_edges(const Vertex& v) const { return true; }
   
@@ -67,6 +72,7 @@ struct PagerankVertexProgram : public GraphlabVertexProgram<G,double> {
     auto new_val = (1.0 - RESET_PROB) * total + RESET_PROB;
     delta = (new_val - v->rank) / v.nadj;
     v->rank = new_val;
+    residual = 0;
   }
   bool scatter_edges(const Vertex& v) const {
     return std::fabs(delta * v.nadj) > TOLERANCE;
@@ -132,7 +138,8 @@ int main(int argc, char* argv[]) {
       
       GRAPPA_TIME_REGION(total_time) {
         activate_all(g);
-        NaiveGraphlabEngine<G,PagerankVertexProgram>::run_sync(g);
+        if (FLAGS_async) NaiveGraphlabEngine<G,PagerankVertexProgram>::run_async(g);
+        else             NaiveGraphlabEngine<G,PagerankVertexProgram>::run_sync(g);
       }
       
       if (i == 0) {
@@ -34,6 +34,7 @@ DEFINE_int32(scale, 10, "Log2 number of vertices.");
 DEFINE_int32(edgefactor, 16, "Average number of edges per vertex.");
 
 DEFINE_int32(trials, 3, "Number of timed trials to run and average over.");
+DEFINE_bool( async, false, "Use the asynchronous engine instead of the synchronous one");
 
 DEFINE_string(path, "", "Path to graph source file.");
 DEFINE_string(format, "bintsv4", "Format of graph source file.");
@@ -52,8 +53,19 @@ struct SSSPVertexData : public GraphlabVertexData< SSSPVertexData > {
 };
 struct EdgeDistance {
   distance_t dist;
+  EdgeDistance(distance_t dist = 1.0): dist(dist) {}
 };
 
+namespace Grappa {
+  /// weighted inputs give their weights as distances (others are unit)
+  template<> struct EdgePayload<EdgeDistance> {
+    static constexpr bool used = true;
+    static void init(EdgeDistance * e, const TupleGraph::Edge& te) {
+      new (e) EdgeDistance(te.weight());
+    }
+  };
+}
+
 using G = Graph<SSSPVertexData,EdgeDistance>;
 
 
@@ -90,11 +102,15 @@ struct SSSP : public GraphlabVertexProgram<G,bool> {
   bool scatter(const Edge& e, Vertex& target) const {
     auto new_dist = min_dist + e->dist;
     if (new_dist < target->dist) {
-      target->new_dist = new_dist;
+      // keep the shortest of the distances offered before the next apply
+      if (!target->active || new_dist < target->new_dist) target->new_dist = new_dist;
       target->activate();
     }
     return false;
   }
+  
+  // settle the closest vertices first
+  double priority(const Vertex& v) const { return -v->new_dist; }
 };
 
 using MaxDegree = CmpElement<VertexID,int64_t>;
@@ -122,13 +138,7 @@ int main(int argc, char* argv[]) {
     
     auto g = G::create(tg); // undirected
     
-    // TODO: random init
-    forall(g, [=](G::Vertex& v){
-      new (&v.data) SSSPVertexData();
-      forall<async>(adj(g,v), [](G::Edge& e){
-        e->dist = 1.0;
-      });
-    });
+    forall(g, [](G::Vertex& v){ new (&v.data) SSSPVertexData(); });
     
     tg.destroy();
     
@@ -155,7 +165,8 @@ int main(int argc, char* argv[]) {
       
       GRAPPA_TIME_REGION(total_time) {
         activate(g->vs+root);
-        NaiveGraphlabEngine<G,SSSP>::run_sync(g);
+        if (FLAGS_async) NaiveGraphlabEngine<G,SSSP>::run_async(g);
+        else             NaiveGraphlabEngine<G,SSSP>::run_sync(g);
       }
       
       if (i == 0) Metrics::reset_all_cores(); // don't count the first one
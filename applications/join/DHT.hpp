@@ -7,135 +7,65 @@
 #include <ParallelLoop.hpp>
 #include <Metrics.hpp>
 
-#include <cmath>
+#include "FlatMatchTable.hpp"
 
 
 //GRAPPA_DECLARE_METRIC(MaxMetric<uint64_t>, max_cell_length);
 GRAPPA_DECLARE_METRIC(SimpleMetric<uint64_t>, hash_tables_size);
-GRAPPA_DECLARE_METRIC(SummarizingMetric<uint64_t>, hash_tables_lookup_steps);
 
 
-// for naming the types scoped in DHT
-#define DHT_TYPE(type) typename DHT<K,V,HF>::type
-
 // Hash table for joins
-// * allows multiple copies of a Key
-// * lookups return all Key matches
+// * one value per Key
+// * each core owns a FlatMatchTable for the keys that hash to it
 template <typename K, typename V, uint64_t (*HF)(K)> 
 class DHT {
 
   private:
-    struct Entry {
-      K key;
-      V value;
-      Entry( K key, V value ) : key(key), value(value) {}
-      Entry ( ) {}
-    };
-
-    struct Cell {
-      std::list<Entry> * entries;
-
-      Cell() : entries( NULL ) {}
-    };
+    typedef FlatMatchTable<K,V> Table;
 
     // private members
-    GlobalAddress< Cell > base;
-    size_t capacity;
+    Table * table;  // this core's keys
 
-    uint64_t computeIndex( K key ) {
-      return HF(key) & (capacity - 1);
+    static Core owner( K key ) {
+      return HF(key) % Grappa::cores();
     }
 
     // for creating local DHT
-    DHT( GlobalAddress<Cell> base, uint32_t capacity_pow2 ) {
-      this->base = base;
-      this->capacity = capacity_pow2;
-    }
+    DHT( Table * table ) : table( table ) {}
 
     struct lookup_result {
       V result;
       bool valid;
-    }
+    };
 
-    static bool lookup_local( K key, Cell * target, Entry * result ) {
-        std::list<DHT_TYPE(Entry)> * entries = target->entries;
-
-        // first check if the cell has any entries;
-        // if not then the lookup returns nothing
-        if ( entries == NULL ) return false;
-
-        typename std::list<MDHT_TYPE(Entry)>::iterator i;
-        uint64_t steps = 1;
-        for (i = entries->begin(); i!=entries->end(); ++i) {
-          const Entry e = *i;
-          if ( e.key == key ) {  // typename K must implement operator==
-            *result = e;
-            hash_tables_lookup_steps += steps;
-            return true;
-          }
-          ++steps;
-        }
-        hash_tables_lookup_steps += steps;
-        return false;
-    }
-    
   public:
     // for static construction
-    DHT( ) {}
+    DHT( ) : table( NULL ) {}
 
     static void init_global_DHT( DHT<K,V,HF> * globally_valid_local_pointer, size_t capacity ) {
-
-      uint32_t capacity_exp = log2(capacity);
-      size_t capacity_powerof2 = pow(2, capacity_exp);
-      GlobalAddress<Cell> base = Grappa::global_alloc<Cell>( capacity_powerof2 );
-
-      Grappa::on_all_cores( [globally_valid_local_pointer,base,capacity_powerof2] {
-        *globally_valid_local_pointer = DHT<K,V,HF>( base, capacity_powerof2 );
-      });
-
-      Grappa::forall( base, capacity_powerof2, []( int64_t i, Cell& c ) {
-        Cell empty;
-        c = empty;
+      Grappa::on_all_cores( [globally_valid_local_pointer,capacity] {
+        *globally_valid_local_pointer = DHT<K,V,HF>( new Table( capacity / Grappa::cores() ) );
       });
     }
 
     static void set_RO_global( DHT<K,V,HF> * globally_valid_local_pointer ) {
-      Grappa::forall( globally_valid_local_pointer->base, globally_valid_local_pointer->capacity, []( int64_t i, Cell& c ) {
-        // list of entries in this cell
-        std::list<DHT_TYPE(Entry)> * entries = c.entries;
-
-        // if cell is not hit then no action
-        if ( entries == NULL ) {
-          return;
-        }
-
-
-        uint64_t sum_size = 0;
-        // for all keys, set match vector to RO
-        typename std::list<DHT_TYPE(Entry)>::iterator it;
-        for (it = entries->begin(); it!=entries->end(); ++it) {
-          Entry e = *it;
-          //e.vs->setReadMode();
-          sum_size+=e.vs->size();
-        }
-        //max_cell_length.add(sum_size);
+      Grappa::on_all_cores( [globally_valid_local_pointer] {
+        globally_valid_local_pointer->table->compact();
       });
     }
 
 
     bool lookup ( K key, V * val ) {          
-      uint64_t index = computeIndex( key );
-      GlobalAddress< Cell > target = base + index; 
-
       // FIXME: remove 'this' capture when using gcc4.8, this is just a bug in 4.7
-      lookup_result result = Grappa::delegate::call( target.core(), [key,target,this]() {
+      lookup_result result = Grappa::delegate::call( owner(key), [key,this]() {
 
-        DHT_TYPE(lookup_result) lr;
+        lookup_result lr;
+        lr.valid = false;
 
-        Entry e;
-        if (lookup_local( key, target.pointer(), &e)) {
+        int64_t g = table->find( key, HF(key) );
+        if ( g >= 0 ) {
           lr.valid = true;
-          lr.result = e.value;
+          lr.result = table->at(g, 0);
         }
 
         return lr;
@@ -149,55 +79,34 @@ class DHT {
     // version of lookup that takes a continuation instead of returning results back
     template< typename CF, Grappa::GlobalCompletionEvent * GCE = &Grappa::impl::local_gce >
     void lookup ( K key, CF f ) {
-      uint64_t index = computeIndex( key );
-      GlobalAddress< Cell > target = base + index; 
-
       // FIXME: remove 'this' capture when using gcc4.8, this is just a bug in 4.7
       //TODO optimization where only need to do remotePrivateTask instead of call_async
       //if you are going to do more suspending ops (comms) inside the loop
-      Grappa::spawnRemote<GCE>( target.core(), [key, target, f, this]() {
-        Entry e;
-        if (lookup_local( key, target.pointer(), &e)) {
-          f(e.value);
+      Grappa::spawnRemote<GCE>( owner(key), [key, f, this]() {
+        int64_t g = table->find( key, HF(key) );
+        if ( g >= 0 ) {
+          f(table->at(g, 0));
         }
       });
     }
     template< Grappa::GlobalCompletionEvent * GCE, typename CF >
     void lookup_cps ( K key, CF f ) {
-      lookup_cps<CF, GCE>(key, f);
+      lookup<CF, GCE>(key, f);
     }
     
     template< typename UV, V (*UpF)(V oldval, UV incVal), V Init >
     void update( K key, UV val ) {
-      uint64_t index = computeIndex( key );
-      GlobalAddress< Cell > target = base + index; 
-
-      Grappa::delegate::call( target.core(), [key, val, target]() {   // TODO: upgrade to call_async; using GCE
-        // list of entries in this cell
-        std::list<DHT_TYPE(Entry)> * entries = target.pointer()->entries;
-
-        // if first time the cell is hit then initialize
-        if ( entries == NULL ) {
-          entries = new std::list<Entry>();
-          target.pointer()->entries = entries;
+      Grappa::delegate::call( owner(key), [key, val, this]() {   // TODO: upgrade to call_async; using GCE
+        int64_t g = table->find( key, HF(key) );
+        if ( g >= 0 ) {
+          // key found so update
+          V& v = table->at(g, 0);
+          v = UpF(v, val);
+        } else {
+          // this is the first time the key has been seen
+          table->template insert<true>( key, HF(key), UpF(Init, val) );
         }
-
-        // find matching key in the list
-        typename std::list<DHT_TYPE(Entry)>::iterator i;
-        for (i = entries->begin(); i!=entries->end(); ++i) {
-          if ( i->key == key ) {
-            // key found so update
-            i->value = UpF(i->value, val);
-            hash_tables_size+=1;
-            return 0;
-          }
-        }
-
-        // this is the first time the key has been seen
-        // so add it to the list
-        Entry newe( key, UpF(Init, val));
-
-        return 0; 
+        hash_tables_size+=1;
       });
     }
 
@@ -205,4 +114,4 @@ class DHT {
 };
 
 
-#endif // MATCHES_DHT_HPP
+#endif // DHT_HPP
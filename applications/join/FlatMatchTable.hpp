@@ -0,0 +1,143 @@
+#pragma once
+
+#include <Metrics.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+GRAPPA_DECLARE_METRIC(SummarizingMetric<uint64_t>, hash_tables_lookup_steps);
+
+// Core-local multimap for the join hash tables.
+// * keys are open-addressed (linear probing) in one slot array that points
+//   at per-key groups, so probes never chase list nodes
+// * all values of a key are kept adjacent in one shared value array, so the
+//   matches of a key are a contiguous range
+// * group ids are stable across growth and compaction, so a reader holding
+//   (group, index) stays valid while more values are inserted
+template <typename K, typename V>
+class FlatMatchTable {
+
+  private:
+    struct Group {
+      K key;
+      uint64_t offset;    // start of this key's values
+      uint32_t size;
+      uint32_t capacity;  // values reserved at offset
+    };
+
+    std::vector<int64_t> slots;   // group id, or -1 if empty
+    std::vector<Group> groups;
+    std::vector<uint64_t> hashes; // hash of each group's key, for rehashing
+    std::vector<V> values;
+    uint64_t garbage;             // values left behind by relocated groups
+    int shift;
+
+    uint64_t slotOf( uint64_t hash ) const {
+      return (hash * 0x9E3779B97F4A7C15ULL) >> shift;
+    }
+
+    void resizeSlots( uint64_t nslots ) {
+      slots.assign( nslots, -1 );
+      shift = 64 - __builtin_ctzll( nslots );
+      for (int64_t g=0; g<groups.size(); g++) {
+        uint64_t s = slotOf( hashes[g] );
+        while ( slots[s] >= 0 ) s = (s+1) & (nslots-1);
+        slots[s] = g;
+      }
+    }
+
+    // make room for one more value in group g, moving it to the end of the
+    // value array if it cannot grow in place
+    void reserveOne( Group& gr ) {
+      if ( gr.size < gr.capacity ) return;
+      uint32_t newcap = gr.capacity ? 2*gr.capacity : 1;
+      if ( gr.offset + gr.capacity == values.size() ) {
+        values.resize( gr.offset + newcap );
+      } else {
+        uint64_t offset = values.size();
+        values.resize( offset + newcap );
+        std::copy( values.begin()+gr.offset, values.begin()+gr.offset+gr.size, values.begin()+offset );
+        garbage += gr.capacity;
+        gr.offset = offset;
+      }
+      gr.capacity = newcap;
+    }
+
+  public:
+    FlatMatchTable( size_t expected_keys = 0 ) : garbage(0) {
+      uint64_t nslots = 16;
+      while ( nslots < 2*expected_keys ) nslots *= 2;
+      resizeSlots( nslots );
+    }
+
+    /// @return group id of key, or -1 if it is not present
+    int64_t find( K key, uint64_t hash ) const {
+      uint64_t s = slotOf( hash );
+      uint64_t steps = 1;
+      while ( slots[s] >= 0 ) {
+        if ( groups[slots[s]].key == key ) {  // typename K must implement operator==
+          hash_tables_lookup_steps += steps;
+          return slots[s];
+        }
+        s = (s+1) & (slots.size()-1);
+        ++steps;
+      }
+      hash_tables_lookup_steps += steps;
+      return -1;
+    }
+
+    /// Add val to the matches of key; if Unique, only the first value of
+    /// each key is kept.
+    /// @return group id of key
+    template< bool Unique = false >
+    int64_t insert( K key, uint64_t hash, const V& val ) {
+      uint64_t s = slotOf( hash );
+      while ( slots[s] >= 0 && !(groups[slots[s]].key == key) ) s = (s+1) & (slots.size()-1);
+
+      int64_t g = slots[s];
+      if ( g < 0 ) {
+        g = groups.size();
+        groups.push_back( Group{ key, values.size(), 0, 0 } );
+        hashes.push_back( hash );
+        slots[s] = g;
+        if ( 2*groups.size() > slots.size() ) resizeSlots( 2*slots.size() );
+      } else if ( Unique ) {
+        return g;
+      }
+
+      Group& gr = groups[g];
+      reserveOne( gr );
+      values[gr.offset + gr.size++] = val;
+
+      if ( garbage > values.size()/2 && values.size() > 1024 ) compact();
+      return g;
+    }
+
+    size_t count( int64_t g ) const { return groups[g].size; }
+    V& at( int64_t g, size_t i ) { return values[groups[g].offset + i]; }
+    V * matches( int64_t g ) { return &values[groups[g].offset]; }
+
+    /// number of values stored
+    size_t size() const {
+      size_t n = 0;
+      for (auto& gr : groups) n += gr.size;
+      return n;
+    }
+    size_t keys() const { return groups.size(); }
+
+    /// Pack every group tightly, in group order, dropping relocation garbage
+    /// and spare capacity. Group ids are unchanged.
+    void compact() {
+      std::vector<V> packed;
+      packed.reserve( size() );
+      for (auto& gr : groups) {
+        uint64_t offset = packed.size();
+        packed.insert( packed.end(), values.begin()+gr.offset, values.begin()+gr.offset+gr.size );
+        gr.offset = offset;
+        gr.capacity = gr.size;
+      }
+      values.swap( packed );
+      garbage = 0;
+    }
+};
@@ -1,4 +1,5 @@
 #include "HashJoin.hpp"
+#include "MatchesDHT.hpp"
 #include <GlobalAllocator.hpp>
 
 using namespace Grappa;
@@ -122,10 +123,54 @@ void test_hash_join_array() {
 }
 
 
+uint64_t identity_hash( int64_t k ) { return k; }
+MatchesDHT<int64_t, Tuple1, identity_hash> probeTable;
+int64_t batch_probe_matches = 0;
+
+void test_batch_probe() {
+  LOG(INFO) << "test_batch_probe";
+
+    auto leftnum = 1000;
+    auto rightnum = 500;
+    auto leftTuples = Grappa::global_alloc<Tuple1>(leftnum);
+    auto rightTuples = Grappa::global_alloc<Tuple2>(rightnum);
+
+    MatchesDHT<int64_t, Tuple1, identity_hash>::init_global_DHT( &probeTable, 64 );
+
+    forall(leftTuples, leftnum, [=](int64_t i, Tuple1& t) {
+        t.k = i % 97;
+        t.v = i;
+        probeTable.insert_async( t.k, t );
+    });
+    MatchesDHT<int64_t, Tuple1, identity_hash>::set_RO_global( &probeTable );
+
+    forall(rightTuples, rightnum, [=](int64_t i, Tuple2& t) {
+        t.k = 2*i;
+        t.v = i;
+    });
+
+    probeTable.probe_all( rightTuples, rightnum, [](Tuple2& t) { return t.k; },
+      [](Tuple2& t, Tuple1& match) {
+        CHECK_EQ( t.k, match.k );
+        CHECK_EQ( match.v % 97, match.k );
+        batch_probe_matches++;
+    });
+
+    // keys 0,2,..,96 match; each of the 97 key values has 10 or 11 left tuples
+    int64_t expected = 0;
+    for (int64_t i=0; i<rightnum; i++) {
+      if (2*i < 97) expected += (leftnum / 97) + (2*i < leftnum % 97 ? 1 : 0);
+    }
+    auto total = sum_all_cores([]{ return batch_probe_matches; });
+    CHECK_EQ( expected, total );
+}
+
+
 int main(int argc, char** argv) {
   Grappa::init(&argc, &argv);
   Grappa::run([=] {
     test_hash_join_array();
+    test_batch_probe();
   });
   Grappa::finalize();
 }
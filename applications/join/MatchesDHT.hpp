@@ -7,14 +7,13 @@
 #include <ParallelLoop.hpp>
 #include <BufferVector.hpp>
 #include <Metrics.hpp>
+#include <BulkApply.hpp>
 
-#include <list>
-#include <cmath>
+#include "FlatMatchTable.hpp"
 
 
 //GRAPPA_DECLARE_METRIC(MaxMetric<uint64_t>, max_cell_length);
 GRAPPA_DECLARE_METRIC(SimpleMetric<uint64_t>, hash_tables_size);
-GRAPPA_DECLARE_METRIC(SummarizingMetric<uint64_t>, hash_tables_lookup_steps);
 
 GRAPPA_DECLARE_METRIC(SimpleMetric<uint64_t>, hash_remote_lookups);
 GRAPPA_DECLARE_METRIC(SimpleMetric<uint64_t>, hash_remote_inserts);
@@ -22,157 +21,97 @@ GRAPPA_DECLARE_METRIC(SimpleMetric<uint64_t>, hash_local_lookups);
 GRAPPA_DECLARE_METRIC(SimpleMetric<uint64_t>, hash_local_inserts);
 GRAPPA_DECLARE_METRIC(SimpleMetric<uint64_t>, hash_called_lookups);
 GRAPPA_DECLARE_METRIC(SimpleMetric<uint64_t>, hash_called_inserts);
+GRAPPA_DECLARE_METRIC(SimpleMetric<uint64_t>, hash_batch_lookups);
+GRAPPA_DECLARE_METRIC(SimpleMetric<uint64_t>, hash_batch_probe_messages);
+GRAPPA_DECLARE_METRIC(SimpleMetric<uint64_t>, hash_batch_match_messages);
 
 
-// for naming the types scoped in MatchesDHT
-#define MDHT_TYPE(type) typename MatchesDHT<K,V,HF>::type
-
 // Hash table for joins
 // * allows multiple copies of a Key
 // * lookups return all Key matches
+// * each core owns a FlatMatchTable for the keys that hash to it, so the
+//   matches of a key are one contiguous range on its owner
 template <typename K, typename V, uint64_t (*HF)(K)> 
 class MatchesDHT {
 
   private:
-    struct Entry {
-      K key;
-      std::vector<V> * vs;
-      //BufferVector<V> * vs;
-      Entry( K key ) : key(key), vs(new std::vector<V>()) {}
-      //Entry( K key ) : key(key), vs(new BufferVector<V>( 16 )) {}
-      Entry ( ) {}
-    };
-
-    struct Cell {
-      std::list<Entry> * entries;
-
-      Cell() : entries( NULL ) {}
-    };
+    typedef FlatMatchTable<K,V> Table;
 
     struct lookup_result {
       GlobalAddress<V> matches;
       size_t num;
     };
+
+    struct Match { uint32_t index; V value; };
+
+    // send matches for a probe message back to its origin in packed messages;
+    // the origin completes `cea` once all of them have arrived
+    template< typename CF >
+    static void deliver_matches( Core origin, GlobalAddress<Grappa::CompletionEvent> cea,
+                                 size_t * received, CF * fp, Match * matches, size_t nmatch ) {
+      if (nmatch == 0) {
+        hash_batch_match_messages++;
+        Grappa::send_heap_message(origin, [cea] { Grappa::complete(cea); });
+        return;
+      }
+      const size_t per_msg = MAX_MESSAGE_SIZE / sizeof(Match);
+      size_t nreply = nmatch / per_msg + (nmatch % per_msg ? 1 : 0);
+      hash_batch_match_messages += nreply;
+      for (size_t k=0; k<nreply; k++) {
+        size_t nk = std::min(per_msg, nmatch - k*per_msg);
+        auto m = Grappa::send_message(origin, [cea,received,fp,nreply](void * payload, size_t payload_size) {
+          auto ms = static_cast<Match*>(payload);
+          size_t nm = payload_size / sizeof(Match);
+          for (size_t i=0; i<nm; i++) (*fp)( ms[i].index, ms[i].value );
+          if (++*received == nreply) Grappa::complete(cea);
+        }, matches + k*per_msg, sizeof(Match)*nk);
+      }
+    }
     
     // private members
-    GlobalAddress< Cell > base;
-    size_t capacity;
+    Table * table;  // this core's keys
 
-    uint64_t computeIndex( K key ) {
-      return HF(key) & (capacity - 1);
+    static Core owner( K key ) {
+      return HF(key) % Grappa::cores();
     }
 
     // for creating local MatchesDHT
-    MatchesDHT( GlobalAddress<Cell> base, uint32_t capacity_pow2 ) {
-      this->base = base;
-      this->capacity = capacity_pow2;
-    }
+    MatchesDHT( Table * table ) : table( table ) {}
 
-    static bool lookup_local( K key, Cell * target, Entry * result ) {
-        std::list<MDHT_TYPE(Entry)> * entries = target->entries;
-
-        // first check if the cell has any entries;
-        // if not then the lookup returns nothing
-        if ( entries == NULL ) return false;
-
-        typename std::list<MDHT_TYPE(Entry)>::iterator i;
-        uint64_t steps = 1;
-        for (i = entries->begin(); i!=entries->end(); ++i) {
-          const Entry e = *i;
-          if ( e.key == key ) {  // typename K must implement operator==
-            *result = e;
-            hash_tables_lookup_steps += steps;
-            return true;
-          }
-          ++steps;
-        }
-        hash_tables_lookup_steps += steps;
-        return false;
-    }
-    
   public:
     // for static construction
-    MatchesDHT( ) {}
+    MatchesDHT( ) : table( NULL ) {}
 
     static void init_global_DHT( MatchesDHT<K,V,HF> * globally_valid_local_pointer, size_t capacity ) {
-
-      uint32_t capacity_exp = log2(capacity);
-      size_t capacity_powerof2 = pow(2, capacity_exp);
-      GlobalAddress<Cell> base = Grappa::global_alloc<Cell>( capacity_powerof2 );
-
-      Grappa::on_all_cores( [globally_valid_local_pointer,base,capacity_powerof2] {
-        *globally_valid_local_pointer = MatchesDHT<K,V,HF>( base, capacity_powerof2 );
-      });
-
-      Grappa::forall( base, capacity_powerof2, []( int64_t i, Cell& c ) {
-        Cell empty;
-        c = empty;
+      Grappa::on_all_cores( [globally_valid_local_pointer,capacity] {
+        *globally_valid_local_pointer = MatchesDHT<K,V,HF>( new Table( capacity / Grappa::cores() ) );
       });
     }
 
-
-    struct size_aligned {
-      size_t s;
-
-      size_aligned operator+(const size_aligned& o) const {
-        size_aligned v;
-        v.s = this->s + o.s;
-        return v;
-      }
-    } GRAPPA_BLOCK_ALIGNED;
-
    size_t size() {
-     auto l_size = Grappa::symmetric_global_alloc<size_aligned>();
-     Grappa::forall( base, capacity, [l_size](int64_t i, Cell& c) {
-       if (c.entries != NULL) {
-         for (auto eiter = c.entries->begin(); eiter != c.entries->end(); ++eiter) {
-           l_size->s += eiter->vs->size();
-         }
-       }
-     });
-    return Grappa::reduce<size_aligned, COLL_ADD>(l_size ).s;
-        //FIXME: mem leak l_size
+     return Grappa::sum_all_cores( [this] { return table->size(); } );
    }
 
-
+    // pack each core's matches tightly; after this, `lookup` returns
+    // addresses of the matches which stay valid until the next insert
     static void set_RO_global( MatchesDHT<K,V,HF> * globally_valid_local_pointer ) {
-      Grappa::forall( globally_valid_local_pointer->base, globally_valid_local_pointer->capacity, []( int64_t i, Cell& c ) {
-        // list of entries in this cell
-        std::list<MDHT_TYPE(Entry)> * entries = c.entries;
-
-        // if cell is not hit then no action
-        if ( entries == NULL ) {
-          return;
-        }
-
-
-        uint64_t sum_size = 0;
-        // for all keys, set match vector to RO
-        typename std::list<MDHT_TYPE(Entry)>::iterator it;
-        for (it = entries->begin(); it!=entries->end(); ++it) {
-          Entry e = *it;
-          //e.vs->setReadMode();
-          sum_size+=e.vs->size();
-        }
-        //max_cell_length.add(sum_size);
+      Grappa::on_all_cores( [globally_valid_local_pointer] {
+        globally_valid_local_pointer->table->compact();
       });
     }
 
     uint64_t lookup ( K key, GlobalAddress<V> * vals ) {          
-      uint64_t index = computeIndex( key );
-      GlobalAddress< Cell > target = base + index; 
-
       // FIXME: remove 'this' capture when using gcc4.8, this is just a bug in 4.7
-      lookup_result result = Grappa::delegate::call( target.core(), [key,target,this]() {
+      lookup_result result = Grappa::delegate::call( owner(key), [key,this]() {
         hash_called_lookups++;
 
-        MDHT_TYPE(lookup_result) lr;
+        lookup_result lr;
         lr.num = 0;
 
-        Entry e;
-        if (lookup_local( key, target.pointer(), &e)) {
-         // lr.matches = static_cast<GlobalAddress<V>>(e.vs->getReadBuffer());
-          lr.num = e.vs->size();
+        int64_t g = table->find( key, HF(key) );
+        if ( g >= 0 ) {
+          lr.matches = make_global( table->matches(g) );
+          lr.num = table->count(g);
         }
 
         return lr;
@@ -186,27 +125,27 @@ class MatchesDHT {
     // version of lookup that takes a continuation instead of returning results back
     template< typename CF, Grappa::GlobalCompletionEvent * GCE = &Grappa::impl::local_gce >
     void lookup_iter ( K key, CF f ) {
-      uint64_t index = computeIndex( key );
-      GlobalAddress< Cell > target = base + index; 
+      Core target = owner(key);
 
       // FIXME: remove 'this' capture when using gcc4.8, this is just a bug in 4.7
       //TODO optimization where only need to do remotePrivateTask instead of call_async
       //if you are going to do more suspending ops (comms) inside the loop
-      if (target.core() == Grappa::mycore()) {
+      if (target == Grappa::mycore()) {
         hash_local_lookups++;
       } else {
         hash_remote_lookups++;
       }
-      Grappa::spawnRemote<GCE>( target.core(), [key, target, f, this]() {
+      Grappa::spawnRemote<GCE>( target, [key, f, this]() {
         hash_called_lookups++;
-        Entry e;
-        if (lookup_local( key, target.pointer(), &e)) {
-          auto resultsptr = e.vs;
-          Grappa::forall_here<async,GCE>(0, e.vs->size(), [f,resultsptr](int64_t start, int64_t iters) {
+        auto t = table;
+        int64_t g = t->find( key, HF(key) );
+        if ( g >= 0 ) {
+          // index through the group so iterations stay valid if the table grows
+          Grappa::forall_here<async,GCE>(0, t->count(g), [f,t,g](int64_t start, int64_t iters) {
             for  (int64_t i=start; i<start+iters; i++) {
-              auto results = *resultsptr;
+              V v = t->at(g, i);
               // call the continuation with the lookup result
-              f(results[i]); 
+              f(v); 
             }
           });
         }
@@ -217,18 +156,114 @@ class MatchesDHT {
       lookup_iter<CF, GCE>(key, f);
     }
 
-    // version of lookup that takes a continuation instead of returning results back
+    // Probe a batch of keys: keys are grouped by owner and sent as packed
+    // messages, each owner probes its keys in one loop and sends back packed
+    // (index, match) pairs, and `f(i, match)` is called on this core for every
+    // match of `keys[i]`. f must not block. Blocks until all matches are delivered.
+    template< typename CF >
+    void lookup_batch ( const K * keys, size_t n, CF f ) {
+      if (n == 0) return;
+      CHECK( n < (1L<<32) );
+      hash_batch_lookups += n;
+
+      struct Probe { K key; uint32_t index; };
+      const size_t per_msg = MAX_MESSAGE_SIZE / sizeof(Probe);
+
+      std::vector<Probe> probes(n);
+      for (size_t i=0; i<n; i++) probes[i] = Probe{ keys[i], static_cast<uint32_t>(i) };
+
+      Probe * sorted = Grappa::locale_alloc<Probe>(n);
+      std::vector<size_t> offsets, slot;
+      Grappa::impl::bulk_partition( probes.data(), n, [](const Probe& p) { return owner(p.key); },
+                                    sorted, offsets, slot );
+
+      size_t nmsg = 0;
+      for (Core c=0; c<Grappa::cores(); c++) if (c != Grappa::mycore()) {
+        size_t nc = offsets[c+1]-offsets[c];
+        nmsg += nc / per_msg + (nc % per_msg ? 1 : 0);
+      }
+      hash_batch_probe_messages += nmsg;
+
+      Grappa::CompletionEvent ce(nmsg);
+      auto cea = make_global(&ce);
+      std::vector<size_t> replies(nmsg, 0);  // replies received for each probe message
+      CF * fp = &f;
+      Core origin = Grappa::mycore();
+
+      size_t r = 0;
+      for (Core c=0; c<Grappa::cores(); c++) {
+        if (c == Grappa::mycore()) continue;
+        for (size_t k=offsets[c]; k<offsets[c+1]; k+=per_msg, r++) {
+          size_t nk = std::min(per_msg, offsets[c+1]-k);
+          size_t * received = &replies[r];
+          // FIXME: remove 'this' capture when using gcc4.8, this is just a bug in 4.7
+          Grappa::send_heap_message(c, [cea,received,fp,origin,this](void * payload, size_t payload_size) {
+            auto p = static_cast<Probe*>(payload);
+            size_t np = payload_size / sizeof(Probe);
+            hash_called_lookups += np;
+
+            size_t nmatch = 0;
+            for (size_t i=0; i<np; i++) {
+              int64_t g = table->find( p[i].key, HF(p[i].key) );
+              if ( g >= 0 ) nmatch += table->count(g);
+            }
+            Match * matches = Grappa::locale_alloc<Match>(nmatch);
+            size_t m = 0;
+            for (size_t i=0; i<np; i++) {
+              int64_t g = table->find( p[i].key, HF(p[i].key) );
+              if ( g < 0 ) continue;
+              V * vs = table->matches(g);
+              for (size_t j=0; j<table->count(g); j++) matches[m++] = Match{ p[i].index, vs[j] };
+            }
+
+            // reply from a task so the matches can be freed once they have been sent
+            Grappa::spawn([cea,received,fp,origin,matches,nmatch]{
+              deliver_matches( origin, cea, received, fp, matches, nmatch );
+              Grappa::locale_free(matches);
+            });
+          }, sorted+k, sizeof(Probe)*nk);
+        }
+      }
+
+      // probe our own keys directly
+      for (size_t k=offsets[Grappa::mycore()]; k<offsets[Grappa::mycore()+1]; k++) {
+        int64_t g = table->find( sorted[k].key, HF(sorted[k].key) );
+        if ( g < 0 ) continue;
+        for (size_t j=0; j<table->count(g); j++) f( sorted[k].index, table->at(g, j) );
+      }
+
+      ce.wait();
+      Grappa::locale_free(sorted);
+    }
+
+    // Probe the key of every tuple in `tuples` with `lookup_batch`, calling
+    // `f(tuple, match)` for each match on the core holding the tuple.
+    template< typename T, typename KF, typename CF >
+    void probe_all ( GlobalAddress<T> tuples, size_t n, KF key_of, CF f ) {
+      // FIXME: remove 'this' capture when using gcc4.8, this is just a bug in 4.7
+      Grappa::on_all_cores( [tuples,n,key_of,f,this] {
+        T * local_start = tuples.localize();
+        T * local_end = (tuples+n).localize();
+        std::vector<K> keys;
+        for (T * t = local_start; t < local_end; t += Grappa::impl::BULK_CHUNK) {
+          size_t nt = std::min<size_t>(Grappa::impl::BULK_CHUNK, local_end - t);
+          keys.resize(nt);
+          for (size_t i=0; i<nt; i++) keys[i] = key_of(t[i]);
+          lookup_batch( keys.data(), nt, [t,&f](uint32_t i, V& match) { f(t[i], match); } );
+        }
+      });
+    }
+
+    // version of lookup that takes a continuation instead of returning results back;
+    // f gets a pointer to the contiguous matches and their number
     template< typename CF, Grappa::GlobalCompletionEvent * GCE = &Grappa::impl::local_gce >
     void lookup ( K key, CF f ) {
-      uint64_t index = computeIndex( key );
-      GlobalAddress< Cell > target = base + index; 
-
-      Grappa::delegate::call<async>( target.core(), [key, target, f]() {
+      Grappa::delegate::call<async>( owner(key), [key, f, this]() {
         hash_called_lookups++;
-        Entry e;
-        if (lookup_local( key, target.pointer(), &e)) {
-          uint64_t len = e.vs->size();
-          f(e.vs, len); 
+        int64_t g = table->find( key, HF(key) );
+        if ( g >= 0 ) {
+          uint64_t len = table->count(g);
+          f(table->matches(g), len); 
         }
       });
     }
@@ -236,86 +271,27 @@ class MatchesDHT {
 
     // Inserts the key if not already in the set
     // Shouldn't be used with `insert`.
-    //
-    // returns true if the set already contains the key
     void insert_unique( K key, V val ) {
-      uint64_t index = computeIndex( key );
-      GlobalAddress< Cell > target = base + index; 
-      Grappa::delegate::call( target.core(), [key,val,target]() {   // TODO: have an additional version that returns void
-                                                                 // to upgrade to call_async
+      Grappa::delegate::call( owner(key), [key,val,this]() {   // TODO: have an additional version that returns void
+                                                               // to upgrade to call_async
         hash_called_inserts++;
-
-        // list of entries in this cell
-        std::list<MDHT_TYPE(Entry)> * entries = target.pointer()->entries;
-
-        // if first time the cell is hit then initialize
-        if ( entries == NULL ) {
-          entries = new std::list<Entry>();
-          target.pointer()->entries = entries;
-        }
-
-        // find matching key in the list
-        typename std::list<MDHT_TYPE(Entry)>::iterator i;
-        for (i = entries->begin(); i!=entries->end(); ++i) {
-          Entry e = *i;
-          if ( e.key == key ) {
-            // key found so no insert
-            return;
-          }
-        }
-
-        // this is the first time the key has been seen
-        // so add it to the list
-        Entry newe( key );        // TODO: cleanup since sharing insert* code here, we are just going to store an empty vector
-        newe.vs->push_back( val );
-                                  // perhaps a different module
-        entries->push_back( newe );
-
-        return; 
-     });
+        table->template insert<true>( key, HF(key), val );
+      });
     }
 
     template< Grappa::GlobalCompletionEvent * GCE = &Grappa::impl::local_gce >
     void insert_async( K key, V val ) {
-      uint64_t index = computeIndex( key );
-      GlobalAddress< Cell > target = base + index; 
+      Core target = owner(key);
 
-      if (target.core() == Grappa::mycore()) {
+      if (target == Grappa::mycore()) {
         hash_local_inserts++;
       } else {
         hash_remote_inserts++;
       }
-      Grappa::delegate::call<async, GCE>( target.core(), [key, val, target]() {   // TODO: upgrade to call_async; using GCE
+      Grappa::delegate::call<async, GCE>( target, [key, val, this]() {
         hash_called_inserts++;
-
-        // list of entries in this cell
-        std::list<MDHT_TYPE(Entry)> * entries = target.pointer()->entries;
-
-        // if first time the cell is hit then initialize
-        if ( entries == NULL ) {
-          entries = new std::list<Entry>();
-          target.pointer()->entries = entries;
-        }
-
-        // find matching key in the list
-        typename std::list<MDHT_TYPE(Entry)>::iterator i;
-        for (i = entries->begin(); i!=entries->end(); ++i) {
-          Entry e = *i;
-          if ( e.key == key ) {
-            // key found so add to matches
-            e.vs->push_back( val );
-            hash_tables_size+=1;
-            return;
-          }
-        }
-
-        // this is the first time the key has been seen
-        // so add it to the list
-        Entry newe( key );
-        newe.vs->push_back( val );
-        entries->push_back( newe );
-
-        return; 
+        table->insert( key, HF(key), val );
+        hash_tables_size+=1;
       });
     }
 
@@ -27,6 +27,7 @@
 
 #include <Grappa.hpp>
 #include <GlobalAllocator.hpp>
+#include <limits>
 
 #include "relation_io.hpp"
 
@@ -75,6 +76,69 @@ class MaterializedTupleRef_V1_0_1 {
 int64_t other_data __attribute__ ((aligned (2048))) = 0;
 std::vector<MaterializedTupleRef_V1_0_1> more_data;
 
+class MaterializedTupleRef_V2_0_1_2 {
+  public:
+    int64_t _fields[3];
+
+    int64_t get(int field) const {
+      return _fields[field];
+    }
+
+    void set(int field, int64_t val) {
+      _fields[field] = val;
+    }
+
+    int numFields() const {
+      return 3;
+    }
+  } GRAPPA_BLOCK_ALIGNED;
+
+int64_t columnar_value(int64_t i) {
+  // extremes in the first chunk force a plain-encoded block
+  return i == 5 ? std::numeric_limits<int64_t>::min()
+       : i == 6 ? std::numeric_limits<int64_t>::max()
+       : i * 1000003;
+}
+
+std::vector<MaterializedTupleRef_V2_0_1_2> columnar_data;
+
+void test_columnar() {
+  const int64_t n = 100;
+  for (int64_t i=0; i<n; i++) {
+    MaterializedTupleRef_V2_0_1_2 t;
+    t.set(0, i);
+    t.set(1, i % 7);
+    t.set(2, columnar_value(i));
+    columnar_data.push_back(t);
+  }
+  fs::remove( FLAGS_relations+"/columnar.bin" );
+  writeTuplesUnordered<MaterializedTupleRef_V2_0_1_2>( &columnar_data, "columnar.bin" );
+  columnar::convert( FLAGS_relations+"/columnar.bin", FLAGS_relations+"/columnar.col", 3, 16 );
+
+  // read two of the three columns, in a different order
+  Relation<MaterializedTupleRef_V1_0_1> results =
+    readTuplesColumnar<MaterializedTupleRef_V1_0_1>( "columnar.col", {2, 0} );
+  BOOST_CHECK_EQUAL( n, results.numtuples );
+
+  int64_t sum = 0;
+  for (int64_t i=0; i<results.numtuples; i++) {
+    auto t = delegate::read( results.data+i );
+    sum += t.get(1);
+    BOOST_CHECK_EQUAL( columnar_value(t.get(1)), t.get(0) );
+  }
+  BOOST_CHECK_EQUAL( n*(n-1)/2, sum );
+
+  // only the chunks holding rows [32,64) can contain 40..50
+  results = readTuplesColumnar<MaterializedTupleRef_V1_0_1>( "columnar.col", {0, 1},
+              { columnar::ColumnRange{ 0, 40, 50 } } );
+  BOOST_CHECK_EQUAL( 32, results.numtuples );
+  for (int64_t i=0; i<results.numtuples; i++) {
+    auto t = delegate::read( results.data+i );
+    BOOST_CHECK( t.get(0) >= 32 && t.get(0) < 64 );
+    BOOST_CHECK_EQUAL( t.get(0) % 7, t.get(1) );
+  }
+}
+
 BOOST_AUTO_TEST_CASE( test1 ) {
   Grappa::init( GRAPPA_TEST_ARGS );
   Grappa::run([]{
@@ -130,6 +194,7 @@ BOOST_AUTO_TEST_CASE( test1 ) {
     BOOST_CHECK_EQUAL( expected.get(0), (*results.data.localize()).get(0) );
     BOOST_CHECK_EQUAL( expected.get(1), (*results.data.localize()).get(1) );
 
+    test_columnar();
   });
   Grappa::finalize();
 }
@@ -0,0 +1,220 @@
+#include "columnar.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <glog/logging.h>
+
+namespace columnar {
+
+  static uint8_t bit_width(uint64_t v) {
+    return v == 0 ? 0 : 64 - __builtin_clzll(v);
+  }
+
+  static uint64_t zigzag(int64_t d) { return (static_cast<uint64_t>(d) << 1) ^ (d >> 63); }
+  static int64_t unzigzag(uint64_t z) { return static_cast<int64_t>(z >> 1) ^ -static_cast<int64_t>(z & 1); }
+
+  static size_t packed_bytes(size_t n, uint8_t width) {
+    return (n * width + 63) / 64 * sizeof(uint64_t);
+  }
+
+  static void pack(const uint64_t * v, size_t n, uint8_t width, uint64_t * out) {
+    if (width == 0) return;
+    std::fill(out, out + packed_bytes(n, width)/sizeof(uint64_t), 0);
+    for (size_t i=0; i<n; i++) {
+      size_t bit = i * width, w = bit / 64, s = bit % 64;
+      out[w] |= v[i] << s;
+      if (s + width > 64) out[w+1] |= v[i] >> (64 - s);
+    }
+  }
+
+  static void unpack(const uint64_t * in, size_t n, uint8_t width, uint64_t * v) {
+    if (width == 0) { std::fill(v, v+n, 0); return; }
+    uint64_t mask = width == 64 ? ~0ULL : (1ULL << width) - 1;
+    for (size_t i=0; i<n; i++) {
+      size_t bit = i * width, w = bit / 64, s = bit % 64;
+      uint64_t x = in[w] >> s;
+      if (s + width > 64) x |= in[w+1] << (64 - s);
+      v[i] = x & mask;
+    }
+  }
+
+  void encode(const int64_t * vals, size_t n, std::vector<char>& out, ChunkInfo& info) {
+    info.pad = 0;
+    info.min = n ? *std::min_element(vals, vals+n) : 0;
+    info.max = n ? *std::max_element(vals, vals+n) : 0;
+
+    uint64_t max_zz = 0;
+    for (size_t i=1; i<n; i++) {
+      max_zz = std::max(max_zz, zigzag(static_cast<int64_t>(
+                 static_cast<uint64_t>(vals[i]) - static_cast<uint64_t>(vals[i-1]))));
+    }
+    uint8_t for_width = bit_width(static_cast<uint64_t>(info.max) - static_cast<uint64_t>(info.min));
+    uint8_t delta_width = bit_width(max_zz);
+
+    std::vector<uint64_t> v(n);
+    if (std::min(for_width, delta_width) >= 64) {
+      info.encoding = PLAIN;
+      info.width = 64;
+      info.base = 0;
+      out.resize(n * sizeof(int64_t));
+      std::memcpy(out.data(), vals, out.size());
+    } else if (for_width <= delta_width) {
+      info.encoding = FOR_BITPACK;
+      info.width = for_width;
+      info.base = info.min;
+      for (size_t i=0; i<n; i++) v[i] = static_cast<uint64_t>(vals[i]) - static_cast<uint64_t>(info.min);
+      out.resize(packed_bytes(n, info.width));
+      pack(v.data(), n, info.width, reinterpret_cast<uint64_t*>(out.data()));
+    } else {
+      info.encoding = DELTA_BITPACK;
+      info.width = delta_width;
+      info.base = vals[0];
+      v[0] = 0;
+      for (size_t i=1; i<n; i++) {
+        v[i] = zigzag(static_cast<int64_t>(static_cast<uint64_t>(vals[i]) - static_cast<uint64_t>(vals[i-1])));
+      }
+      out.resize(packed_bytes(n, info.width));
+      pack(v.data(), n, info.width, reinterpret_cast<uint64_t*>(out.data()));
+    }
+    info.bytes = out.size();
+  }
+
+  void decode(const char * buf, const ChunkInfo& info, size_t n, int64_t * out) {
+    if (info.encoding == PLAIN) {
+      std::memcpy(out, buf, n * sizeof(int64_t));
+      return;
+    }
+    auto v = reinterpret_cast<uint64_t*>(out);
+    unpack(reinterpret_cast<const uint64_t*>(buf), n, info.width, v);
+    if (info.encoding == FOR_BITPACK) {
+      for (size_t i=0; i<n; i++) v[i] += static_cast<uint64_t>(info.base);
+    } else {
+      CHECK_EQ(info.encoding, DELTA_BITPACK) << "unknown column encoding";
+      uint64_t prev = static_cast<uint64_t>(info.base);
+      for (size_t i=0; i<n; i++) {
+        prev += static_cast<uint64_t>(unzigzag(v[i]));
+        v[i] = prev;
+      }
+    }
+  }
+
+  /// Appends chunks to a columnar file and writes the footer on `finish`.
+  class Writer {
+    std::ofstream file;
+    Header header;
+    std::vector<ChunkInfo> footer;
+    std::vector<int64_t> column;
+    std::vector<char> block;
+    uint64_t offset;
+
+  public:
+    Writer(const std::string& path, uint64_t ncols, uint64_t rows_per_chunk)
+      : file(path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc)
+    {
+      CHECK( file.is_open() ) << path << " failed to open";
+      CHECK( ncols > 0 && rows_per_chunk > 0 );
+      std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+      header.ncols = ncols;
+      header.nrows = 0;
+      header.rows_per_chunk = rows_per_chunk;
+      file.write(reinterpret_cast<char*>(&header), sizeof(header));
+      offset = sizeof(header);
+    }
+
+    /// Write one chunk of `n` row-major rows (`n` must be rows_per_chunk
+    /// except for the last chunk).
+    void chunk(const int64_t * rows, uint64_t n) {
+      column.resize(n);
+      for (uint64_t c=0; c<header.ncols; c++) {
+        for (uint64_t i=0; i<n; i++) column[i] = rows[i*header.ncols + c];
+        ChunkInfo info;
+        encode(column.data(), n, block, info);
+        info.offset = offset;
+        file.write(block.data(), block.size());
+        offset += block.size();
+        footer.push_back(info);
+      }
+      header.nrows += n;
+    }
+
+    void finish() {
+      file.write(reinterpret_cast<char*>(footer.data()), footer.size() * sizeof(ChunkInfo));
+      file.write(reinterpret_cast<char*>(&offset), sizeof(offset));
+      file.write(MAGIC, sizeof(MAGIC));
+      file.seekp(0);
+      file.write(reinterpret_cast<char*>(&header), sizeof(header));
+      CHECK( file.good() ) << "error writing columnar file";
+      file.close();
+      VLOG(1) << "columnar: " << header.nrows << " rows, " << header.ncols << " cols, "
+              << footer.size() / header.ncols << " chunks, " << offset << " data bytes";
+    }
+  };
+
+  void write(const std::string& path, const int64_t * rows, uint64_t nrows,
+             uint64_t ncols, uint64_t rows_per_chunk) {
+    Writer w(path, ncols, rows_per_chunk);
+    for (uint64_t r=0; r<nrows; r+=rows_per_chunk) {
+      w.chunk(rows + r*ncols, std::min(rows_per_chunk, nrows - r));
+    }
+    w.finish();
+  }
+
+  void convert(const std::string& binpath, const std::string& colpath,
+               uint64_t ncols, uint64_t rows_per_chunk) {
+    std::ifstream in(binpath, std::ios_base::in | std::ios_base::binary);
+    CHECK( in.is_open() ) << binpath << " failed to open";
+
+    Writer w(colpath, ncols, rows_per_chunk);
+    std::vector<int64_t> rows(rows_per_chunk * ncols);
+    const size_t row_size_bytes = sizeof(int64_t) * ncols;
+    while (true) {
+      in.read(reinterpret_cast<char*>(rows.data()), rows.size() * sizeof(int64_t));
+      size_t got = in.gcount();
+      CHECK( got % row_size_bytes == 0 ) << binpath << " is ill-formatted; perhaps not all rows have same columns?";
+      if (got > 0) w.chunk(rows.data(), got / row_size_bytes);
+      if (got < rows.size() * sizeof(int64_t)) break;
+    }
+    w.finish();
+  }
+
+  Reader::Reader(const std::string& path)
+    : file(path, std::ios_base::in | std::ios_base::binary)
+  {
+    CHECK( file.is_open() ) << path << " failed to open";
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    CHECK( file.good() && std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 )
+      << path << " is not a columnar relation file";
+
+    uint64_t footer_offset;
+    char magic[sizeof(MAGIC)];
+    file.seekg(-static_cast<int64_t>(sizeof(footer_offset) + sizeof(magic)), std::ios_base::end);
+    file.read(reinterpret_cast<char*>(&footer_offset), sizeof(footer_offset));
+    file.read(magic, sizeof(magic));
+    CHECK( file.good() && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0 )
+      << path << " has a missing or truncated footer";
+
+    uint64_t nchunks = (header.nrows + header.rows_per_chunk - 1) / header.rows_per_chunk;
+    footer.resize(nchunks * header.ncols);
+    file.seekg(footer_offset);
+    file.read(reinterpret_cast<char*>(footer.data()), footer.size() * sizeof(ChunkInfo));
+    CHECK( file.good() ) << path << " has a truncated footer";
+  }
+
+  bool Reader::may_match(uint64_t k, const ColumnRange * ranges, size_t nranges) const {
+    for (size_t i=0; i<nranges; i++) {
+      auto& ci = info(k, ranges[i].column);
+      if (ci.max < ranges[i].lo || ci.min > ranges[i].hi) return false;
+    }
+    return true;
+  }
+
+  void Reader::read(uint64_t k, uint64_t c, int64_t * out) {
+    auto& ci = info(k, c);
+    buf.resize(ci.bytes);
+    file.seekg(ci.offset);
+    file.read(buf.data(), ci.bytes);
+    CHECK( file.good() ) << "short read of chunk " << k << " column " << c;
+    decode(buf.data(), ci, chunk_rows(k), out);
+  }
+
+} // namespace columnar
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/// Columnar binary relation format.
+///
+/// Rows are grouped into chunks of `rows_per_chunk` rows and each column of
+/// a chunk is stored as its own block, so a reader only touches the bytes of
+/// the columns it needs. Every column is treated as 64-bit integers (doubles
+/// are stored by their bits, as in the row-binary format) and each block is
+/// encoded as one of:
+///
+///   PLAIN          raw int64 values
+///   FOR_BITPACK    (value - min), bit-packed at the smallest width that fits
+///   DELTA_BITPACK  zigzag deltas from the previous value, bit-packed
+///
+/// whichever is smallest. Layout of a file:
+///
+///   Header | chunk 0: col 0 block, col 1 block, ... | chunk 1: ... |
+///   ChunkInfo[nchunks][ncols] | uint64 footer offset | magic
+///
+/// The footer keeps min/max per (chunk, column) so readers can skip chunks
+/// that cannot satisfy a range predicate without reading them.
+namespace columnar {
+
+  const char MAGIC[8] = { 'G','R','P','C','O','L','1','\0' };
+
+  enum Encoding : uint8_t { PLAIN = 0, FOR_BITPACK = 1, DELTA_BITPACK = 2 };
+
+  struct Header {
+    char magic[8];
+    uint64_t ncols;
+    uint64_t nrows;
+    uint64_t rows_per_chunk;
+  };
+
+  /// Footer entry describing one column block of one chunk.
+  struct ChunkInfo {
+    uint64_t offset;   ///< file offset of the block
+    uint32_t bytes;    ///< encoded size of the block
+    uint8_t encoding;
+    uint8_t width;     ///< bits per packed value
+    uint16_t pad;
+    int64_t base;      ///< min for FOR_BITPACK, first value for DELTA_BITPACK
+    int64_t min;
+    int64_t max;
+  };
+
+  /// Inclusive range predicate on one column, used to skip chunks.
+  struct ColumnRange {
+    int column;
+    int64_t lo;
+    int64_t hi;
+  };
+
+  /// Encode `n` values into `out` (replacing its contents), filling in
+  /// everything in `info` but the offset.
+  void encode(const int64_t * vals, size_t n, std::vector<char>& out, ChunkInfo& info);
+
+  /// Decode a block of `n` values produced by `encode`.
+  void decode(const char * buf, const ChunkInfo& info, size_t n, int64_t * out);
+
+  /// Write `nrows` rows of `ncols` int64 fields (row-major) as a columnar file.
+  void write(const std::string& path, const int64_t * rows, uint64_t nrows,
+             uint64_t ncols, uint64_t rows_per_chunk = 1<<16);
+
+  /// Convert a row-binary relation file (as written by convert2bin or
+  /// writeTuplesUnordered) to a columnar file, one chunk at a time.
+  void convert(const std::string& binpath, const std::string& colpath,
+               uint64_t ncols, uint64_t rows_per_chunk = 1<<16);
+
+  /// Reads the header and footer of a columnar file; column blocks are read
+  /// on demand.
+  class Reader {
+    std::ifstream file;
+    Header header;
+    std::vector<ChunkInfo> footer;
+    std::vector<char> buf;
+
+  public:
+    explicit Reader(const std::string& path);
+
+    uint64_t ncols() const { return header.ncols; }
+    uint64_t nrows() const { return header.nrows; }
+    uint64_t nchunks() const { return footer.size() / header.ncols; }
+
+    uint64_t chunk_start(uint64_t k) const { return k * header.rows_per_chunk; }
+    uint64_t chunk_rows(uint64_t k) const {
+      return std::min(header.nrows - chunk_start(k), header.rows_per_chunk);
+    }
+
+    const ChunkInfo& info(uint64_t k, uint64_t c) const { return footer[k*header.ncols + c]; }
+
+    /// False if the min/max statistics show no row of chunk `k` can satisfy
+    /// all of `ranges`.
+    bool may_match(uint64_t k, const ColumnRange * ranges, size_t nranges) const;
+
+    /// Read and decode column `c` of chunk `k` into `out` (chunk_rows(k) values).
+    void read(uint64_t k, uint64_t c, int64_t * out);
+  };
+
+} // namespace columnar
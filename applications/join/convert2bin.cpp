@@ -3,15 +3,25 @@
 int main(int argc, char** argv) {
 
   if (argc < 5) {
-    std::cerr << "Usage: " << argv[0] << " FILE TYPE{i,d} SEPS BURNS" << std::endl;
+    std::cerr << "Usage: " << argv[0] << " FILE TYPE{i,d} SEPS BURNS [COLUMNAR_CHUNK_ROWS]" << std::endl;
     exit(1);
   }
   
+  int64_t ncols = 0;
   if (strncmp(argv[2], "i", 1) == 0) {
-    convert2bin<int64_t,decltype(&toInt)>( argv[1], &toInt, argv[3], atoi(argv[4]) );
+    ncols = convert2bin<int64_t,decltype(&toInt)>( argv[1], &toInt, argv[3], atoi(argv[4]) );
   } else if (strncmp(argv[2], "d", 1) == 0) {
-    convert2bin<double,decltype(&toDouble)>( argv[1], &toDouble, argv[3], atoi(argv[4]) );
+    ncols = convert2bin<double,decltype(&toDouble)>( argv[1], &toDouble, argv[3], atoi(argv[4]) );
   } else {
     std::cerr << "unrecognized type " << argv[2] << std::endl;
+    exit(1);
+  }
+
+  // optionally also write the columnar format
+  if (argc > 5) {
+    std::string binpath = std::string(argv[1])+".bin";
+    std::string colpath = std::string(argv[1])+".col";
+    columnar::convert( binpath, colpath, ncols, atoi(argv[5]) );
+    std::cout << "columnar: " << colpath << std::endl;
   }
 }
@@ -15,6 +15,7 @@ namespace fs = boost::filesystem;
 #include <ParallelLoop.hpp>
 #include "Tuple.hpp"
 #include "relation.hpp"
+#include "columnar.hpp"
 
 #include "grappa/graph.hpp"
 
@@ -210,6 +211,97 @@ Relation<T> readTuplesUnordered( std::string fn ) {
   return r;
 }
 
+/// Read some columns of a relation in the columnar format (see columnar.hpp);
+/// field j of each tuple gets column `columns[j]` of the file, so only those
+/// columns are read from disk.
+/// Chunks whose min/max statistics show they cannot satisfy all of `ranges`
+/// are skipped; rows of the remaining chunks are not filtered.
+// assumes that for object T, the address of T is the address of its fields
+template <typename T>
+size_t readTuplesColumnar( std::string fn, GlobalAddress<T> * buf_addr,
+                           std::vector<int> columns,
+                           std::vector<columnar::ColumnRange> ranges = {} ) {
+  const int max_columns = 32, max_ranges = 8;
+  std::string data_path = FLAGS_relations+"/"+fn;
+  CHECK( columns.size() > 0 && columns.size() <= max_columns );
+  CHECK( columns.size() * sizeof(int64_t) <= sizeof(T) );
+  CHECK( ranges.size() <= max_ranges );
+
+  columnar::Reader meta( data_path );
+  for (auto c : columns) CHECK( c >= 0 && c < meta.ncols() ) << fn << " has no column " << c;
+  for (auto& r : ranges) CHECK( r.column >= 0 && r.column < meta.ncols() ) << fn << " has no column " << r.column;
+
+  size_t ntuples = 0, skipped = 0;
+  for (uint64_t k = 0; k < meta.nchunks(); k++) {
+    if (meta.may_match(k, ranges.data(), ranges.size())) ntuples += meta.chunk_rows(k);
+    else skipped++;
+  }
+  VLOG(1) << fn << " has " << meta.nrows() << " rows; reading " << ntuples
+          << " after skipping " << skipped << " of " << meta.nchunks() << " chunks";
+
+  auto tuples = Grappa::global_alloc<T>(ntuples);
+
+  size_t offset_counter = 0;
+  auto offset_counter_addr = make_global( &offset_counter, Grappa::mycore() );
+
+  // we will broadcast the file name, columns and ranges as bytes
+  CHECK( data_path.size() <= 2040 );
+  char data_path_char[2048];
+  sprintf(data_path_char, "%s", data_path.c_str());
+  int ncols = columns.size(), nranges = ranges.size();
+  int cols[max_columns];
+  columnar::ColumnRange rngs[max_ranges];
+  std::copy(columns.begin(), columns.end(), cols);
+  std::copy(ranges.begin(), ranges.end(), rngs);
+
+  on_all_cores( [=] {
+    // find my array split
+    auto local_start = tuples.localize();
+    auto local_end = (tuples+ntuples).localize();
+    size_t local_count = local_end - local_start;
+
+    // reserve a range of the selected rows
+    int64_t offset = Grappa::delegate::fetch_and_add( offset_counter_addr, local_count );
+    int64_t end = offset + local_count;
+
+    columnar::Reader reader( data_path_char );
+    std::vector<int64_t> column;
+    int64_t row = 0; // position of chunk k among the selected rows
+    for (uint64_t k = 0; k < reader.nchunks() && row < end; k++) {
+      if (!reader.may_match(k, rngs, nranges)) continue;
+      int64_t n = reader.chunk_rows(k);
+      int64_t lo = std::max(offset, row), hi = std::min(end, row + n);
+      if (lo < hi) {
+        column.resize(n);
+        for (int j = 0; j < ncols; j++) {
+          reader.read(k, cols[j], &column[0]);
+          for (int64_t i = lo; i < hi; i++) {
+            reinterpret_cast<int64_t*>(&local_start[i - offset])[j] = column[i - row];
+          }
+        }
+      }
+      row += n;
+    }
+  });
+
+  *buf_addr = tuples;
+  return ntuples;
+}
+
+// convenient version for Relation<T> type
+template <typename T>
+Relation<T> readTuplesColumnar( std::string fn, std::vector<int> columns,
+                                std::vector<columnar::ColumnRange> ranges = {} ) {
+  GlobalAddress<T> tuples;
+
+  T sample;
+  CHECK( reinterpret_cast<char*>(&sample._fields) == reinterpret_cast<char*>(&sample) ) << "IO assumes _fields is the first field, but it is not for T";
+
+  auto ntuples = readTuplesColumnar<T>( fn, &tuples, columns, ranges );
+  Relation<T> r = { tuples, ntuples };
+  return r;
+}
+
 // assumes that for object T, the address of T is the address of its fields
 template <typename T>
 void writeTuplesUnordered(std::vector<T> * vec, std::string fn ) {
@@ -262,8 +354,9 @@ double toDouble(std::string& s) {
   return std::stod(s);
 }
 #include <boost/tokenizer.hpp>
+/// @return number of columns
 template< typename N=int64_t, typename Parser=decltype(toInt) >
-void convert2bin( std::string fn, Parser parser=&toInt, char * separators=" ", uint64_t burn=0 ) {
+int64_t convert2bin( std::string fn, Parser parser=&toInt, char * separators=" ", uint64_t burn=0 ) {
   std::ifstream infile(fn, std::ifstream::in);
   CHECK( infile.is_open() ) << fn << " failed to open";
   
@@ -311,7 +404,7 @@ void convert2bin( std::string fn, Parser parser=&toInt, char * separators=" ", u
   std::cout << "binary: " << outpath << std::endl;
   std::cout << "rows: " << linenum << std::endl;
   std::cout << "cols: " << expected_numcols << std::endl;
-
+  return expected_numcols;
 }
   
   
@@ -105,50 +105,35 @@ void SquarePartitionBushy4way::execute(std::vector<tuple_graph> relations) {
       const int64_t dst = dest;
 
       VLOG(5) << "replicating edge " << src << "," << dst;
+      Edge e(src, dst);
 
       // a->b
       auto locs_ab = h.slice( {hf(src), hf(dst), HypercubeSlice::ALL, HypercubeSlice::ALL} );
-      for (auto l : locs_ab) {
-      Edge e(src, dst);
-      delegate::call<async>( l, [e] { 
-        localAssignedEdges_R1.push_back(e); 
+      edgesSent += delegate::multicast( locs_ab, [e] {
+        localAssignedEdges_R1.push_back(e);
         VLOG(5) << "received " << e << " as a->b";
-        });
-      edgesSent++;
-      }
+      });
 
       // b->c
       auto locs_bc = h.slice( {HypercubeSlice::ALL, hf(src), hf(dst), HypercubeSlice::ALL} );
-      for (auto l : locs_bc) {
-        Edge e(src, dst);
-        delegate::call<async>( l, [e] { 
-            localAssignedEdges_R2.push_back(e); 
-            VLOG(5) << "received " << e << " as b->c";
-            });
-        edgesSent++;
-      }
+      edgesSent += delegate::multicast( locs_bc, [e] {
+        localAssignedEdges_R2.push_back(e);
+        VLOG(5) << "received " << e << " as b->c";
+      });
 
       // c->d
       auto locs_cd = h.slice( {HypercubeSlice::ALL, HypercubeSlice::ALL, hf(src), hf(dst)} );
-      for (auto l : locs_cd) {
-        Edge e(src, dst);
-        delegate::call<async>( l, [e] { 
-            localAssignedEdges_R3.push_back(e); 
-            VLOG(5) << "received " << e << " as c->d";
-            });
-        edgesSent++;
-      }
+      edgesSent += delegate::multicast( locs_cd, [e] {
+        localAssignedEdges_R3.push_back(e);
+        VLOG(5) << "received " << e << " as c->d";
+      });
 
       // d->a
       auto locs_da = h.slice( {hf(dst), HypercubeSlice::ALL, HypercubeSlice::ALL, hf(src)} );
-      for (auto l : locs_da) {
-        Edge e(src, dst);
-        delegate::call<async>( l, [e] { 
-            localAssignedEdges_R4.push_back(e); 
-            VLOG(5) << "received " << e << " as d->a";
-            });
-        edgesSent++;
-      }
+      edgesSent += delegate::multicast( locs_da, [e] {
+        localAssignedEdges_R4.push_back(e);
+        VLOG(5) << "received " << e << " as d->a";
+      });
       }
   });
   on_all_cores([] { 
@@ -212,13 +212,13 @@ void triangles( GlobalAddress<Tuple> tuples, size_t num_tuples, Column ji1, Colu
 
   start = Grappa::walltime();
   VLOG(1) << "Starting 1st join";
+#if SORTED_KEYS
   forall( tuples, num_tuples, [](int64_t i, Tuple& t) {
     int64_t key = t.columns[local_join1Right];
    
     // will pass on this first vertex to compare in the select 
     int64_t x1 = t.columns[local_join1Left];
 
-#if SORTED_KEYS
     // first join
     uint64_t results_idx;
     size_t num_results = joinTable.lookup( key, &results_idx );
@@ -231,19 +231,6 @@ void triangles( GlobalAddress<Tuple> tuples, size_t num_tuples, Column ji1, Colu
     forall_here<unbound,async>(results_idx, num_results, [x1](int64_t start, int64_t iters) {
       Tuple subset_stor[iters];
       Incoherent<Tuple>::RO subset( IndexBase+start, iters, &subset_stor );
-#else // MATCHES_DHT
-    // first join
-    GlobalAddress<Tuple> results_addr;
-    size_t num_results = joinTable.lookup( key, &results_addr );
-    
-    // iterate over the first join results in parallel
-    // (iterations must spawn with synch object `local_gce`)
-    /* not yet supported: forall_here<unbound,async, GCE=&local_gce >( 0, num_results, [x1,results_addr](int64_t start, int64_t iters) { */
-    edges_transfered += num_results;
-    forall_here<async>( 0, num_results, [x1,results_addr](int64_t start, int64_t iters) { 
-      Tuple subset_stor[iters];
-      Incoherent<Tuple>::RO subset( results_addr+start, iters, subset_stor );
-#endif
 
       //local_first_join_results+=iters;
       first_join_count+=iters;
@@ -256,7 +243,6 @@ void triangles( GlobalAddress<Tuple> tuples, size_t num_tuples, Column ji1, Colu
         if ( x1 < x2 ) {  // early select on ordering
           first_join_select_count+=1; // count after select
 
-#if SORTED_KEYS
           // second join
           uint64_t results_idx;
           size_t num_results = joinTable.lookup( key, &results_idx );
@@ -266,24 +252,9 @@ void triangles( GlobalAddress<Tuple> tuples, size_t num_tuples, Column ji1, Colu
           // iterate over the second join results in parallel
           // (iterations must spawn with synch object `local_gce`)
           edges_transfered += num_results;
-          forall_here<unbound,async>(results_idx, num_results, [x1](int64_t start, int64_t iters) {
+          forall_here<unbound,async>(results_idx, num_results, [x1,x2](int64_t start, int64_t iters) {
             Tuple subset_stor[iters];
             Incoherent<Tuple>::RO subset( IndexBase+start, iters, subset_stor );
-#else // MATCHES_DHT
-          // second join
-          GlobalAddress<Tuple> results_addr;
-          size_t num_results = joinTable.lookup( key, &results_addr );
-
-          VLOG(5) << "results key " << key << " (n=" << num_results;
-          
-          // iterate over the second join results in parallel
-          // (iterations must spawn with synch object `local_gce`)
-          /* not yet supported: forall_here<unbound,async, GCE=&local_gce >( 0, num_results, [x1,results_addr](int64_t start, int64_t iters) { */
-          edges_transfered += num_results;
-          forall_here<async>( 0, num_results, [x1,x2,results_addr](int64_t start, int64_t iters) {
-            Tuple subset_stor[iters];
-            Incoherent<Tuple>::RO subset( results_addr+start, iters, subset_stor );
-#endif
             second_join_count += iters;
 
             for ( int64_t i=0; i<iters; i++ ) {
@@ -303,6 +274,67 @@ void triangles( GlobalAddress<Tuple> tuples, size_t num_tuples, Column ji1, Colu
       } // (end loop body for over 1st join results)
     }); // end loop over 1st join results
   }); // end outer loop over tuples
+#else // MATCHES_DHT
+  // Probe in batches rather than one lookup per tuple: each core takes a
+  // chunk of its tuples and probes all their keys with lookup_batch (keys
+  // travel to their owners in packed messages), keeps the first join's
+  // results that pass the early select, then probes their keys the same way
+  // for the second join.
+  on_all_cores( [tuples, num_tuples] {
+    // a first join result that passed the early select
+    struct Path { int64_t x1, x2, key; };
+    
+    Tuple * local_start = tuples.localize();
+    Tuple * local_end = (tuples+num_tuples).localize();
+    std::vector<int64_t> keys;
+    std::vector<Path> paths;
+    
+    for ( Tuple * t = local_start; t < local_end; t += impl::BULK_CHUNK ) {
+      size_t nt = std::min<size_t>( impl::BULK_CHUNK, local_end - t );
+      keys.resize( nt );
+      for ( size_t i=0; i<nt; i++ ) keys[i] = t[i].columns[local_join1Right];
+      
+      // first join
+      paths.clear();
+      joinTable.lookup_batch( keys.data(), nt, [t,&paths](uint32_t i, Tuple& match) {
+        // will pass on this first vertex to compare in the select 
+        int64_t x1 = t[i].columns[local_join1Left];
+        int64_t x2 = match.columns[0];
+        edges_transfered++;
+        first_join_count++;
+        VLOG(5) << "COMPARING x1=" << x1 << " < x2=" << x2; 
+        
+        if ( x1 < x2 ) {  // early select on ordering
+          first_join_select_count+=1; // count after select
+          paths.push_back( Path{ x1, x2, match.columns[local_join2Right] } );
+        } // end select 1
+      });
+      
+      // second join
+      for ( size_t k=0; k<paths.size(); k+=impl::BULK_CHUNK ) {
+        size_t np = std::min<size_t>( impl::BULK_CHUNK, paths.size()-k );
+        keys.resize( np );
+        for ( size_t j=0; j<np; j++ ) keys[j] = paths[k+j].key;
+        
+        Path * p = &paths[k];
+        joinTable.lookup_batch( keys.data(), np, [p](uint32_t j, Tuple& match) {
+          edges_transfered++;
+          second_join_count++;
+          int64_t r = match.columns[0];
+          if ( p[j].x2 < r ) {  // select on ordering 
+            second_join_select_count+=1;
+            if ( match.columns[local_select] == p[j].x1 ) { // select on triangle
+              if (FLAGS_print) {
+                VLOG(1) << p[j].x1 << " " << p[j].x2 << " " << r;
+              }
+              triangle_count++;
+            }
+          } // end select 2
+        });
+      }
+    }
+  });
+#endif
          
   
   end = Grappa::walltime();
@@ -147,48 +147,37 @@ void triangles(GlobalAddress<Graph<Vertex>> g) {
       
       const int64_t from = i;
       const int64_t to = dst;
+      Edge e(from, to);
 
       // x-y
       auto locs_xy = Loc3d(sidelength, hf(from), hf(to), Loc3d::ALL);    
-      for (auto l : locs_xy) {
-        Edge e(from, to);
-        delegate::call<async>( l, [e] { 
+      edgesSent += delegate::multicast( locs_xy, [e] {
 #if DIFFERENT_RELATIONS
-          localAssignedEdges_R1.push_back(e); 
+        localAssignedEdges_R1.push_back(e);
 #else
-          localAssignedEdges_R1.push_back(e);
+        localAssignedEdges_R1.push_back(e);
 #endif
-        });
-        edgesSent++;
-      }
+      });
 
       // y-z
       auto locs_yz = Loc3d(sidelength, Loc3d::ALL, hf(from), hf(to));
-      for (auto l : locs_yz) {
-        Edge e(from, to);
-        delegate::call<async>( l, [e] { 
+      edgesSent += delegate::multicast( locs_yz, [e] {
 #if DIFFERENT_RELATIONS
-          localAssignedEdges_R2.push_back(e); 
+        localAssignedEdges_R2.push_back(e);
 #else
-          localAssignedEdges_R1.push_back(e);
+        localAssignedEdges_R1.push_back(e);
 #endif
-        });
-        edgesSent++;
-      }
+      });
 
       // z-x
       auto locs_zx = Loc3d(sidelength, hf(to), Loc3d::ALL, hf(from));
-      for (auto l : locs_zx) {
-        Edge e(from, to);
-        delegate::call<async>( l, [e] { 
+      edgesSent += delegate::multicast( locs_zx, [e] {
 #if DIFFERENT_RELATIONS
-          localAssignedEdges_R3.push_back(e); 
+        localAssignedEdges_R3.push_back(e);
 #else
-          localAssignedEdges_R1.push_back(e);
+        localAssignedEdges_R1.push_back(e);
 #endif
-        });
-        edgesSent++;
-      }
+      });
     }
   });
   on_all_cores([] { 
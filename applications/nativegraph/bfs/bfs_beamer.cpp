@@ -49,6 +49,13 @@ DEFINE_double(beamer_alpha, 20.0,
 DEFINE_double(beamer_beta, 20.0,
   "Beamer BFS parameter (specifies when to switch back to top-down)");
 
+DEFINE_bool(bottom_up_bitmap, false,
+  "Bottom-up levels check neighbors against a bitmap of the frontier replicated "
+  "on every core (nv/8 bytes per core), instead of messaging each neighbor");
+
+DEFINE_bool(bfs_level_regions, false,
+  "Record metric deltas for each BFS level (see Metrics::print_regions)");
+
 GRAPPA_DECLARE_METRIC(SummarizingMetric<double>, bfs_mteps);
 GRAPPA_DECLARE_METRIC(SummarizingMetric<double>, total_time);
 GRAPPA_DECLARE_METRIC(SimpleMetric<int64_t>, bfs_nedge);
@@ -66,6 +73,22 @@ GlobalCompletionEvent phaser;
 
 Reducer<int64_t,ReducerType::Add> edge_count;
 
+/// bit per vertex, set for vertices in the current frontier (same on all cores)
+std::vector<uint64_t> frontier_bits;
+
+/// Replicate the current frontier as a bitmap on every core: each core sets
+/// the bits of the frontier vertices it holds, then one allreduce ORs them.
+void build_frontier_bitmap() {
+  int64_t nwords = (g->nv + 63) / 64;
+  call_on_all_cores([nwords]{ frontier_bits.assign(nwords, 0); });
+  forall(frontier, [](VertexID& i){
+    frontier_bits[i / 64] |= 1UL << (i % 64);
+  });
+  on_all_cores([nwords]{
+    allreduce_inplace<uint64_t,collective_bor>(frontier_bits.data(), nwords);
+  });
+}
+
 void bfs(GlobalAddress<G> _g, int nbfs, TupleGraph tg) {
   bool verified = false;
   double t;
@@ -109,9 +132,13 @@ void bfs(GlobalAddress<G> _g, int nbfs, TupleGraph tg) {
     int64_t prev_nf = -1;
     int64_t frontier_edges = 0;
     int64_t remaining_edges = g->nadj;
+    int64_t level = 0; // (current_depth is not reset between roots)
     
     while (!frontier->empty()) {
       
+      MetricsRegion level_region("bfs" + std::to_string(root_idx) + "_level" + std::to_string(level),
+                                 FLAGS_bfs_level_regions);
+      
       auto nf = frontier->size();
       VLOG(1) << "remaining_edges = " << remaining_edges << ", nf = " << nf << ", prev_nf = " << prev_nf << ", frontier_edges: " ;
       if (top_down && frontier_edges > remaining_edges/FLAGS_beamer_alpha && nf > prev_nf) {
@@ -148,6 +175,25 @@ void bfs(GlobalAddress<G> _g, int nbfs, TupleGraph tg) {
             });
           });
         });
+      } else if (FLAGS_bottom_up_bitmap) { // bottom-up, against replicated frontier
+        
+        build_frontier_bitmap();
+        
+        // every check is local, so the only communication is building the bitmap
+        forall(g, [](G::Vertex& v){
+          if (v->level != -1) return;
+          for (int64_t k = 0; k < v.nadj; k++) {
+            auto j = v.local_adj[k];
+            if (frontier_bits[j / 64] & (1UL << (j % 64))) {
+              next->add(g->id(v));
+              v->level = current_depth;
+              v->parent = j;
+              edge_count += v.nadj;
+              break;
+            }
+          }
+        });
+        
       } else { // bottom-up
         
         forall<&phaser>(g, [](G::Vertex& v){
@@ -186,6 +232,7 @@ void bfs(GlobalAddress<G> _g, int nbfs, TupleGraph tg) {
         std::swap(frontier, next);
       });
       next->clear();
+      level++;
       frontier_edges = edge_count;
       remaining_edges -= frontier_edges;
       prev_nf = nf;
@@ -208,4 +255,8 @@ void bfs(GlobalAddress<G> _g, int nbfs, TupleGraph tg) {
     
     bfs_mteps += bfs_nedge / this_bfs_time / 1.0e6;
   }
+  
+  if (FLAGS_bottom_up_bitmap) {
+    call_on_all_cores([]{ std::vector<uint64_t>().swap(frontier_bits); });
+  }
 }
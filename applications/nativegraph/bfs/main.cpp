@@ -78,6 +78,7 @@ int main(int argc, char* argv[]) {
     
     LOG(INFO) << "\n" << bfs_nedge << "\n" << total_time << "\n" << bfs_mteps;
     if (FLAGS_metrics) Metrics::merge_and_print();
+    if (!MetricsRegion::results().empty()) Metrics::print_regions();
     Metrics::merge_and_dump_to_file();
   });
   finalize();
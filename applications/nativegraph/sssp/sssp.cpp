@@ -9,6 +9,8 @@ DEFINE_bool(metrics, false, "Dump metrics");
 DEFINE_int32(scale, 10, "Log2 number of vertices.");
 DEFINE_int32(edgefactor, 16, "Average number of edges per vertex.");
 DEFINE_int64(root, 16, "Average number of edges per vertex.");
+DEFINE_string(path, "", "Path to graph source file (weights are taken from it if it has them).");
+DEFINE_string(format, "bintsv4", "Format of graph source file.");
 
 using namespace Grappa;
 
@@ -95,11 +97,24 @@ int main(int argc, char* argv[]) {
     
     t = walltime();
 
-    // generate "NE" edge tuples, sampling vertices using the
-    // Graph500 Kronecker generator to get a power-law graph
-    auto tg = TupleGraph::Kronecker(FLAGS_scale, NE, 111, 222);
+    TupleGraph tg;
+    if (FLAGS_path.empty()) {
+      // generate "NE" edge tuples, sampling vertices using the
+      // Graph500 Kronecker generator to get a power-law graph
+      tg = TupleGraph::Kronecker(FLAGS_scale, NE, 111, 222);
+      
+      // with random weights, carried into the graph's edge data
+      forall(tg.edges, tg.nedge, [](TupleGraph::Edge& e){
+        double w = drand48();
+        std::memcpy(&e.data, &w, sizeof(w));
+      });
+      tg.has_data = true;
+    } else {
+      LOG(INFO) << "loading " << FLAGS_path;
+      tg = TupleGraph::Load(FLAGS_path, FLAGS_format);
+    }
 
-    // create graph with incorporated Vertex
+    // create graph with incorporated Vertex (and weighted edges)
     auto g = G::Undirected( tg );
     graph_create_time = (walltime()-t);
     
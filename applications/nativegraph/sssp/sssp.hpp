@@ -21,9 +21,20 @@ struct SSSPData {
 
 struct SSSPEdgeData {
   double weight;
-  SSSPEdgeData(): weight(drand48()) {}
+  SSSPEdgeData(): weight(drand48()) {}   // (for inputs without weights)
+  SSSPEdgeData(double weight): weight(weight) {}
 };
 
+namespace Grappa {
+  /// take edge weights from the TupleGraph's payload when it has one
+  template<> struct EdgePayload<SSSPEdgeData> {
+    static constexpr bool used = true;
+    static void init(SSSPEdgeData * e, const TupleGraph::Edge& te) {
+      new (e) SSSPEdgeData(te.weight());
+    }
+  };
+}
+
 using G = Graph<SSSPData,SSSPEdgeData>;
 
 template <typename G>
@@ -52,7 +63,7 @@ public:
 
     // SSSP distances verification
     forall(tg.edges, tg.nedge, [=](TupleGraph::Edge& e){
-      auto i = e.v0, j = e.v1;
+      auto i = g->relabel(e.v0), j = g->relabel(e.v1);
 
       /* Eliminate self loops from verification */
       if ( i == j)
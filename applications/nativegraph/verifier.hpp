@@ -70,7 +70,7 @@ public:
     // verify levels & parents match
     forall(tg.edges, tg.nedge, [=](TupleGraph::Edge& e){
       auto max_bfsvtx = g->nv - 1;
-      auto i = e.v0, j = e.v1;
+      auto i = g->relabel(e.v0), j = g->relabel(e.v1);
 
       int64_t lvldiff;
 
@@ -200,21 +200,19 @@ void bucket_sort(GlobalAddress<uint64_t> array, size_t nelems, size_t nbuckets)
   VLOG(3) << "scattering...";
       t = Grappa::walltime();
 
-  // scatter into buckets
-  // forall_local<uint64_t,scatter>(array, nelems);
-  forall(array, nelems, [bucketlist](int64_t s, int64_t n, uint64_t * first){
+  // scatter into buckets: shuffle each core's keys to the cores owning
+  // their buckets in bulk, then append them locally
+  on_all_cores([array,nelems,bucketlist]{
     size_t nbuckets = counts.size();
+    auto local = array.localize();
+    size_t nlocal = (array+nelems).localize() - local;
     
-    for (int i=0; i<n; i++) {
-      auto v = first[i];
+    auto mine = shuffle(local, nlocal, [bucketlist,nbuckets](const uint64_t& v){
       size_t b = v >> LOBITS;
       CHECK( b < nbuckets ) << "bucket id = " << b << ", nbuckets = " << nbuckets;
-      // ff_delegate<bucket_t,uint64_t,ff_append>(bucketlist+b, v);
-      auto destb = bucketlist+b;
-      delegate::call<async>(destb.core(), [destb,v]{
-        destb.pointer()->append(v);
-      });
-    }
+      return (bucketlist+b).core();
+    });
+    for (auto v : mine) (bucketlist + (v >> LOBITS)).pointer()->append(v);
   });
     
   scatter_time = Grappa::walltime() - t;
@@ -207,15 +207,25 @@ public:
 
   /// Allocate size bytes
   void * malloc( size_t size ) {
+    void * result = NULL;
+    if( !try_malloc( size, &result ) ) {
+      LOG(ERROR) << "Out of memory in the global heap: couldn't find a chunk of size " << next_largest_power_of_2( size )
+                 << " to hold an allocation of " << size << " bytes. Can you increase --global_heap_fraction?";
+      // do this with an exception rather than CHECK_NE() so the test fixture can catch it.
+      throw Allocator::Exception();
+    }
+    return result;
+  }
+
+  /// Allocate size bytes into *result, or return false if no free chunk is
+  /// large enough.
+  bool try_malloc( size_t size, void ** result ) {
     int64_t allocation_size = next_largest_power_of_2( size );
 
     // find a chunk large enough to start splitting.
     FreeListMap::iterator flit = free_lists_.lower_bound( allocation_size );
     if( flit == free_lists_.end() ) {
-      LOG(ERROR) << "Out of memory in the global heap: couldn't find a chunk of size " << allocation_size
-                 << " to hold an allocation of " << size << " bytes. Can you increase --global_heap_fraction?";
-      // do this with an exception rather than CHECK_NE() so the test fixture can catch it.
-      throw Allocator::Exception();
+      return false;
     }
 
     int64_t chunk_size = flit->first;
@@ -249,7 +259,14 @@ public:
     // finally we have a chunk of the right size
     cmit->second.in_use = true;
     remove_from_free_list( cmit );
-    return reinterpret_cast< void * >( cmit->second.address + base_ );
+    *result = reinterpret_cast< void * >( cmit->second.address + base_ );
+    return true;
+  }
+
+  /// does this allocator manage the address?
+  bool contains( const void * address ) const {
+    AllocatorAddress a = reinterpret_cast< AllocatorAddress >( address );
+    return a >= base_ && a < base_ + static_cast< AllocatorAddress >( size_ );
   }
 
 
@@ -290,6 +307,18 @@ public:
     return total;
   }
 
+  int64_t num_free_chunks() const {
+    int64_t total = 0;
+    for( FreeListMap::const_iterator i = free_lists_.begin(); i != free_lists_.end(); ++i ) {
+      total += i->second.size();
+    }
+    return total;
+  }
+
+  int64_t largest_free_chunk() const {
+    return free_lists_.empty() ? 0 : free_lists_.rbegin()->first;
+  }
+
   /// output human-readable state
   std::ostream & dump( std::ostream& o = std::cout ) const {
     o << "all chunks = {" << std::endl;
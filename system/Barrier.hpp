@@ -27,10 +27,57 @@
 #include "Communicator.hpp"
 #include "CommunicatorImpl.hpp"
 
+#include <memory>
+
 namespace Grappa {
   /// @addtogroup Synchronization
   /// @{
   
+  /// Handle for a non-blocking collective (ibarrier(), iallreduce(), ...).
+  /// The calling core keeps running; `wait()` suspends only the waiting
+  /// task, which the communicator's poll wakes when the operation is done.
+  /// Buffers passed to the collective must stay valid until then.
+  ///
+  /// Waits in the destructor if the operation is still outstanding.
+  class CollectiveRequest {
+    struct State {
+      CommunicatorContext context;
+      CompletionEvent ce;
+      State(): ce(1) {}
+    };
+    std::unique_ptr<State> s;
+    
+  public:
+    CollectiveRequest(): s() {}
+    CollectiveRequest(CollectiveRequest&& r) = default;
+    CollectiveRequest& operator=(CollectiveRequest&& r) { wait(); s = std::move(r.s); return *this; }
+    ~CollectiveRequest() { wait(); }
+    
+    /// Start an operation (`f` is given the MPI_Request to start it on).
+    template< typename F >
+    static CollectiveRequest start(F f) {
+      CollectiveRequest r;
+      r.s.reset(new State);
+      r.s->context.buf = (void*) &r.s->ce;
+      r.s->context.callback = [] ( CommunicatorContext * c, int source, int tag, int received_size ) {
+        static_cast<CompletionEvent*>(c->buf)->complete();
+      };
+      global_communicator.with_request_do( &r.s->context, f );
+      return r;
+    }
+    
+    /// True once the operation has completed (never blocks).
+    bool done() const { return !s || s->ce.get_count() == 0; }
+    
+    /// Suspend the calling task until the operation completes.
+    void wait() {
+      if (s) {
+        s->ce.wait();
+        s.reset();
+      }
+    }
+  };
+  
   /// Blocking SPMD barrier (must be called once on all cores to continue)
   inline void barrier() {
     DVLOG(5) << "entering barrier";
@@ -39,5 +86,19 @@ namespace Grappa {
       } );
   }
   
+  /// Non-blocking SPMD barrier: completes once every core has called it.
+  ///
+  /// @b Example:
+  /// @code
+  ///   auto r = Grappa::ibarrier();
+  ///   do_local_work();
+  ///   r.wait();
+  /// @endcode
+  inline CollectiveRequest ibarrier() {
+    return CollectiveRequest::start( [] ( MPI_Request * request ) {
+        MPI_CHECK( MPI_Ibarrier( global_communicator.grappa_comm, request ) );
+      } );
+  }
+  
   /// @}
 }
@@ -0,0 +1,180 @@
+////////////////////////////////////////////////////////////////////////
+// This file is part of Grappa, a system for scaling irregular
+// applications on commodity clusters.
+
+// Copyright (C) 2010-2014 University of Washington and Battelle
+// Memorial Institute. University of Washington authorizes use of this
+// Grappa software.
+
+// Grappa is free software: you can redistribute it and/or modify it
+// under the terms of the Affero General Public License as published
+// by Affero, Inc., either version 1 of the License, or (at your
+// option) any later version.
+
+// Grappa is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// Affero General Public License for more details.
+
+// You should have received a copy of the Affero General Public
+// License along with this program. If not, you may obtain one from
+// http://www.affero.org/oagpl.html.
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Collective.hpp"
+#include "CompletionEvent.hpp"
+#include "LocaleSharedMemory.hpp"
+#include "Message.hpp"
+#include "Tasking.hpp"
+#include <vector>
+#include <memory>
+#include <cstring>
+
+namespace Grappa {
+namespace impl {
+
+/// Number of elements of a global array each core stages at a time in bulk operations.
+const size_t BULK_CHUNK = 1<<14;
+
+/// Range of `[0,n)` handled by this core in SPMD bulk operations.
+inline std::pair<size_t,size_t> bulk_range(size_t n) {
+  return std::make_pair(n*mycore()/cores(), n*(mycore()+1)/cores());
+}
+
+/// Counting sort of `n` requests by destination core into `sorted`
+/// (locale-shared, so it can be used as message payload).
+/// On return, requests for core `c` are in `sorted[offsets[c]..offsets[c+1])`,
+/// and `slot[i]` is the position request `i` was moved to.
+template< typename Req, typename Owner >
+void bulk_partition(const Req * reqs, size_t n, Owner owner, Req * sorted,
+                    std::vector<size_t>& offsets, std::vector<size_t>& slot) {
+  std::vector<Core> dest(n);
+  offsets.assign(cores()+1, 0);
+  for (size_t i=0; i<n; i++) {
+    dest[i] = owner(reqs[i]);
+    offsets[dest[i]+1]++;
+  }
+  for (Core c=0; c<cores(); c++) offsets[c+1] += offsets[c];
+
+  std::vector<size_t> pos(offsets.begin(), offsets.end()-1);
+  slot.resize(n);
+  for (size_t i=0; i<n; i++) {
+    slot[i] = pos[dest[i]]++;
+    sorted[slot[i]] = reqs[i];
+  }
+}
+
+/// Apply `apply(req)` to each of the `n` requests in `reqs` on core `owner(req)`.
+///
+/// Requests are grouped by destination and shipped as packed payload messages
+/// (at most MAX_MESSAGE_SIZE bytes each), so the destination runs `apply` over
+/// a whole message in one tight loop instead of one closure per request.
+/// Requests whose owner is this core are applied directly.
+///
+/// Req must be trivially copyable; `apply` must not block. Blocks the calling
+/// task until all requests have been applied.
+///
+/// @return number of messages sent
+template< typename Req, typename Owner, typename Apply >
+size_t bulk_apply(const Req * reqs, size_t n, Owner owner, Apply apply) {
+  if (n == 0) return 0;
+  const size_t per_msg = MAX_MESSAGE_SIZE / sizeof(Req);
+
+  Req * sorted = locale_alloc<Req>(n);
+  std::vector<size_t> offsets, slot;
+  bulk_partition(reqs, n, owner, sorted, offsets, slot);
+
+  size_t nmsg = 0;
+  for (Core c=0; c<cores(); c++) if (c != mycore()) {
+    size_t nc = offsets[c+1]-offsets[c];
+    nmsg += nc / per_msg + (nc % per_msg ? 1 : 0);
+  }
+
+  CompletionEvent ce(nmsg);
+  auto cea = make_global(&ce);
+
+  for (Core c=0; c<cores(); c++) {
+    if (c == mycore()) continue;
+    for (size_t k=offsets[c]; k<offsets[c+1]; k+=per_msg) {
+      size_t nk = std::min(per_msg, offsets[c+1]-k);
+      send_heap_message(c, [cea,apply](void * payload, size_t payload_size) {
+        auto r = static_cast<Req*>(payload);
+        auto nr = payload_size / sizeof(Req);
+        for (size_t i=0; i<nr; i++) apply(r[i]);
+        complete(cea);
+      }, sorted+k, sizeof(Req)*nk);
+    }
+  }
+
+  for (size_t k=offsets[mycore()]; k<offsets[mycore()+1]; k++) apply(sorted[k]);
+
+  ce.wait();
+  locale_free(sorted);
+  return nmsg;
+}
+
+/// Like bulk_apply, but `apply(req)` returns a result (trivially copyable
+/// type Rep) which is sent back in packed reply messages and stored in
+/// `reps[i]` for request `reqs[i]`.
+///
+/// @return number of request messages sent
+template< typename Req, typename Rep, typename Owner, typename Apply >
+size_t bulk_apply(const Req * reqs, Rep * reps, size_t n, Owner owner, Apply apply) {
+  if (n == 0) return 0;
+  const size_t per_msg = MAX_MESSAGE_SIZE / std::max(sizeof(Req), sizeof(Rep));
+
+  Req * sorted = locale_alloc<Req>(n);
+  std::unique_ptr<Rep[]> sorted_reps(new Rep[n]);
+  std::vector<size_t> offsets, slot;
+  bulk_partition(reqs, n, owner, sorted, offsets, slot);
+
+  size_t nmsg = 0;
+  for (Core c=0; c<cores(); c++) if (c != mycore()) {
+    size_t nc = offsets[c+1]-offsets[c];
+    nmsg += nc / per_msg + (nc % per_msg ? 1 : 0);
+  }
+
+  CompletionEvent ce(nmsg);
+  auto cea = make_global(&ce);
+
+  for (Core c=0; c<cores(); c++) {
+    if (c == mycore()) continue;
+    for (size_t k=offsets[c]; k<offsets[c+1]; k+=per_msg) {
+      size_t nk = std::min(per_msg, offsets[c+1]-k);
+      Rep * out = &sorted_reps[k];
+      send_heap_message(c, [cea,out,apply](void * payload, size_t payload_size) {
+        auto r = static_cast<Req*>(payload);
+        auto nr = payload_size / sizeof(Req);
+
+        Rep * results = locale_alloc<Rep>(nr);
+        for (size_t i=0; i<nr; i++) results[i] = apply(r[i]);
+
+        // reply from a task so the payload can be freed once it has been sent
+        spawn([cea,out,results,nr]{
+          {
+            auto m = send_message(cea.core(), [cea,out](void * payload, size_t payload_size) {
+              std::memcpy(out, payload, payload_size);
+              complete(cea);
+            }, results, sizeof(Rep)*nr);
+          }
+          locale_free(results);
+        });
+      }, sorted+k, sizeof(Req)*nk);
+    }
+  }
+
+  for (size_t k=offsets[mycore()]; k<offsets[mycore()+1]; k++) {
+    sorted_reps[k] = apply(sorted[k]);
+  }
+
+  ce.wait();
+  for (size_t i=0; i<n; i++) reps[i] = sorted_reps[slot[i]];
+
+  locale_free(sorted);
+  return nmsg;
+}
+
+} // namespace impl
+} // namespace Grappa
@@ -115,6 +115,11 @@ namespace Grappa {
     }
     
     virtual void merge_all(impl::MetricBase* static_stat_ptr);
+
+    virtual bool numeric_value(double * out) const {
+      *out = static_cast<double>(value());
+      return true;
+    }
   
     };
     /// @}
@@ -31,8 +31,10 @@
 #include "CountingSemaphoreLocal.hpp"
 #include "Barrier.hpp"
 #include "MessagePool.hpp"
+#include "LocaleSharedMemory.hpp"
 
 #include <functional>
+#include <limits>
 #include <algorithm>
 
 // TODO/FIXME: use actual max message size (have Communicator be able to tell us)
@@ -192,123 +194,362 @@ namespace Grappa {
   
   namespace impl {
     
-    template<typename T>
-    struct Reduction {
-      static FullEmpty<T> result;
-    };
-    template<typename T> FullEmpty<T> Reduction<T>::result;
+    /// Core that combines its locale's contributions in the hierarchical
+    /// collectives (cores are numbered contiguously within a locale).
+    inline Core locale_leader(Locale l) { return l * locale_cores(); }
+    
+    /// Largest power of two <= n.
+    inline Locale pow2_below(Locale n) {
+      Locale p = 1;
+      while (2*p <= n) p *= 2;
+      return p;
+    }
+    
+    inline int log2_exact(Locale p2) {
+      int r = 0;
+      while ((Locale(1) << r) < p2) r++;
+      return r;
+    }
     
+    template< typename T >
+    inline size_t elems_per_msg() { return std::max<size_t>(1, MAX_MESSAGE_SIZE / sizeof(T)); }
+    
+    inline size_t nchunks(size_t n, size_t per) { return (n + per - 1) / per; }
+    
+    /// State for the scalar allreduce. Values are combined within each
+    /// locale at its leader, then across leaders by recursive doubling;
+    /// locales beyond the largest power of two first fold into a partner
+    /// and get the result back from it.
+    ///
+    /// Each FullEmpty is written once per call. A leader can only run one
+    /// call ahead of its partners, so the doubling rounds alternate between
+    /// two sets of slots; everything else is ordered by the call itself.
     template< typename T, T (*ReduceOp)(const T&, const T&) >
-    void collect_reduction(const T& val) {
-      static T total;
-      static Core cores_in = 0;
+    struct TreeReduction {
+      T peer_total;              ///< leader: combined values of the rest of the locale
+      Core peers_in;
+      int phase;                 ///< leader: which set of round slots this call uses
+      FullEmpty<T> peers;        ///< leader: full once all peers have contributed
+      FullEmpty<T> fold;         ///< leader: value folded in from an extra locale
+      FullEmpty<T> rounds[2][32];///< leader: partner's value in each doubling round
+      FullEmpty<T> result;
       
-      DCHECK(mycore() == HOME_CORE);
+      TreeReduction(): peers_in(0), phase(0) {}
       
-      if (cores_in == 0) {
-        total = val;
-      } else {
-        total = ReduceOp(total, val);
+      static TreeReduction& get() {
+        static TreeReduction r;
+        return r;
       }
       
-      cores_in++;
-      DVLOG(4) << "cores_in: " << cores_in;
+      void contribute(const T& val) {
+        peer_total = (peers_in == 0) ? val : ReduceOp(peer_total, val);
+        if (++peers_in == locale_cores()-1) {
+          peers_in = 0;
+          peers.writeXF(peer_total);
+        }
+      }
       
-      if (cores_in == cores()) {
-        cores_in = 0;
-        T tmp_total = total;
-        for (Core c = 0; c < cores(); c++) {
-          send_heap_message(c, [tmp_total] {
-            Reduction<T>::result.writeXF(tmp_total);
-          });
+      /// Called by locale leaders only.
+      T across_locales(T total) {
+        Locale me = mylocale(), p2 = pow2_below(locales());
+        
+        if (me >= p2) {
+          send_heap_message(locale_leader(me-p2), [total]{ get().fold.writeXF(total); });
+          return result.readFE();
+        }
+        if (me + p2 < locales()) total = ReduceOp(total, fold.readFE());
+        
+        int ph = phase;
+        phase ^= 1;
+        for (int r = 0; r < log2_exact(p2); r++) {
+          Locale partner = me ^ (Locale(1) << r);
+          send_heap_message(locale_leader(partner), [total,ph,r]{ get().rounds[ph][r].writeXF(total); });
+          T other = rounds[ph][r].readFE();
+          // same operand order on both sides so every core ends with identical bits
+          total = (me < partner) ? ReduceOp(total, other) : ReduceOp(other, total);
+        }
+        
+        if (me + p2 < locales()) {
+          send_heap_message(locale_leader(me+p2), [total]{ get().result.writeXF(total); });
         }
+        return total;
       }
-    }
+      
+      T call_allreduce(T myval) {
+        Core leader = locale_leader(mylocale());
+        if (mycore() != leader) {
+          send_heap_message(leader, [myval]{ get().contribute(myval); });
+          return result.readFE();
+        }
+        
+        T total = myval;
+        if (locale_cores() > 1) total = ReduceOp(total, peers.readFE());
+        if (locales() > 1) total = across_locales(total);
+        
+        for (Core c = leader+1; c < leader+locale_cores(); c++) {
+          send_heap_message(c, [total]{ get().result.writeXF(total); });
+        }
+        return total;
+      }
+    };
     
+    /// In-place allreduce of arrays. The array is reduce-scattered within
+    /// each locale so every core owns one slice, each slice is allreduced
+    /// by recursive doubling among the cores owning it in the other
+    /// locales, and the slices are allgathered within the locale again.
+    /// Each core sends O(nelem) elements in total, instead of HOME_CORE
+    /// sending O(nelem*cores).
     template<typename T, T (*ReduceOp)(const T&, const T&) >
     class InplaceReduction {
     protected:
-      CompletionEvent * ce;
+      enum Kind { PEER, FOLD, RESULT, GATHER, ROUND };
+      
       T * array;
-      Core elems_in = 0;
       size_t nelem;
-    public:      
+      size_t lo, len;         // my slice
+      std::vector<T> inbox;   // other locales' slices: fold, then one per round
+      CompletionEvent peers_ce, fold_ce, result_ce, gather_ce;
+      CompletionEvent rounds_ce[32];
+      
+      size_t slice_lo(Core q) const { return nelem * q / locale_cores(); }
+      size_t slice_len(Core q) const { return slice_lo(q+1) - slice_lo(q); }
+      
+      void receive(int kind, size_t k, const T * in, size_t n) {
+        switch (kind) {
+          case PEER:
+            for (size_t i=0; i<n; i++) array[k+i] = ReduceOp(array[k+i], in[i]);
+            peers_ce.complete();
+            break;
+          case FOLD:
+            std::copy(in, in+n, &inbox[k-lo]);
+            fold_ce.complete();
+            break;
+          case RESULT:
+            std::copy(in, in+n, array+k);
+            result_ce.complete();
+            break;
+          case GATHER:
+            std::copy(in, in+n, array+k);
+            gather_ce.complete();
+            break;
+          default:
+            std::copy(in, in+n, &inbox[(kind-ROUND+1)*len + k-lo]);
+            rounds_ce[kind-ROUND].complete();
+        }
+      }
+      
+      /// send array[k, k+n) to the same range on `dest`
+      void send(MessagePool& pool, Core dest, int kind, size_t k, size_t n) {
+        size_t per = elems_per_msg<T>();
+        for (size_t i=0; i<n; i+=per) {
+          size_t at = k+i;
+          pool.send_message(dest, [this,kind,at](void * payload, size_t payload_size) {
+            this->receive(kind, at, static_cast<T*>(payload), payload_size/sizeof(T));
+          }, (void*)(array+at), sizeof(T)*std::min(per, n-i));
+        }
+      }
+      
+    public:
       /// SPMD, must be called on static/file-global object on all cores
       /// blocks until reduction is complete
       void call_allreduce(T * in_array, size_t nelem) {
-        // setup everything (block to make sure HOME_CORE is done)
         this->array = in_array;
         this->nelem = nelem;
         
-        size_t n_per_msg = MAX_MESSAGE_SIZE / sizeof(T);
-        size_t nmsg = nelem / n_per_msg + (nelem % n_per_msg ? 1 : 0);
-        auto nmsg_total = nmsg*(cores()-1);
-
-        CompletionEvent local_ce;
-        this->ce = &local_ce;
-        this->ce->enroll( (mycore() == HOME_CORE) ? nmsg_total : nmsg );
-        barrier();
+        const size_t per = elems_per_msg<T>();
+        const Core lc = locale_cores(), q = locale_mycore(), leader = locale_leader(mylocale());
+        const Locale me = mylocale(), p2 = pow2_below(locales());
+        const bool extra = me >= p2, folds = me + p2 < locales();
+        const int nrounds = (locales() > 1) ? log2_exact(p2) : 0;
         
-        if (mycore() != HOME_CORE) {
-          for (size_t k=0; k<nelem; k+=n_per_msg) {
-            size_t this_nelem = std::min(n_per_msg, nelem-k);
-            
-            // everyone sends their contribution to HOME_CORE, last one wakes HOME_CORE
-            send_heap_message(HOME_CORE, [this,k](void * payload, size_t payload_size) {
-              DCHECK(mycore() == HOME_CORE);
-      
-              auto in_array = static_cast<T*>(payload);
-              auto in_n = payload_size/sizeof(T);
-              auto total = this->array+k;
-      
-              for (size_t i=0; i<in_n; i++) {
-                total[i] = ReduceOp(total[i], in_array[i]);
-              }
-              DVLOG(3) << "incrementing HOME sem, now at " << ce->get_count();      
-              this->ce->complete();
-            }, (void*)(in_array+k), sizeof(T)*this_nelem);
+        lo = slice_lo(q);
+        len = slice_len(q);
+        const size_t mine = nchunks(len, per);
+        size_t others = 0;
+        for (Core c=0; c<lc; c++) if (c != q) others += nchunks(slice_len(c), per);
+        
+        // expect everything before anyone can send (the barrier below)
+        inbox.resize((nrounds+1) * len);
+        peers_ce.enroll((lc-1) * mine);
+        gather_ce.enroll(others);
+        if (locales() > 1) {
+          if (extra) {
+            result_ce.enroll(mine);
+          } else {
+            if (folds) fold_ce.enroll(mine);
+            for (int r=0; r<nrounds; r++) rounds_ce[r].enroll(mine);
           }
-          
-          DVLOG(3) << "about to block for " << nelem << " with sem == " << ce->get_count();           this->ce->wait();
-          
-        } else {
-          auto nmsg_total = nmsg*(cores()-1);
-          
-          // home core waits until woken by last received message from other cores
-          this->ce->wait();
-          DVLOG(3) << "woke with sem == " << ce->get_count();
-          
-          // send total to everyone else and wake them
-          char msg_buf[(cores()-1)*sizeof(PayloadMessage<std::function<void(decltype(this),size_t)>>)];
-          MessagePool pool(msg_buf, sizeof(msg_buf));
-          for (Core c = 0; c < cores(); c++) {
-            if (c != HOME_CORE) {
-              // send totals back to all the other cores
-              size_t n_per_msg = MAX_MESSAGE_SIZE / sizeof(T);
-              for (size_t k=0; k<nelem; k+=n_per_msg) {
-                size_t this_nelem = std::min(n_per_msg, nelem-k);
-                pool.send_message(c, [this,k](void * payload, size_t psz){
-                  auto total_k = static_cast<T*>(payload);
-                  auto in_n = psz / sizeof(T);
-                  for (size_t i=0; i<in_n; i++) {
-                    this->array[k+i] = total_k[i];
-                  }
-                  this->ce->complete();
-                  DVLOG(3) << "incrementing sem, now at " << ce->get_count();
-                }, this->array+k, sizeof(T)*this_nelem);              
+        }
+        
+        size_t nmsg = others + (lc-1)*mine + (nrounds+1)*mine;
+        MessagePool pool(std::max<size_t>(1, nmsg) *
+                         sizeof(PayloadMessage<std::function<void(void*,size_t)>>));
+        barrier();
+        
+        // reduce-scatter within the locale
+        for (Core c=0; c<lc; c++) if (c != q) send(pool, leader+c, PEER, slice_lo(c), slice_len(c));
+        peers_ce.wait();
+        
+        // allreduce my slice with the same slice on the other locales
+        if (locales() > 1) {
+          if (extra) {
+            send(pool, locale_leader(me-p2)+q, FOLD, lo, len);
+            result_ce.wait();
+          } else {
+            if (folds) {
+              fold_ce.wait();
+              for (size_t i=0; i<len; i++) array[lo+i] = ReduceOp(array[lo+i], inbox[i]);
+            }
+            for (int r=0; r<nrounds; r++) {
+              Locale partner = me ^ (Locale(1) << r);
+              send(pool, locale_leader(partner)+q, ROUND+r, lo, len);
+              rounds_ce[r].wait();
+              pool.block_until_all_sent(); // slice is still a message payload
+              T * other = &inbox[(r+1)*len];
+              for (size_t i=0; i<len; i++) {
+                array[lo+i] = (me < partner) ? ReduceOp(array[lo+i], other[i])
+                                             : ReduceOp(other[i], array[lo+i]);
               }
             }
+            if (folds) send(pool, locale_leader(me+p2)+q, RESULT, lo, len);
           }
-          // once all messages are sent, HOME_CORE's task continues
         }
+        
+        // allgather within the locale
+        for (Core c=0; c<lc; c++) if (c != q) send(pool, leader+c, GATHER, lo, len);
+        gather_ce.wait();
+        
+        // caller may modify the array once we return
+        pool.block_until_all_sent();
       }
     };
     
+    /// Run `func` on every core (in a message handler) and combine the
+    /// results into the calling core's value. One message goes to each
+    /// locale's leader, which collects its locale's results and replies
+    /// with their combination, so the caller handles O(locales) messages
+    /// rather than O(cores).
+    template< typename F, typename C >
+    auto reduce_by_locale(F func, C combine) -> decltype(func()) {
+      typedef decltype(func()) T;
+      struct Partial { T total; Core remaining; };
+      
+      Core origin = mycore();
+      T total = func();
+      CompletionEvent ce;
+      auto total_ptr = &total;
+      auto ce_ptr = &ce;
+      
+      for (Locale l = 0; l < locales(); l++) {
+        Core first = locale_leader(l);
+        Core n = locale_cores() - ((l == mylocale()) ? 1 : 0);
+        if (n == 0) continue;
+        Core leader = (first == origin) ? first+1 : first;
+        
+        ce.enroll();
+        send_heap_message(leader, [=]{
+          auto reply = [=](const T& val) {
+            send_heap_message(origin, [=]{
+              combine(*total_ptr, val);
+              ce_ptr->complete();
+            });
+          };
+          if (n == 1) { reply(func()); return; }
+          
+          auto p = new Partial{ func(), n-1 };
+          for (Core c = first; c < first+locale_cores(); c++) if (c != leader && c != origin) {
+            send_heap_message(c, [=]{
+              T val = func();
+              send_heap_message(leader, [=]{
+                combine(p->total, val);
+                if (--p->remaining == 0) {
+                  reply(p->total);
+                  delete p;
+                }
+              });
+            });
+          }
+        });
+      }
+      ce.wait();
+      return total;
+    }
+    
+    /// MPI datatype for T: the matching builtin for arithmetic types,
+    /// otherwise an opaque block of sizeof(T) bytes.
+    template< typename T > struct MPIType {
+      static const bool builtin = false;
+      static MPI_Datatype get() {
+        static MPI_Datatype t = []{
+          MPI_Datatype t;
+          MPI_CHECK( MPI_Type_contiguous( sizeof(T), MPI_BYTE, &t ) );
+          MPI_CHECK( MPI_Type_commit( &t ) );
+          return t;
+        }();
+        return t;
+      }
+    };
+#define GRAPPA_MPI_BUILTIN_TYPE(T, mpi_t) \
+    template<> struct MPIType<T> { \
+      static const bool builtin = true; \
+      static MPI_Datatype get() { return mpi_t; } \
+    }
+    GRAPPA_MPI_BUILTIN_TYPE(short, MPI_SHORT);
+    GRAPPA_MPI_BUILTIN_TYPE(unsigned short, MPI_UNSIGNED_SHORT);
+    GRAPPA_MPI_BUILTIN_TYPE(int, MPI_INT);
+    GRAPPA_MPI_BUILTIN_TYPE(unsigned, MPI_UNSIGNED);
+    GRAPPA_MPI_BUILTIN_TYPE(long, MPI_LONG);
+    GRAPPA_MPI_BUILTIN_TYPE(unsigned long, MPI_UNSIGNED_LONG);
+    GRAPPA_MPI_BUILTIN_TYPE(long long, MPI_LONG_LONG);
+    GRAPPA_MPI_BUILTIN_TYPE(unsigned long long, MPI_UNSIGNED_LONG_LONG);
+    GRAPPA_MPI_BUILTIN_TYPE(float, MPI_FLOAT);
+    GRAPPA_MPI_BUILTIN_TYPE(double, MPI_DOUBLE);
+#undef GRAPPA_MPI_BUILTIN_TYPE
+    
+    template< typename T, T (*ReduceOp)(const T&, const T&) >
+    void mpi_reduce_op(void * in, void * inout, int * len, MPI_Datatype * type) {
+      auto a = static_cast<T*>(in);
+      auto b = static_cast<T*>(inout);
+      for (int i=0; i<*len; i++) b[i] = ReduceOp(a[i], b[i]);
+    }
+    
+    /// MPI reduction op for ReduceOp: the builtin for add/mult/max/min on
+    /// arithmetic types, otherwise a user op applying ReduceOp.
+    template< typename T, T (*ReduceOp)(const T&, const T&), bool Builtin = MPIType<T>::builtin >
+    struct MPIBuiltinOp {
+      static MPI_Op get() { return MPI_OP_NULL; }
+    };
+    template< typename T, T (*ReduceOp)(const T&, const T&) >
+    struct MPIBuiltinOp<T,ReduceOp,true> {
+      static MPI_Op get() {
+        if (ReduceOp == &collective_add<T>) return MPI_SUM;
+        if (ReduceOp == &collective_mult<T>) return MPI_PROD;
+        if (ReduceOp == &collective_max<T>) return MPI_MAX;
+        if (ReduceOp == &collective_min<T>) return MPI_MIN;
+        return MPI_OP_NULL;
+      }
+    };
+    
+    template< typename T, T (*ReduceOp)(const T&, const T&) >
+    MPI_Op mpi_op() {
+      MPI_Op builtin = MPIBuiltinOp<T,ReduceOp>::get();
+      if (builtin != MPI_OP_NULL) return builtin;
+      static MPI_Op op = []{
+        MPI_Op op;
+        MPI_CHECK( MPI_Op_create( &mpi_reduce_op<T,ReduceOp>, 1, &op ) );
+        return op;
+      }();
+      return op;
+    }
+    
   } // namespace impl
   
   /// Called from SPMD context, reduces values from all cores calling `allreduce` and returns reduced
   /// values to everyone. Blocks until reduction is complete, so suffices as a global barrier.
   ///
+  /// Values are combined within each locale first, then across locales by
+  /// recursive doubling, so no core handles more than O(locale_cores + log(locales)) messages.
+  ///
   /// @warning May only one with a given type/op combination may be used at a time,
   ///          uses a function-private static variable.
   ///
@@ -321,19 +562,16 @@ namespace Grappa {
   /// @endcode
   template< typename T, T (*ReduceOp)(const T&, const T&) >
   T allreduce(T myval) {
-    impl::Reduction<T>::result.reset();
-    
-    send_message(impl::HOME_CORE, [myval]{
-      impl::collect_reduction<T,ReduceOp>(myval);
-    });
-    
-    return impl::Reduction<T>::result.readFF();
+    return impl::TreeReduction<T,ReduceOp>::get().call_allreduce(myval);
   }
   
   /// Called from SPMD context.
   /// Do an in-place allreduce (works on arrays). All elements of the array will be 
   /// overwritten by the operation with the total from all cores.
   ///
+  /// Uses reduce-scatter/allgather within each locale and recursive doubling
+  /// across locales (see impl::InplaceReduction).
+  ///
   /// @warning May only one with a given type/op combination may be used at a time,
   ///          uses a function-private static variable.
   template< typename T, T (*ReduceOp)(const T&, const T&) >
@@ -342,6 +580,136 @@ namespace Grappa {
     reducer.call_allreduce(array, nelem);
   }
   
+  /// Called from SPMD context.
+  /// Overwrite `array` on every core with the `nelem` elements of `array` on
+  /// core `root`. Data goes down a binomial tree across locales into one
+  /// staging buffer in locale shared memory per locale, which the rest of
+  /// the locale copies out of. Blocks until this core has its copy.
+  ///
+  /// @warning May only one with a given type may be used at a time,
+  ///          uses function-private static variables.
+  ///
+  /// @b Example:
+  /// @code
+  ///   Grappa::on_all_cores([]{
+  ///     double params[16];
+  ///     if (Grappa::mycore() == 0) read_params(params);
+  ///     Grappa::broadcast_inplace(params, 16);
+  ///   });
+  /// @endcode
+  template< typename T >
+  void broadcast_inplace(T * array, size_t nelem, Core root = 0) {
+    static T * staging;
+    static CompletionEvent recv_ce, copied_ce;
+    static FullEmpty<T*> staged;
+    
+    // one source core per locale, in the same position as the root
+    const Core lc = locale_cores(), q = root % lc, source = impl::locale_leader(mylocale()) + q;
+    const Locale L = locales(), rel = (mylocale() + L - root/lc) % L;
+    const size_t per = impl::elems_per_msg<T>(), nmsg = impl::nchunks(nelem, per);
+    
+    if (mycore() == source) {
+      staging = locale_alloc<T>(std::max<size_t>(1, nelem));
+      if (rel == 0) std::copy(array, array+nelem, staging);
+      else recv_ce.enroll(nmsg);
+      copied_ce.enroll(lc-1);
+    }
+    barrier();
+    
+    if (mycore() != source) {
+      T * src = staged.readFE();
+      std::copy(src, src+nelem, array);
+      send_heap_message(source, []{ copied_ce.complete(); });
+      return;
+    }
+    
+    // receive from parent (rel - lowest set bit), forward to children
+    Locale mask = 1;
+    while (mask < L && !(rel & mask)) mask <<= 1;
+    if (rel != 0) recv_ce.wait();
+    
+    MessagePool pool(std::max<size_t>(1, (impl::log2_exact(impl::pow2_below(L))+1) * nmsg) *
+                     sizeof(PayloadMessage<std::function<void(void*,size_t)>>));
+    for (mask >>= 1; mask > 0; mask >>= 1) if (rel + mask < L) {
+      Core child = impl::locale_leader((mylocale() + mask) % L) + q;
+      for (size_t k=0; k<nelem; k+=per) {
+        pool.send_message(child, [k](void * payload, size_t payload_size) {
+          auto in = static_cast<T*>(payload);
+          std::copy(in, in + payload_size/sizeof(T), staging+k);
+          recv_ce.complete();
+        }, (void*)(staging+k), sizeof(T)*std::min(per, nelem-k));
+      }
+    }
+    
+    if (rel != 0) std::copy(staging, staging+nelem, array);
+    for (Core c = impl::locale_leader(mylocale()); c < impl::locale_leader(mylocale())+lc; c++) {
+      if (c != source) {
+        T * src = staging;
+        send_heap_message(c, [src]{ staged.writeXF(src); });
+      }
+    }
+    copied_ce.wait();
+    pool.block_until_all_sent();
+    locale_free(staging);
+  }
+
+  /// @name Non-blocking collectives
+  /// Called from SPMD context; these start an MPI-3 non-blocking collective
+  /// and return immediately with a CollectiveRequest. Other tasks (and the
+  /// caller, until it calls `wait()`) keep running; the waiting task is
+  /// woken by the communicator's poll. Like MPI, every core must start the
+  /// same non-blocking collectives in the same order, and the buffers must
+  /// not be touched until the request completes.
+  ///
+  /// @b Example:
+  /// @code
+  ///   Grappa::on_all_cores([]{
+  ///     double delta = local_delta();
+  ///     auto r = Grappa::iallreduce<double,collective_add>(&delta);
+  ///     compute_next_iteration_locally();
+  ///     r.wait();
+  ///     if (delta < epsilon) ...
+  ///   });
+  /// @endcode
+  /// @{
+  
+  /// Overwrite `array` on every core with its elementwise reduction over all cores.
+  template< typename T, T (*ReduceOp)(const T&, const T&) >
+  CollectiveRequest iallreduce(T * array, size_t nelem = 1) {
+    CHECK_LE(nelem, std::numeric_limits<int>::max());
+    auto type = impl::MPIType<T>::get();
+    auto op = impl::mpi_op<T,ReduceOp>();
+    return CollectiveRequest::start([=](MPI_Request * request){
+      MPI_CHECK( MPI_Iallreduce( MPI_IN_PLACE, array, nelem, type, op,
+                                 global_communicator.grappa_comm, request ) );
+    });
+  }
+  
+  /// Overwrite `array` on every core with `array` from core `root`.
+  template< typename T >
+  CollectiveRequest ibroadcast(T * array, size_t nelem, Core root = 0) {
+    CHECK_LE(nelem, std::numeric_limits<int>::max());
+    auto type = impl::MPIType<T>::get();
+    return CollectiveRequest::start([=](MPI_Request * request){
+      MPI_CHECK( MPI_Ibcast( array, nelem, type, root,
+                             global_communicator.grappa_comm, request ) );
+    });
+  }
+  
+  /// Gather `nelem` elements from every core into `all` (cores()*nelem
+  /// elements, core c's at all[c*nelem]) on every core.
+  template< typename T >
+  CollectiveRequest iallgather(const T * mine, size_t nelem, T * all) {
+    CHECK_LE(nelem, std::numeric_limits<int>::max());
+    auto type = impl::MPIType<T>::get();
+    return CollectiveRequest::start([=](MPI_Request * request){
+      MPI_CHECK( MPI_Iallgather( mine, nelem, type, all, nelem, type,
+                                 global_communicator.grappa_comm, request ) );
+    });
+  }
+  
+  /// @}
+  
   /// Called from a single task (usually user_main), reduces values from all cores onto the calling node.
   /// Blocks until reduction is complete.
   /// Safe to use any number of these concurrently.
@@ -356,26 +724,8 @@ namespace Grappa {
   /// @endcode
   template< typename T, T (*ReduceOp)(const T&, const T&) >
   T reduce(const T * global_ptr) {
-    //NOTE: this is written in a continuation passing
-    //style to avoid the use of a GCE which async delegates only support
-    CompletionEvent ce(cores()-1);
-  
-    T total = *global_ptr;
-    Core origin = mycore();
-    
-    for (Core c=0; c<cores(); c++) {
-      if (c != origin) {
-        send_heap_message(c, [global_ptr, &ce, &total, origin]{
-          T val = *global_ptr;
-          send_heap_message(origin, [val,&ce,&total] {
-            total = ReduceOp(total, val);
-            ce.complete();
-          });
-        });
-      }
-    }
-    ce.wait();
-    return total;
+    return impl::reduce_by_locale([global_ptr]{ return *global_ptr; },
+                                  [](T& total, const T& val){ total = ReduceOp(total, val); });
   }
 
   /// Reduce over a symmetrically allocated object.
@@ -391,26 +741,10 @@ namespace Grappa {
   ///   }
   /// @endcode
   template< typename T, T (*ReduceOp)(const T&, const T&)>
-   T reduce( GlobalAddress<T> localizable ) {
-     CompletionEvent ce(cores() - 1); 
-
-     T total = *(localizable.localize());
-     Core origin = mycore();
-
-     for (Core c=0; c<cores(); c++) {
-      if (c != origin) {
-        send_heap_message(c, [localizable, &ce, &total, origin]{
-          T val = *(localizable.localize());
-          send_heap_message(origin, [val,&ce,&total] {
-            total = ReduceOp(total, val);
-            ce.complete();
-          });
-        });
-      }
-     }
-    ce.wait();
-    return total;
-   }
+  T reduce( GlobalAddress<T> localizable ) {
+    return impl::reduce_by_locale([localizable]{ return *(localizable.localize()); },
+                                  [](T& total, const T& val){ total = ReduceOp(total, val); });
+  }
 
   /// Reduce over a member of a symmetrically allocated object.
   /// The Accessor function is used to pull out the member.
@@ -432,25 +766,9 @@ namespace Grappa {
   ///   }
   /// @endcode
   template< typename T, typename P, T (*ReduceOp)(const T&, const T&), T (*Accessor)(GlobalAddress<P>)>
-   T reduce( GlobalAddress<P> localizable ) {
-     CompletionEvent ce(cores() - 1); 
-
-     T total = Accessor(localizable);
-     Core origin = mycore();
-
-     for (Core c=0; c<cores(); c++) {
-      if (c != origin) {
-        send_heap_message(c, [localizable, &ce, &total, origin]{
-          T val = Accessor(localizable);
-          send_heap_message(origin, [val,&ce,&total] {
-            total = ReduceOp(total, val);
-            ce.complete();
-          });
-        });
-      }
-     }
-    ce.wait();
-    return total;
+  T reduce( GlobalAddress<P> localizable ) {
+    return impl::reduce_by_locale([localizable]{ return Accessor(localizable); },
+                                  [](T& total, const T& val){ total = ReduceOp(total, val); });
   }
   
   /// Custom reduction from all cores.
@@ -471,20 +789,8 @@ namespace Grappa {
   /// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
   template< typename F = nullptr_t >
   auto sum_all_cores(F func) -> decltype(func()) {
-    decltype(func()) total = func();
-    CompletionEvent _ce(cores()-1);
-    auto ce = make_global(&_ce);
-    for (Core c=0; c < cores(); c++) if (c != mycore()) {
-      send_heap_message(c, [ce,func,&total]{
-        auto r = func();
-        send_heap_message(ce.core(), [ce,r,&total]{
-          total += r;
-          ce->complete();
-        });
-      });
-    }
-    ce->wait();
-    return total;
+    typedef decltype(func()) T;
+    return impl::reduce_by_locale(func, [](T& total, const T& val){ total += val; });
   }
   
   /// @}
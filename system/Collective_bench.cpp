@@ -0,0 +1,103 @@
+////////////////////////////////////////////////////////////////////////
+// This file is part of Grappa, a system for scaling irregular
+// applications on commodity clusters. 
+
+// Copyright (C) 2010-2014 University of Washington and Battelle
+// Memorial Institute. University of Washington authorizes use of this
+// Grappa software.
+
+// Grappa is free software: you can redistribute it and/or modify it
+// under the terms of the Affero General Public License as published
+// by Affero, Inc., either version 1 of the License, or (at your
+// option) any later version.
+
+// Grappa is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// Affero General Public License for more details.
+
+// You should have received a copy of the Affero General Public
+// License along with this program. If not, you may obtain one from
+// http://www.affero.org/oagpl.html.
+////////////////////////////////////////////////////////////////////////
+
+/// Microbenchmark for the collectives in Collective.hpp.
+///
+/// Times allreduce_inplace and broadcast_inplace on int64 arrays from
+/// --min_bytes to --max_bytes (doubling), plus scalar allreduce and
+/// reduce. Reports the slowest core's average time per call.
+///
+///   mpirun ... ./Collective_bench.exe --max_bytes=67108864
+
+#include "Grappa.hpp"
+#include "Collective.hpp"
+#include "LocaleSharedMemory.hpp"
+
+#include <string>
+
+DEFINE_uint64( min_bytes, 8, "Smallest payload to time" );
+DEFINE_uint64( max_bytes, 64L << 20, "Largest payload to time" );
+DEFINE_uint64( iters, 100, "Calls timed per payload size (scaled down above 64 KB)" );
+DEFINE_string( collectives, "allreduce_inplace,broadcast_inplace,allreduce,reduce", "Which collectives to time" );
+
+using namespace Grappa;
+
+static int64_t global_x;
+
+bool enabled(const std::string& name) {
+  return ("," + FLAGS_collectives + ",").find("," + name + ",") != std::string::npos;
+}
+
+/// time `iters` calls of `f` on every core; returns slowest core's average
+template< typename F >
+double time_spmd(uint64_t iters, F f) {
+  barrier();
+  double start = walltime();
+  for (uint64_t i=0; i<iters; i++) f();
+  double avg = (walltime() - start) / iters;
+  return allreduce<double,collective_max>(avg);
+}
+
+void report(const char * name, uint64_t bytes, uint64_t iters, double t) {
+  LOG(INFO) << name << ": bytes = " << bytes << ", iters = " << iters
+            << ", avg_time = " << t*1e6 << " us, bandwidth = " << bytes/t/(1L<<20) << " MB/s";
+}
+
+int main(int argc, char* argv[]) {
+  Grappa::init(&argc, &argv);
+  Grappa::run([]{
+    LOG(INFO) << "cores = " << cores() << ", locales = " << locales();
+    
+    on_all_cores([]{
+      for (uint64_t bytes = FLAGS_min_bytes; bytes <= FLAGS_max_bytes; bytes *= 2) {
+        size_t n = std::max<size_t>(1, bytes / sizeof(int64_t));
+        uint64_t iters = std::max<uint64_t>(1, FLAGS_iters * (1L<<16) / std::max<uint64_t>(bytes, 1L<<16));
+        auto xs = locale_alloc<int64_t>(n);
+        for (size_t i=0; i<n; i++) xs[i] = mycore() + i;
+        
+        if (enabled("allreduce_inplace")) {
+          double t = time_spmd(iters, [xs,n]{ allreduce_inplace<int64_t,collective_max>(xs, n); });
+          if (mycore() == 0) report("allreduce_inplace", n*sizeof(int64_t), iters, t);
+        }
+        if (enabled("broadcast_inplace")) {
+          double t = time_spmd(iters, [xs,n]{ broadcast_inplace(xs, n); });
+          if (mycore() == 0) report("broadcast_inplace", n*sizeof(int64_t), iters, t);
+        }
+        locale_free(xs);
+      }
+      
+      if (enabled("allreduce")) {
+        double t = time_spmd(FLAGS_iters, []{ allreduce<int64_t,collective_add>(mycore()); });
+        if (mycore() == 0) report("allreduce", sizeof(int64_t), FLAGS_iters, t);
+      }
+      global_x = mycore();
+    });
+    
+    if (enabled("reduce")) {
+      double start = walltime();
+      for (uint64_t i=0; i<FLAGS_iters; i++) reduce<int64_t,collective_add>(&global_x);
+      report("reduce", sizeof(int64_t), FLAGS_iters, (walltime() - start) / FLAGS_iters);
+    }
+  });
+  Grappa::finalize();
+}
@@ -101,6 +101,67 @@ BOOST_AUTO_TEST_CASE( test1 ) {
       for (int i=0; i<N; i++) BOOST_CHECK_EQUAL(xs[i], Grappa::cores() * i);
     });
     
+    BOOST_MESSAGE("testing allreduce and allreduce_inplace spanning many messages");
+    Grappa::on_all_cores([]{
+      int m = Grappa::allreduce<int,collective_max>(Grappa::mycore());
+      BOOST_CHECK_EQUAL(m, Grappa::cores()-1);
+      
+      const size_t N = 3*MAX_MESSAGE_SIZE/sizeof(int64_t) + 7;
+      auto xs = locale_alloc<int64_t>(N);
+      for (size_t i=0; i<N; i++) xs[i] = (i == Grappa::mycore()) ? i : 0;
+      
+      Grappa::allreduce_inplace<int64_t,collective_bor>(xs, N);
+      
+      for (size_t i=0; i<N; i++) BOOST_CHECK_EQUAL(xs[i], (i < Grappa::cores()) ? i : 0);
+      locale_free(xs);
+    });
+    
+    BOOST_MESSAGE("testing broadcast_inplace");
+    Grappa::on_all_cores([]{
+      const int N = 1000;
+      int64_t xs[N];
+      Core root = Grappa::cores() - 1;
+      for (int i=0; i<N; i++) xs[i] = (Grappa::mycore() == root) ? i*i : -1;
+      
+      Grappa::broadcast_inplace(xs, N, root);
+      
+      for (int i=0; i<N; i++) BOOST_CHECK_EQUAL(xs[i], i*i);
+    });
+    
+    BOOST_MESSAGE("testing non-blocking collectives");
+    Grappa::on_all_cores([]{
+      const int N = 100;
+      int64_t xs[N], all[N*Grappa::cores()];
+      double d = Grappa::mycore();
+      TestObj o = {0, Grappa::mycore()+1};
+      for (int i=0; i<N; i++) xs[i] = Grappa::mycore() * i;
+      
+      auto rb = Grappa::ibarrier();
+      auto rd = Grappa::iallreduce<double,collective_max>(&d);
+      auto rx = Grappa::iallreduce<TestObj,collective_add>(&o); // user-defined op
+      auto rg = Grappa::iallgather(xs, N, all);
+      
+      // other tasks keep running while these are outstanding
+      int64_t done = 0;
+      CompletionEvent ce(1);
+      spawn([&]{ done = 1; ce.complete(); });
+      ce.wait();
+      BOOST_CHECK_EQUAL(done, 1);
+      
+      rb.wait(); rd.wait(); rx.wait(); rg.wait();
+      BOOST_CHECK_EQUAL(d, Grappa::cores()-1);
+      BOOST_CHECK_EQUAL(o.c, Grappa::cores()*(Grappa::cores()+1)/2);
+      for (Core c=0; c<Grappa::cores(); c++) {
+        for (int i=0; i<N; i++) BOOST_CHECK_EQUAL(all[c*N+i], c*i);
+      }
+      
+      Grappa::ibroadcast(xs, N, Grappa::cores()-1).wait();
+      for (int i=0; i<N; i++) BOOST_CHECK_EQUAL(xs[i], (Grappa::cores()-1)*i);
+      
+      Grappa::iallreduce<int64_t,collective_add>(xs, N).wait();
+      for (int i=0; i<N; i++) BOOST_CHECK_EQUAL(xs[i], Grappa::cores()*(Grappa::cores()-1)*i);
+    });
+    
     Grappa::call_on_all_cores([]{ global_x = 1; });
     
     auto total = Grappa::sum_all_cores([]{ return global_x; });
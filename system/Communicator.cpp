@@ -94,7 +94,7 @@ Communicator::Communicator( )
 
   , barrier_request( MPI_REQUEST_NULL )
   , external_sends()
-  , collective_context(NULL)
+  , collective_contexts()
 
   , locale_comm()
   , grappa_comm()
@@ -445,17 +445,21 @@ void Communicator::process_received_buffers() {
 }
 
 void Communicator::process_collectives() {
-  if( collective_context ) {
-    auto c = collective_context;
+  for( size_t i = 0; i < collective_contexts.size(); ) {
+    auto c = collective_contexts[i];
     int flag;
     MPI_Status status;
     MPI_CHECK( MPI_Test( &c->request, &flag, &status ) );
     if( flag ) {
+      // callback may start another collective, so remove this one first
+      collective_contexts[i] = collective_contexts.back();
+      collective_contexts.pop_back();
       c->reference_count = 0;
       if( c->callback ) {
         (c->callback)( c, status.MPI_SOURCE, status.MPI_TAG, c->size );
       }
-      collective_context = NULL;
+    } else {
+      i++;
     }
   }
 }
@@ -140,7 +140,7 @@ private:
   void process_collectives();
 
   std::deque<CommunicatorContext*> external_sends;
-  CommunicatorContext * collective_context;
+  std::vector<CommunicatorContext*> collective_contexts; ///< outstanding non-blocking collectives
   
 public:
   MPI_Comm locale_comm; // locale-local communicator
@@ -261,6 +261,14 @@ public:
 
   void poll( unsigned int max_receives = 0 );
   
+  /// Start a non-blocking MPI operation: `f` is given the context's
+  /// request to start it on, and the context's callback is called from
+  /// poll() once the request completes. Any number may be outstanding.
+  template< typename F >
+  void with_request_do( CommunicatorContext * c, F f );
+  
+  /// Like with_request_do(), but suspends the calling task until the
+  /// request completes.
   template< typename F >
   void with_request_do_blocking( F f );
 
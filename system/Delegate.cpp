@@ -37,9 +37,9 @@ GRAPPA_DEFINE_METRIC(HistogramMetric, delegate_op_latency_histogram, 0);
 GRAPPA_DEFINE_METRIC(SummarizingMetric<uint64_t>, flat_combiner_fetch_and_add_amount, 0);
 GRAPPA_DEFINE_METRIC(SimpleMetric<uint64_t>, delegate_short_circuits, 0);
 
-GRAPPA_DEFINE_METRIC(SummarizingMetric<double>, delegate_roundtrip_latency, 0.0);
-GRAPPA_DEFINE_METRIC(SummarizingMetric<double>, delegate_network_latency, 0.0);
-GRAPPA_DEFINE_METRIC(SummarizingMetric<double>, delegate_wakeup_latency, 0.0);
+GRAPPA_DEFINE_METRIC(LatencyHistogramMetric, delegate_roundtrip_latency, 0);
+GRAPPA_DEFINE_METRIC(LatencyHistogramMetric, delegate_network_latency, 0);
+GRAPPA_DEFINE_METRIC(LatencyHistogramMetric, delegate_wakeup_latency, 0);
 
 GRAPPA_DEFINE_METRIC(SimpleMetric<uint64_t>, delegate_ops, 0);
 GRAPPA_DEFINE_METRIC(SimpleMetric<uint64_t>, delegate_targets, 0);
@@ -51,3 +51,5 @@ GRAPPA_DEFINE_METRIC(SimpleMetric<uint64_t>, delegate_cmpswaps, 0);
 GRAPPA_DEFINE_METRIC(SimpleMetric<uint64_t>, delegate_cmpswap_targets, 0);
 GRAPPA_DEFINE_METRIC(SimpleMetric<uint64_t>, delegate_fetchadds, 0);
 GRAPPA_DEFINE_METRIC(SimpleMetric<uint64_t>, delegate_fetchadd_targets, 0);
+GRAPPA_DEFINE_METRIC(SimpleMetric<uint64_t>, delegate_multicasts, 0);
+GRAPPA_DEFINE_METRIC(SimpleMetric<uint64_t>, delegate_multicast_messages, 0);
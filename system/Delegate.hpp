@@ -30,7 +30,9 @@
 #include "DelegateBase.hpp"
 #include "GlobalCompletionEvent.hpp"
 #include "AsyncDelegate.hpp"
+#include <algorithm>
 #include <type_traits>
+#include <vector>
 
 GRAPPA_DECLARE_METRIC(SummarizingMetric<uint64_t>, flat_combiner_fetch_and_add_amount);
 GRAPPA_DECLARE_METRIC(SimpleMetric<uint64_t>, delegate_reads);
@@ -41,6 +43,8 @@ GRAPPA_DECLARE_METRIC(SimpleMetric<uint64_t>, delegate_cmpswaps);
 GRAPPA_DECLARE_METRIC(SimpleMetric<uint64_t>, delegate_cmpswap_targets);
 GRAPPA_DECLARE_METRIC(SimpleMetric<uint64_t>, delegate_fetchadds);
 GRAPPA_DECLARE_METRIC(SimpleMetric<uint64_t>, delegate_fetchadd_targets);
+GRAPPA_DECLARE_METRIC(SimpleMetric<uint64_t>, delegate_multicasts);
+GRAPPA_DECLARE_METRIC(SimpleMetric<uint64_t>, delegate_multicast_messages);
 
 
 namespace Grappa {
@@ -438,6 +442,140 @@ namespace Grappa {
     
   } // namespace delegate
   
+  namespace impl {
+    /// Run a multicast on the target cores of one locale (`mask` bit i is
+    /// core `first`+i); called on a core of that locale, which forwards it
+    /// to the others through locale shared memory.
+    template< GlobalCompletionEvent * C, typename F >
+    void multicast_fanout(Core origin, Core first, uint64_t mask, const F& func) {
+      Core me = mycore();
+      for (uint64_t m = mask; m; m &= m-1) {
+        Core c = first + __builtin_ctzll(m);
+        if (c != me) {
+          send_heap_message(c, [origin,func]{
+            delegate_targets++;
+            func();
+            if (C) C->send_completion(origin);
+          });
+        }
+      }
+      if (mask & (1ULL << (me - first))) {
+        delegate_targets++;
+        func();
+        if (C && me != origin) C->send_completion(origin);
+      }
+    }
+  }
+  
+  namespace delegate {
+    
+    /// Asynchronously run `func` on every core in `targets` (any range of
+    /// cores, such as a HypercubeSlice), like one `call<async>` per core.
+    /// Only one message per destination locale crosses the network: it
+    /// carries `func` once with a bitmask of that locale's target cores, and
+    /// the first of them forwards it to the rest through locale shared
+    /// memory. Duplicate targets run once. With more than 64 cores per
+    /// locale it falls back to one `call<async>` per target.
+    ///
+    /// @return number of distinct target cores
+    ///
+    /// @b Example:
+    /// @code
+    ///   Edge e(src, dst);
+    ///   delegate::multicast(h.slice({hf(src), hf(dst), ALL, ALL}), [e]{
+    ///     local_edges.push_back(e);
+    ///   });
+    /// @endcode
+    template< GlobalCompletionEvent * C = &impl::local_gce, typename R, typename F >
+    int64_t multicast(R&& targets, F func) {
+      Core origin = mycore();
+      if (locale_cores() > 64) {
+        // too many cores per locale for a one-word mask: one call<async> per target
+        std::vector<Core> cs;
+        for (auto t : targets) cs.push_back(t);
+        std::sort(cs.begin(), cs.end());
+        cs.erase(std::unique(cs.begin(), cs.end()), cs.end());
+        delegate_multicasts++;
+        bool local = false;
+        for (Core c : cs) {
+          if (c == origin) local = true;
+          else call<SyncMode::Async,C>(c, func);
+        }
+        if (local) call<SyncMode::Async,C>(origin, func);
+        return cs.size();
+      }
+      
+      // One core mask per destination locale, kept on this task's stack:
+      // sending may yield, so other tasks on this core can multicast
+      // meanwhile. Slices span few locales, so merge into a small array;
+      // only targets spanning more locales than that are sorted on the heap.
+      const size_t max_inline = 32;
+      std::pair<Locale,uint64_t> inline_masks[max_inline];
+      std::vector<std::pair<Locale,uint64_t>> heap_masks;
+      std::pair<Locale,uint64_t> * masks = inline_masks;
+      size_t nlocales = 0;
+      for (auto t : targets) {
+        Core c = t;
+        Locale l = locale_of(c);
+        size_t i = 0;
+        while (i < nlocales && masks[i].first != l) i++;
+        if (i == max_inline) { nlocales = max_inline+1; break; }
+        if (i == nlocales) masks[nlocales++] = std::make_pair(l, 0ULL);
+        masks[i].second |= 1ULL << (c - l*locale_cores());
+      }
+      if (nlocales > max_inline) {
+        for (auto t : targets) {
+          Core c = t;
+          Locale l = locale_of(c);
+          heap_masks.emplace_back(l, 1ULL << (c - l*locale_cores()));
+        }
+        std::sort(heap_masks.begin(), heap_masks.end());
+        nlocales = 0;
+        for (auto& lb : heap_masks) {
+          if (nlocales > 0 && heap_masks[nlocales-1].first == lb.first) {
+            heap_masks[nlocales-1].second |= lb.second;
+          } else {
+            heap_masks[nlocales++] = lb;
+          }
+        }
+        masks = heap_masks.data();
+      }
+      
+      // (duplicate targets set the same bit, so they run once)
+      int64_t ntargets = 0, nremote = 0;
+      uint64_t origin_bit = 1ULL << (origin - mylocale()*locale_cores());
+      for (size_t i = 0; i < nlocales; i++) {
+        int64_t n = __builtin_popcountll(masks[i].second);
+        ntargets += n;
+        nremote += (masks[i].first == mylocale() && (masks[i].second & origin_bit)) ? n-1 : n;
+      }
+      delegate_multicasts++;
+      delegate_ops++;
+      if (C && nremote > 0) C->enroll(nremote);
+      
+      uint64_t local_mask = 0;
+      for (size_t i = 0; i < nlocales; i++) {
+        Locale l = masks[i].first;
+        uint64_t mask = masks[i].second;
+        Core first = l*locale_cores();
+        if (l == mylocale()) {
+          local_mask = mask;
+        } else {
+          delegate_multicast_messages++;
+          send_heap_message(first + __builtin_ctzll(mask), [origin,first,mask,func]{
+            impl::multicast_fanout<C>(origin, first, mask, func);
+          });
+        }
+      }
+      // run local targets last, so `func` may itself multicast
+      if (local_mask) {
+        impl::multicast_fanout<C>(origin, mylocale()*locale_cores(), local_mask, func);
+      }
+      return ntargets;
+    }
+    
+  } // namespace delegate
+  
   /// Synchronizing remote private task spawn. Automatically enrolls task with GlobalCompletionEvent and
   /// sends `complete`  message when done (if C is non-null).  
   template< TaskMode B = TaskMode::Bound,
@@ -30,9 +30,9 @@
 
 GRAPPA_DECLARE_METRIC(SimpleMetric<uint64_t>, delegate_short_circuits);
 
-GRAPPA_DECLARE_METRIC(SummarizingMetric<double>, delegate_roundtrip_latency);
-GRAPPA_DECLARE_METRIC(SummarizingMetric<double>, delegate_network_latency);
-GRAPPA_DECLARE_METRIC(SummarizingMetric<double>, delegate_wakeup_latency);
+GRAPPA_DECLARE_METRIC(LatencyHistogramMetric, delegate_roundtrip_latency);
+GRAPPA_DECLARE_METRIC(LatencyHistogramMetric, delegate_network_latency);
+GRAPPA_DECLARE_METRIC(LatencyHistogramMetric, delegate_wakeup_latency);
 
 GRAPPA_DECLARE_METRIC(SimpleMetric<uint64_t>, delegate_ops);
 GRAPPA_DECLARE_METRIC(SimpleMetric<uint64_t>, delegate_targets);
@@ -22,11 +22,197 @@
 ////////////////////////////////////////////////////////////////////////
 
 #include "GlobalAllocator.hpp"
+#include <gflags/gflags.h>
 
+DEFINE_double( global_heap_shared_fraction, 0.25, "Fraction of the global heap that per-core shards may never claim (shards are carved out of it on demand)" );
+DEFINE_uint64( global_alloc_local_max, 1 << 16, "Largest global allocation (in bytes) served from the allocating core's shards of the heap" );
+DEFINE_uint64( global_alloc_shard_chunk, 1 << 22, "Bytes a core carves out of the global heap at a time for its shards" );
+
+GRAPPA_DEFINE_METRIC( LatencyHistogramMetric, global_alloc_latency, 0 );
+GRAPPA_DEFINE_METRIC( SimpleMetric<uint64_t>, global_alloc_local, 0 );
+GRAPPA_DEFINE_METRIC( SimpleMetric<uint64_t>, global_alloc_shared, 0 );
+GRAPPA_DEFINE_METRIC( SummarizingMetric<uint64_t>, global_alloc_waste_bytes, 0 );
+
+static int64_t global_heap_bytes_in_use() {
+  return global_allocator ? global_allocator->total_bytes_in_use() : 0;
+}
+static int64_t global_heap_free_chunks() {
+  return global_allocator ? global_allocator->free_chunks() : 0;
+}
+GRAPPA_DEFINE_METRIC( CallbackMetric<int64_t>, global_heap_in_use, &global_heap_bytes_in_use );
+GRAPPA_DEFINE_METRIC( CallbackMetric<int64_t>, global_heap_fragments, &global_heap_free_chunks );
 
 /// global GlobalAllocator pointer
 GlobalAllocator * global_allocator = NULL;
 
+static size_t round_up_power_of_2( size_t v ) {
+  size_t p = 1;
+  while( p < v ) p <<= 1;
+  return p;
+}
+
+static size_t round_down_power_of_2( size_t v ) {
+  size_t p = 1;
+  while( p <= v / 2 ) p <<= 1;
+  return v == 0 ? 0 : p;
+}
+
+GlobalAllocator::GlobalAllocator( GlobalAddress< void > base, size_t size )
+  : a_p_()
+  , shards_()
+  , carved_()
+  , shard_chunk_( 0 )
+  , shard_limit_( 0 )
+  , shard_bytes_( 0 )
+  , carved_bytes_( 0 )
+{
+  if( 0 == Grappa::mycore() ) {
+    a_p_.reset( new Allocator( reinterpret_cast< void * >( base.raw_bits() ), size ) );
+  }
+
+  // Shard chunks are buddy blocks of the heap at least as big as the largest
+  // local allocation, so local allocations are aligned just as they would be
+  // in one big heap.
+  size_t quantum = std::max< size_t >( round_up_power_of_2( FLAGS_global_alloc_local_max ), block_size );
+  shard_limit_ = static_cast< size_t >( size * (1.0 - FLAGS_global_heap_shared_fraction) ) / Grappa::cores();
+  size_t chunk = std::max( round_up_power_of_2( FLAGS_global_alloc_shard_chunk ), quantum );
+  chunk = std::min( chunk, round_down_power_of_2( shard_limit_ ) );
+  shard_chunk_ = ( chunk >= quantum ) ? chunk : 0;
+  DVLOG(1) << "global heap: " << size << " bytes; shard chunks of " << shard_chunk_
+           << " bytes, up to " << shard_limit_ << " bytes per core";
+
+  // TODO: this won't work with pools....
+  assert( !global_allocator );
+  global_allocator = this;
+}
+
+bool GlobalAllocator::try_local_malloc( size_t size, GlobalAddress< void > * result ) {
+  if( shard_chunk_ == 0 || size > FLAGS_global_alloc_local_max ) return false;
+  void * va = NULL;
+
+  for( auto& s : shards_ ) {
+    if( s.second.allocator->try_malloc( size, &va ) ) {
+      s.second.live++;
+      *result = GlobalAddress< void >::Raw( reinterpret_cast< intptr_t >( va ) );
+      return true;
+    }
+  }
+
+  // carve out another chunk, unless we already hold our share; reserve it
+  // first, since other tasks on this core may carve while we block
+  if( shard_bytes_ + shard_chunk_ > shard_limit_ ) return false;
+  shard_bytes_ += shard_chunk_;
+  Core me = Grappa::mycore();
+  intptr_t chunk = Grappa::impl::call( 0, [me] { return global_allocator->carve( me ); });
+  if( chunk == 0 ) {
+    shard_bytes_ -= shard_chunk_;
+    return false;
+  }
+
+  Shard & s = shards_[ chunk ];
+  s.allocator.reset( new Allocator( reinterpret_cast< void * >( chunk ), shard_chunk_ ) );
+  s.live = 1;
+  CHECK( s.allocator->try_malloc( size, &va ) );
+  *result = GlobalAddress< void >::Raw( reinterpret_cast< intptr_t >( va ) );
+  return true;
+}
+
+GlobalAddress< void > GlobalAllocator::shared_malloc( size_t size ) {
+  CHECK( a_p_ ) << "shared_malloc called on core " << Grappa::mycore();
+  intptr_t address = reinterpret_cast< intptr_t >( a_p_->malloc( size ) );
+  return GlobalAddress< void >::Raw( address );
+}
+
+intptr_t GlobalAllocator::carve( Core core ) {
+  void * va = NULL;
+  if( !a_p_->try_malloc( shard_chunk_, &va ) ) return 0;
+  intptr_t chunk = reinterpret_cast< intptr_t >( va );
+  carved_[ chunk ] = core;
+  carved_bytes_ += shard_chunk_;
+  return chunk;
+}
+
+void GlobalAllocator::uncarve( intptr_t chunk ) {
+  CHECK_EQ( carved_.erase( chunk ), 1 ) << "returned shard chunk " << (void*) chunk << " was not carved";
+  carved_bytes_ -= shard_chunk_;
+  a_p_->free( reinterpret_cast< void * >( chunk ) );
+}
+
+bool GlobalAllocator::try_shard_free( GlobalAddress< void > address ) {
+  intptr_t a = address.raw_bits();
+  auto it = shards_.upper_bound( a );
+  if( it == shards_.begin() ) return false;
+  --it;
+  if( a >= it->first + static_cast< intptr_t >( shard_chunk_ ) ) return false;
+
+  it->second.allocator->free( reinterpret_cast< void * >( a ) );
+  it->second.live--;
+
+  // give empty chunks back so large allocations can use the memory
+  // (but keep our last one, so alloc/free pairs don't carve every time)
+  if( it->second.live == 0 && shards_.size() > 1 ) {
+    intptr_t chunk = it->first;
+    shards_.erase( it );
+    shard_bytes_ -= shard_chunk_;
+    // (don't wait: frees from other cores run here in a message handler)
+    if( Grappa::mycore() == 0 ) {
+      uncarve( chunk );
+    } else {
+      Grappa::send_heap_message( 0, [chunk] { global_allocator->uncarve( chunk ); });
+    }
+  }
+  return true;
+}
+
+Core GlobalAllocator::shared_free( GlobalAddress< void > address ) {
+  intptr_t a = address.raw_bits();
+  auto it = carved_.upper_bound( a );
+  if( it != carved_.begin() ) {
+    --it;
+    if( a < it->first + static_cast< intptr_t >( shard_chunk_ ) ) return it->second;
+  }
+  a_p_->free( reinterpret_cast< void * >( a ) );
+  return -1;
+}
+
+GlobalAddress< void > GlobalAllocator::remote_malloc( size_t size_bytes ) {
+  Grappa::Timestamp start = Grappa::force_tick();
+  global_alloc_waste_bytes += round_up_power_of_2( size_bytes ) - size_bytes;
+
+  GlobalAddress< void > allocated_address;
+  if( global_allocator->try_local_malloc( size_bytes, &allocated_address ) ) {
+    global_alloc_local++;
+  } else {
+    // ask node 0 to allocate memory
+    allocated_address = Grappa::impl::call( 0, [size_bytes] {
+        DVLOG(5) << "got malloc request for size " << size_bytes;
+        GlobalAddress< void > a = global_allocator->shared_malloc( size_bytes );
+        DVLOG(5) << "malloc returning pointer " << a.pointer();
+        return a;
+      });
+    global_alloc_shared++;
+  }
+
+  global_alloc_latency += Grappa::force_tick() - start;
+  return allocated_address;
+}
+
+void GlobalAllocator::remote_free( GlobalAddress< void > address ) {
+  if( global_allocator->try_shard_free( address ) ) return;
+
+  // ask node 0 to free memory, or to tell us whose shard it is in
+  Core owner = Grappa::impl::call( 0, [address] {
+      DVLOG(5) << "got free request for descriptor " << address;
+      return global_allocator->shared_free( address );
+    });
+  if( owner >= 0 ) {
+    bool freed = Grappa::impl::call( owner, [address] {
+        return global_allocator->try_shard_free( address );
+      });
+    CHECK( freed ) << "freeing " << address << ", which is not in a heap managed by core " << owner;
+  }
+}
+
 /// dump
 std::ostream& operator<<( std::ostream& o, const GlobalAllocator& a ) {
   return a.dump( o );
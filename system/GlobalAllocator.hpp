@@ -28,6 +28,8 @@
 #include <glog/logging.h>
 
 #include <boost/scoped_ptr.hpp>
+#include <map>
+#include <memory>
 
 
 #include "Allocator.hpp"
@@ -37,76 +39,80 @@
 class GlobalAllocator;
 extern GlobalAllocator * global_allocator;
 
+GRAPPA_DECLARE_METRIC( LatencyHistogramMetric, global_alloc_latency );
+GRAPPA_DECLARE_METRIC( SimpleMetric<uint64_t>, global_alloc_local );
+GRAPPA_DECLARE_METRIC( SimpleMetric<uint64_t>, global_alloc_shared );
+GRAPPA_DECLARE_METRIC( SummarizingMetric<uint64_t>, global_alloc_waste_bytes );
+
 /// Global memory allocator
+///
+/// Core 0 manages the whole global heap. Each core serves allocations of up
+/// to '--global_alloc_local_max' bytes with no communication from shard
+/// chunks it carves out of core 0's heap the first time it needs them (and
+/// gives back once they are empty). Larger allocations, and ones the shards
+/// can't hold, are sent to core 0, so any memory not held by a shard is
+/// available to them. Frees are handled by whichever core manages the
+/// address.
 class GlobalAllocator {
 private:
+  /// allocator for the whole heap (core 0 only)
   boost::scoped_ptr< Allocator > a_p_;
 
-  /// allocate some number of bytes from local heap
-  /// (should be called only on node responsible for allocator)
-  GlobalAddress< void > local_malloc( size_t size ) {
-    intptr_t address = reinterpret_cast< intptr_t >( a_p_->malloc( size ) );
-    GlobalAddress< void > ga = GlobalAddress< void >::Raw( address );
-    return ga;
-  }
+  /// A chunk of core 0's heap carved out for this core's small allocations.
+  struct Shard {
+    std::unique_ptr< Allocator > allocator;
+    size_t live; ///< allocations not yet freed
+  };
+  /// this core's shard chunks, by address
+  std::map< intptr_t, Shard > shards_;
 
-  // // allocate some number of some type
-  // template< typename T >
-  // GlobalAddress< T > local_malloc( size_t count ) {
-  //   intptr_t address = reinterpret_cast< intptr_t >( a->malloc( sizeof( T ) * count ) );
-  //   GlobalAddress< T > ga = GlobalAddress< T >::Raw( address );
-  //   return ga;
-  // }
-
-  // release data at pointer in local heap
-  /// (should be called only on node responsible for allocator)
-  void local_free( GlobalAddress< void > address ) {
-    void * va = reinterpret_cast< void * >( address.raw_bits() );
-    a_p_->free( va );
-  }
+  /// which core each carved chunk belongs to, by address (core 0 only)
+  std::map< intptr_t, Core > carved_;
+
+  size_t shard_chunk_;   ///< bytes in each shard chunk (0: no shards)
+  size_t shard_limit_;   ///< most bytes this core may hold in shard chunks
+  size_t shard_bytes_;   ///< bytes this core holds (or is carving) in shard chunks
+  size_t carved_bytes_;  ///< bytes carved out for shards, on all cores (core 0 only)
+
+  /// allocate some number of bytes from this core's shards, carving out a
+  /// new chunk if needed
+  bool try_local_malloc( size_t size, GlobalAddress< void > * result );
+
+  /// allocate some number of bytes from the heap (should be called only on core 0)
+  GlobalAddress< void > shared_malloc( size_t size );
+
+  /// take a shard chunk out of the heap for a core, or return 0 if there is
+  /// no room (should be called only on core 0)
+  intptr_t carve( Core core );
 
+  /// put a shard chunk back into the heap (should be called only on core 0)
+  void uncarve( intptr_t chunk );
+
+  /// release data at pointer in one of this core's shards, if it is there
+  bool try_shard_free( GlobalAddress< void > address );
+
+  /// Release data at pointer in the heap, or find which core's shard holds it
+  /// (should be called only on core 0).
+  /// @return core that must free the address, or -1 if it has been freed
+  Core shared_free( GlobalAddress< void > address );
 
 public:
   /// Construct global allocator. Allocates no storage, just controls
   /// ownership of memory region.
   ///   @param base base address of region to allocate from
   ///   @param size number of bytes available for allocation
-  GlobalAllocator( GlobalAddress< void > base, size_t size )
-    : a_p_( 0 == Grappa::mycore()  // node 0 does all allocation for now
-            ? new Allocator( base, size )
-            : NULL )
-  { 
-    // TODO: this won't work with pools....
-    assert( !global_allocator );
-    global_allocator = this;
-  }
+  GlobalAllocator( GlobalAddress< void > base, size_t size );
 
   //
   // basic operations
   //
 
-  /// delegate malloc
-  static GlobalAddress< void > remote_malloc( size_t size_bytes ) {
-    // ask node 0 to allocate memory
-    auto allocated_address = Grappa::impl::call( 0, [size_bytes] {
-        DVLOG(5) << "got malloc request for size " << size_bytes;
-        GlobalAddress< void > a = global_allocator->local_malloc( size_bytes );
-        DVLOG(5) << "malloc returning pointer " << a.pointer();
-        return a;
-      });
-    return allocated_address;
-  }
+  /// allocate from this core's shards if possible, otherwise delegate to core 0
+  static GlobalAddress< void > remote_malloc( size_t size_bytes );
 
-  /// delegate free
+  /// delegate free to the core managing the address
   /// TODO: should free block?
-  static void remote_free( GlobalAddress< void > address ) {
-    // ask node 0 to free memory
-    auto allocated_address = Grappa::impl::call( 0, [address] {
-        DVLOG(5) << "got free request for descriptor " << address;
-        global_allocator->local_free( address );
-        return true;
-      });
-  }
+  static void remote_free( GlobalAddress< void > address );
 
   //
   // debugging
@@ -114,17 +120,29 @@ public:
 
   /// human-readable allocator state (not to be called directly---called by 'operator<<' overload)
   std::ostream& dump( std::ostream& o ) const {
-    if( a_p_ ) {
-      return o << "{GlobalAllocator: " << *a_p_ << "}";
-    } else {
-      return o << "{delegated GlobalAllocator}";
-    }
+    o << "{GlobalAllocator: " << shards_.size() << " shard chunks of " << shard_chunk_ << " bytes";
+    for( auto& s : shards_ ) o << ", shard: " << *s.second.allocator;
+    if( a_p_ ) o << ", shared: " << *a_p_;
+    return o << "}";
   }
 
-  /// Number of bytes available for allocation;
-  size_t total_bytes() const { return a_p_->total_bytes(); }
-  /// Number of bytes allocated
-  size_t total_bytes_in_use() const { return a_p_->total_bytes_in_use(); }
+  /// Number of bytes available for allocation in the heap (counted on core 0 only)
+  size_t total_bytes() const {
+    return a_p_ ? a_p_->total_bytes() : 0;
+  }
+  /// Number of bytes allocated in the heaps managed by this core (shard
+  /// chunks count only for what has been allocated from them)
+  size_t total_bytes_in_use() const {
+    size_t total = a_p_ ? a_p_->total_bytes_in_use() - carved_bytes_ : 0;
+    for( auto& s : shards_ ) total += s.second.allocator->total_bytes_in_use();
+    return total;
+  }
+  /// Number of free chunks in the heaps managed by this core (a measure of fragmentation)
+  size_t free_chunks() const {
+    size_t total = a_p_ ? a_p_->num_free_chunks() : 0;
+    for( auto& s : shards_ ) total += s.second.allocator->num_free_chunks();
+    return total;
+  }
 
 };
 
@@ -35,7 +35,20 @@ BOOST_AUTO_TEST_SUITE( GlobalAllocator_tests );
 
 const size_t local_size_bytes = 1 << 14;
 
+DECLARE_uint64( global_alloc_local_max );
+DECLARE_uint64( global_alloc_shard_chunk );
+
+size_t heap_bytes() {
+  return Grappa::sum_all_cores([]{ return global_allocator->total_bytes(); });
+}
+size_t heap_bytes_in_use() {
+  return Grappa::sum_all_cores([]{ return global_allocator->total_bytes_in_use(); });
+}
+
 BOOST_AUTO_TEST_CASE( test1 ) {
+  // small enough that this tiny heap still gets per-core shards
+  FLAGS_global_alloc_local_max = 1024;
+  FLAGS_global_alloc_shard_chunk = 1024;
   Grappa::init( GRAPPA_TEST_ARGS, local_size_bytes );
   Grappa::run([]{
     GlobalAddress< int8_t > a = Grappa::global_alloc( 1 );
@@ -50,9 +63,40 @@ BOOST_AUTO_TEST_CASE( test1 ) {
     GlobalAddress< int8_t > d = Grappa::global_alloc( 1 );
     LOG(INFO) << "got pointer " << d.pointer();
 
-    BOOST_CHECK_EQUAL( global_allocator->total_bytes(), local_size_bytes );
+    BOOST_CHECK_EQUAL( heap_bytes(), local_size_bytes );
+    BOOST_CHECK_EQUAL( heap_bytes_in_use(), 1 + 1 + 8 + 1 );
+    // small allocations come from this core's shard
     BOOST_CHECK_EQUAL( global_allocator->total_bytes_in_use(), 1 + 1 + 8 + 1 );
 
+    // shards are carved on demand, so an allocation can still be larger
+    // than the part of the heap shards may never claim
+    GlobalAddress< int8_t > big = Grappa::global_alloc( local_size_bytes / 2 );
+    BOOST_CHECK_EQUAL( heap_bytes_in_use(), 1 + 1 + 8 + 1 + local_size_bytes / 2 );
+    Grappa::global_free( big );
+
+    // too big for a shard: goes to the shared region
+    GlobalAddress< int8_t > e = Grappa::global_alloc( 2048 );
+    BOOST_CHECK_EQUAL( heap_bytes_in_use(), 1 + 1 + 8 + 1 + 2048 );
+
+    // allocated on another core, freed here
+    auto f = Grappa::delegate::call( 1, []{ return Grappa::global_alloc( 16 ); });
+    BOOST_CHECK_EQUAL( Grappa::delegate::call( 1, []{ return global_allocator->total_bytes_in_use(); }), 16 );
+    Grappa::global_free( f );
+    Grappa::global_free( e );
+
+    // fill core 1's shard and make it carve a second one, then empty the
+    // second from here: core 1 gives it back to core 0 from the free handler
+    auto pq = Grappa::delegate::call( 1, []{
+        auto p = Grappa::global_alloc( 1024 );
+        auto q = Grappa::global_alloc( 1024 );
+        return std::make_pair( p, q );
+      });
+    BOOST_CHECK_EQUAL( Grappa::delegate::call( 1, []{ return global_allocator->total_bytes_in_use(); }), 2048 );
+    Grappa::global_free( pq.second );
+    BOOST_CHECK_EQUAL( Grappa::delegate::call( 1, []{ return global_allocator->total_bytes_in_use(); }), 1024 );
+    Grappa::global_free( pq.first );
+    BOOST_CHECK_EQUAL( Grappa::delegate::call( 1, []{ return global_allocator->total_bytes_in_use(); }), 0 );
+
     LOG(INFO) << "freeing pointer " << c.pointer();
     Grappa::global_free( c );
 
@@ -65,7 +109,7 @@ BOOST_AUTO_TEST_CASE( test1 ) {
     LOG(INFO) << "freeing pointer " << b.pointer();
     Grappa::global_free( b );
 
-    BOOST_CHECK_EQUAL( global_allocator->total_bytes_in_use(), 0 );
+    BOOST_CHECK_EQUAL( heap_bytes_in_use(), 0 );
   
     LOG(INFO) << "done!";
   });
@@ -27,61 +27,223 @@
 #include "ParallelLoop.hpp"
 #include "Metrics.hpp"
 #include "FlatCombiner.hpp"
+#include "BulkApply.hpp"
+#include "Cache.hpp"
 #include <utility>
 #include <unordered_map>
 #include <vector>
+#include <new>
 
 GRAPPA_DECLARE_METRIC(SimpleMetric<size_t>, hashmap_insert_ops);
 GRAPPA_DECLARE_METRIC(SimpleMetric<size_t>, hashmap_insert_msgs);
 GRAPPA_DECLARE_METRIC(SimpleMetric<size_t>, hashmap_lookup_ops);
 GRAPPA_DECLARE_METRIC(SimpleMetric<size_t>, hashmap_lookup_msgs);
+GRAPPA_DECLARE_METRIC(SimpleMetric<size_t>, hashmap_overflow_inserts);
 
 
 namespace Grappa {
 
-template< typename K, typename V > 
-class GlobalHashMap {
-public:
-  struct Entry {
+/// Storage layout used for the cells of a GlobalHashMap.
+enum class HashLayout {
+  /// Each cell owns a heap-allocated vector of entries.
+  Chained,
+  /// Entries are kept inline in the block-aligned cell; once a cell fills up,
+  /// further entries spill into a flat open-addressed table owned by the core.
+  Flat
+};
+
+namespace impl {
+
+  template< typename K, typename V >
+  struct HashEntry {
     K key;
     V val;
-    Entry( K key ) : key(key), val() {}
-    Entry( K key, V val): key(key), val(val) {}
-  };
-  
-  struct ResultEntry {
-    bool found;
-    ResultEntry * next;
-    V val;
+    HashEntry( K key ) : key(key), val() {}
+    HashEntry( K key, V val): key(key), val(val) {}
   };
-  
-public:
-  struct Cell { // TODO: keep first few in the 64-byte block, then go to secondary storage
+
+  /// Original cell layout: a vector of entries per cell.
+  template< typename K, typename V >
+  struct ChainedHashCell {
+    typedef HashEntry<K,V> Entry;
+    
+    /// Chained cells have no secondary per-core storage.
+    struct Overflow {
+      void clear() {}
+      size_t bytes() const { return 0; }
+      template< typename F >
+      void forall(size_t begin, size_t end, F visit) {}
+      size_t capacity() const { return 0; }
+    };
+    
     std::vector<Entry> entries;
     
-    Cell() : entries() { entries.reserve(10); }
+    ChainedHashCell() : entries() { entries.reserve(10); }
     
     void clear() { entries.clear(); }
     
-    std::pair<bool,V> lookup(K key) {
-      
-      for (auto& e : this->entries) if (e.key == key) return std::pair<bool,K>{true, e.val};
-      return std::pair<bool,K>(false,V());
+    size_t bytes() const { return sizeof(*this) + entries.capacity()*sizeof(Entry); }
+    
+    V * find(const K& key, Overflow& o) {
+      for (auto& e : entries) if (e.key == key) return &e.val;
+      return nullptr;
     }
-    void insert(const K& key, const V& val) {
-      bool found = false;
-      for (auto& e : entries) {
-        if (e.key == key) {
-          e.val = val;
-          found = true;
-          break;
-        }
+    
+    V& find_or_insert(const K& key, Overflow& o) {
+      for (auto& e : entries) if (e.key == key) return e.val;
+      entries.emplace_back(key);
+      return entries.back().val;
+    }
+    
+    template< typename F >
+    void forall(F visit) {
+      for (auto& e : entries) visit(e.key, e.val);
+    }
+  } GRAPPA_BLOCK_ALIGNED;
+  
+  /// Per-core open-addressed (linear probing) table holding the entries that
+  /// did not fit inline in their FlatHashCell. Capacity is a power of two and
+  /// doubles whenever the table would become more than 3/4 full.
+  template< typename K, typename V >
+  class HashOverflowTable {
+    static const size_t MIN_CAPACITY = 1<<6;
+    
+    struct Slot {
+      bool full;
+      K key;
+      V val;
+      Slot(): full(false), key(), val() {}
+    };
+    
+    std::vector<Slot> slots;
+    size_t count;
+    size_t mask;
+    
+    size_t home(const K& key) const {
+      static std::hash<K> hasher;
+      // mix the bits: entries spilled from one cell share `hash % ncells`
+      uint64_t h = static_cast<uint64_t>(hasher(key)) * 0x9E3779B97F4A7C15ULL;
+      return (h ^ (h >> 32)) & mask;
+    }
+    
+    void grow() {
+      std::vector<Slot> old;
+      old.swap(slots);
+      slots.resize(old.empty() ? MIN_CAPACITY : 2*old.size());
+      mask = slots.size()-1;
+      for (auto& s : old) if (s.full) {
+        size_t i = home(s.key);
+        while (slots[i].full) i = (i+1) & mask;
+        slots[i].full = true;
+        slots[i].key = s.key;
+        slots[i].val = std::move(s.val);
+      }
+    }
+    
+  public:
+    HashOverflowTable(): slots(), count(0), mask(0) {}
+    
+    void clear() { std::vector<Slot>().swap(slots); count = 0; mask = 0; }
+    
+    size_t size() const { return count; }
+    size_t capacity() const { return slots.size(); }
+    size_t bytes() const { return slots.capacity()*sizeof(Slot); }
+    
+    V * find(const K& key) {
+      if (count == 0) return nullptr;
+      for (size_t i = home(key); slots[i].full; i = (i+1) & mask) {
+        if (slots[i].key == key) return &slots[i].val;
       }
-      if (!found) {
-        entries.emplace_back(key, val);
+      return nullptr;
+    }
+    
+    /// Returned reference is only valid until the next insertion.
+    V& find_or_insert(const K& key) {
+      if (4*(count+1) > 3*slots.size()) grow();
+      size_t i = home(key);
+      for (; slots[i].full; i = (i+1) & mask) {
+        if (slots[i].key == key) return slots[i].val;
       }
+      ++hashmap_overflow_inserts;
+      count++;
+      slots[i].full = true;
+      slots[i].key = key;
+      return slots[i].val;
+    }
+    
+    /// Visit occupied slots in [begin,end) (clamped to the current capacity).
+    template< typename F >
+    void forall(size_t begin, size_t end, F visit) {
+      end = std::min(end, slots.size());
+      for (size_t i = begin; i < end; i++) {
+        if (slots[i].full) visit(slots[i].key, slots[i].val);
+      }
+    }
+  };
+  
+  /// Flat cell layout: as many entries as fit in the cell's block are stored
+  /// inline (no pointer to chase); the rest go to the core's overflow table.
+  template< typename K, typename V >
+  struct FlatHashCell {
+    typedef HashEntry<K,V> Entry;
+    typedef HashOverflowTable<K,V> Overflow;
+    
+    static const size_t NINLINE = (block_size > 2*sizeof(uint32_t)+sizeof(Entry))
+                                ? (block_size-2*sizeof(uint32_t)) / sizeof(Entry) : 1;
+    
+    uint32_t n;        ///< number of inline entries in use
+    uint32_t spilled;  ///< set once entries of this cell have gone to the overflow table
+    union { Entry slots[NINLINE]; };
+    
+    FlatHashCell(): n(0), spilled(0) {}
+    ~FlatHashCell() { clear(); }
+    
+    void clear() {
+      for (uint32_t i = 0; i < n; i++) slots[i].~Entry();
+      n = 0;
+      spilled = 0;
+    }
+    
+    size_t bytes() const { return sizeof(*this); }
+    
+    V * find(const K& key, Overflow& o) {
+      for (uint32_t i = 0; i < n; i++) if (slots[i].key == key) return &slots[i].val;
+      return spilled ? o.find(key) : nullptr;
+    }
+    
+    V& find_or_insert(const K& key, Overflow& o) {
+      for (uint32_t i = 0; i < n; i++) if (slots[i].key == key) return slots[i].val;
+      if (!spilled && n < NINLINE) {
+        new (&slots[n]) Entry(key);
+        return slots[n++].val;
+      }
+      spilled = 1;
+      return o.find_or_insert(key);
+    }
+    
+    template< typename F >
+    void forall(F visit) {
+      for (uint32_t i = 0; i < n; i++) visit(slots[i].key, slots[i].val);
     }
   } GRAPPA_BLOCK_ALIGNED;
+  
+} // namespace impl
+
+template< typename K, typename V, HashLayout L = HashLayout::Chained >
+class GlobalHashMap {
+public:
+  typedef impl::HashEntry<K,V> Entry;
+  
+  struct ResultEntry {
+    bool found;
+    ResultEntry * next;
+    V val;
+  };
+  
+public:
+  typedef typename std::conditional< L == HashLayout::Flat,
+                                     impl::FlatHashCell<K,V>,
+                                     impl::ChainedHashCell<K,V> >::type Cell;
 
   struct Proxy {
     static const size_t LOCAL_HASH_SIZE = 1<<10;
@@ -115,12 +277,13 @@ public:
     void sync() {
       CompletionEvent ce(map.size()+lookups.size());
       auto cea = make_global(&ce);
+      auto self = owner->self;
       
       for (auto& e : map) { auto& k = e.first; auto& v = e.second;
         ++hashmap_insert_msgs;
         auto cell = owner->base+owner->computeIndex(k);
-        send_heap_message(cell.core(), [cell,cea,k,v]{
-          cell->insert(k, v);
+        send_heap_message(cell.core(), [self,cell,cea,k,v]{
+          self->insert_local(cell.localize(), k, v);
           complete(cea);
         });
       }
@@ -131,15 +294,10 @@ public:
         DVLOG(3) << "lookup " << k << " with re = " << re;
         auto cell = owner->base+owner->computeIndex(k);
         
-        send_heap_message(cell.core(), [cell,k,cea,re]{
-          Cell * c = cell.localize();
-          bool found = false;
-          V val;
-          for (auto& e : c->entries) if (e.key == k) {
-            found = true;
-            val = e.val;
-            break;
-          }
+        send_heap_message(cell.core(), [self,cell,k,cea,re]{
+          auto result = self->lookup_local(cell.localize(), k);
+          bool found = result.first;
+          V val = result.second;
           send_heap_message(cea.core(), [cea,re,found,val]{
             ResultEntry * r = re;
             while (r != nullptr) {
@@ -161,6 +319,8 @@ public:
   size_t capacity;
   
   FlatCombiner<Proxy> proxy;
+  
+  typename Cell::Overflow overflow; // per-core secondary storage (flat layout only)
 
   uint64_t computeIndex(K key) {
     static std::hash<K> hasher;
@@ -171,10 +331,39 @@ public:
   GlobalHashMap( GlobalAddress<GlobalHashMap> self, GlobalAddress<Cell> base, size_t capacity )
     : self(self), base(base), capacity(capacity)
     , proxy(locale_new<Proxy>(this))
+    , overflow()
   {
     CHECK_LT(sizeof(self)+sizeof(base)+sizeof(capacity)+sizeof(proxy), 2*block_size);
   }
   
+  //
+  // operations on a cell, must be called on the core that owns it
+  //
+  
+  std::pair<bool,V> lookup_local(Cell * c, const K& key) {
+    V * v = c->find(key, overflow);
+    return v ? std::pair<bool,V>(true, *v) : std::pair<bool,V>(false, V());
+  }
+  
+  void insert_local(Cell * c, const K& key, const V& val) {
+    c->find_or_insert(key, overflow) = val;
+  }
+  
+  /// Visit the entries of cell `c`. For the flat layout, each local cell
+  /// also covers an equal slice of the core's overflow table, so a parallel
+  /// loop over all cells visits every entry exactly once.
+  template< typename F >
+  void visit_local(Cell * c, F visit) {
+    c->forall(visit);
+    size_t noverflow = overflow.capacity();
+    if (noverflow > 0) {
+      Cell * first = base.localize();
+      size_t nlocal = (base+capacity).localize() - first;
+      size_t i = c - first;
+      overflow.forall(i*noverflow/nlocal, (i+1)*noverflow/nlocal, visit);
+    }
+  }
+  
 public:
   // for static construction
   GlobalHashMap( ) {}
@@ -193,7 +382,9 @@ public:
   size_t ncells() { return this->capacity; }
   
   void clear() {
+    auto self = this->self;
     forall(base, capacity, [](Cell& c){ c.clear(); });
+    call_on_all_cores([self]{ self->overflow.clear(); });
   }
   
   void destroy() {
@@ -204,16 +395,109 @@ public:
     global_free(self);
   }
   
+  /// Total bytes used by the cells, their secondary storage, and the
+  /// per-core overflow tables (collective).
+  size_t footprint() {
+    auto self = this->self;
+    size_t nbytes = 0;
+    auto nb = make_global(&nbytes);
+    on_all_cores([self,nb]{
+      size_t local = self->overflow.bytes();
+      for (Cell& c : iterate_local(self->base, self->capacity)) local += c.bytes();
+      auto total = allreduce<size_t,collective_add>(local);
+      if (mycore() == nb.core()) *nb.pointer() = total;
+    });
+    return nbytes;
+  }
+  
   template< typename F >
   void forall_entries(F visit) {
-    forall(base, capacity, [visit](int64_t i, Cell& c){
-      // if cell is not hit then no action
-      if (c.entries == nullptr) return;
-      DVLOG(3) << "c<" << &c << "> entries:" << c.entries << " size: " << c.entries->size();
-      for (Entry& e : *c.entries) {
-        visit(e.key, *e.val);
+    auto self = this->self;
+    forall(base, capacity, [self,visit](int64_t i, Cell& c){
+      self->visit_local(&c, [visit](K& k, V& v){ visit(k, v); });
+    });
+  }
+  
+  /// Insert `n` pairs `keys[i] -> vals[i]` (collective).
+  ///
+  /// Each core stages its share of the input arrays, partitions it by the core
+  /// owning each key's cell, and ships packed payload messages that the owner
+  /// applies in a tight loop. Bypasses the flat-combining proxy; K and V must be
+  /// trivially copyable.
+  void insert_bulk(GlobalAddress<K> keys, GlobalAddress<V> vals, size_t n) {
+    auto self = this->self;
+    on_all_cores([self,keys,vals,n]{
+      auto r = impl::bulk_range(n);
+      std::vector<K> kbuf(impl::BULK_CHUNK);
+      std::vector<V> vbuf(impl::BULK_CHUNK);
+      std::vector<std::pair<K,V>> reqs(impl::BULK_CHUNK);
+      
+      for (size_t i = r.first; i < r.second; i += impl::BULK_CHUNK) {
+        size_t m = std::min(impl::BULK_CHUNK, r.second-i);
+        {
+          typename Incoherent<K>::RO ck(keys+i, m, &kbuf[0]);
+          typename Incoherent<V>::RO cv(vals+i, m, &vbuf[0]);
+          ck.start_acquire(); cv.start_acquire();
+          ck.block_until_acquired(); cv.block_until_acquired();
+        }
+        for (size_t j = 0; j < m; j++) reqs[j] = std::make_pair(kbuf[j], vbuf[j]);
+        
+        hashmap_insert_ops += m;
+        hashmap_insert_msgs += impl::bulk_apply(&reqs[0], m,
+          [self](const std::pair<K,V>& kv){
+            return (self->base+self->computeIndex(kv.first)).core();
+          },
+          [self](const std::pair<K,V>& kv){
+            auto cell = self->base+self->computeIndex(kv.first);
+            self->insert_local(cell.localize(), kv.first, kv.second);
+          });
+      }
+    });
+  }
+  
+  /// Look up `n` keys (collective): `vals[i]` is set to the value for
+  /// `keys[i]`, or `V()` if it is not in the map. Messages are batched the same
+  /// way as insert_bulk(), with results returned in packed replies.
+  ///
+  /// @return number of keys found
+  size_t lookup_bulk(GlobalAddress<K> keys, GlobalAddress<V> vals, size_t n) {
+    auto self = this->self;
+    size_t nfound = 0;
+    auto nf = make_global(&nfound);
+    on_all_cores([self,keys,vals,n,nf]{
+      auto r = impl::bulk_range(n);
+      std::vector<K> kbuf(impl::BULK_CHUNK);
+      std::vector<V> vbuf(impl::BULK_CHUNK);
+      std::vector<std::pair<bool,V>> reps(impl::BULK_CHUNK);
+      size_t found = 0;
+      
+      for (size_t i = r.first; i < r.second; i += impl::BULK_CHUNK) {
+        size_t m = std::min(impl::BULK_CHUNK, r.second-i);
+        {
+          typename Incoherent<K>::RO ck(keys+i, m, &kbuf[0]);
+          ck.block_until_acquired();
+        }
+        
+        hashmap_lookup_ops += m;
+        hashmap_lookup_msgs += impl::bulk_apply(&kbuf[0], &reps[0], m,
+          [self](const K& k){ return (self->base+self->computeIndex(k)).core(); },
+          [self](const K& k){
+            auto cell = self->base+self->computeIndex(k);
+            return self->lookup_local(cell.localize(), k);
+          });
+        
+        for (size_t j = 0; j < m; j++) {
+          if (reps[j].first) found++;
+          vbuf[j] = reps[j].second;
+        }
+        {
+          typename Incoherent<V>::WO cv(vals+i, m, &vbuf[0]);
+        }
       }
+      auto total = allreduce<size_t,collective_add>(found);
+      if (mycore() == nf.core()) *nf.pointer() = total;
     });
+    return nfound;
   }
   
   bool lookup(K key, V * val) {
@@ -239,8 +523,9 @@ public:
       return re.found;
     } else {
       ++hashmap_lookup_msgs;
-      auto result = delegate::call(base+computeIndex(key), [key](Cell* c){
-        return c->lookup(key);
+      auto self = this->self;
+      auto result = delegate::call(base+computeIndex(key), [self,key](Cell* c){
+        return self->lookup_local(c, key);
       });
       *val = result.second;
       return result.first;
@@ -253,7 +538,10 @@ public:
       proxy.combine([key,val](Proxy& p){ p.map[key] = val; return FCStatus::BLOCKED; });
     } else {
       ++hashmap_insert_msgs;
-      delegate::call(base+computeIndex(key), [key,val](Cell * c) { c->insert(key,val); });
+      auto self = this->self;
+      delegate::call(base+computeIndex(key), [self,key,val](Cell * c) {
+        self->insert_local(c, key, val);
+      });
     }
   }
     
@@ -262,19 +550,13 @@ public:
 template< SyncMode S = SyncMode::Blocking,
           GlobalCompletionEvent * C = &impl::local_gce,
           typename K = nullptr_t, typename V = nullptr_t,
+          HashLayout L = HashLayout::Chained,
           typename F = nullptr_t >
-void insert(GlobalAddress<GlobalHashMap<K,V>> self, K key, F on_insert) {
+void insert(GlobalAddress<GlobalHashMap<K,V,L>> self, K key, F on_insert) {
   ++hashmap_insert_msgs;
   delegate::call<S,C>(self->base+self->computeIndex(key),
-  [=](typename GlobalHashMap<K,V>::Cell& c){
-    for (auto& e : c.entries) {
-      if (e.key == key) {
-        on_insert(e.val);
-        return;
-      }
-    }
-    c.entries.emplace_back(key);
-    on_insert(c.entries.back().val);
+  [=](typename GlobalHashMap<K,V,L>::Cell& c){
+    on_insert(c.find_or_insert(key, self->overflow));
   });
 }
 
@@ -282,13 +564,12 @@ template< GlobalCompletionEvent * GCE = &impl::local_gce,
           int64_t Threshold = impl::USE_LOOP_THRESHOLD_FLAG,
           typename T = decltype(nullptr),
           typename V = decltype(nullptr),
+          HashLayout L = HashLayout::Chained,
           typename F = decltype(nullptr) >
-void forall(GlobalAddress<GlobalHashMap<T,V>> self, F visit) {
+void forall(GlobalAddress<GlobalHashMap<T,V,L>> self, F visit) {
   forall<GCE,Threshold>(self->begin(), self->ncells(),
-  [visit](typename GlobalHashMap<T,V>::Cell& c){
-    for (auto& e : c.entries) {
-      visit(e.key, e.val);
-    }
+  [self,visit](typename GlobalHashMap<T,V,L>::Cell& c){
+    self->visit_local(&c, visit);
   });
 }
 
@@ -29,6 +29,8 @@
 #include "Metrics.hpp"
 #include "Array.hpp"
 #include "FlatCombiner.hpp"
+#include "BulkApply.hpp"
+#include "Cache.hpp"
 
 #include <vector>
 #include <unordered_set>
@@ -223,6 +225,74 @@ public:
     }
   }
 
+  /// Inserts `n` keys (collective).
+  ///
+  /// Each core stages its share of `keys`, partitions it by the core owning
+  /// each key's cell, and ships packed payload messages that the owner applies
+  /// in a tight loop. Bypasses the flat-combining proxy.
+  void insert_bulk( GlobalAddress<K> keys, size_t n ) {
+    auto self = this->self;
+    on_all_cores([self,keys,n]{
+      auto r = impl::bulk_range(n);
+      std::vector<K> kbuf(impl::BULK_CHUNK);
+      
+      for (size_t i = r.first; i < r.second; i += impl::BULK_CHUNK) {
+        size_t m = std::min(impl::BULK_CHUNK, r.second-i);
+        {
+          typename Incoherent<K>::RO ck(keys+i, m, &kbuf[0]);
+          ck.block_until_acquired();
+        }
+        hashset_insert_ops += m;
+        hashset_insert_msgs += impl::bulk_apply(&kbuf[0], m,
+          [self](const K& k){ return (self->base+self->computeIndex(k)).core(); },
+          [self](const K& k){
+            Cell * c = (self->base+self->computeIndex(k)).localize();
+            for (auto& e : c->entries) if (e.key == k) return;
+            c->entries.emplace_back(k);
+          });
+      }
+    });
+  }
+  
+  /// Looks up `n` keys (collective), setting `found[i]` to whether `keys[i]`
+  /// is in the set. Batched the same way as insert_bulk().
+  ///
+  /// @return number of keys found
+  size_t lookup_bulk( GlobalAddress<K> keys, GlobalAddress<bool> found, size_t n ) {
+    auto self = this->self;
+    size_t total = 0;
+    auto tg = make_global(&total);
+    on_all_cores([self,keys,found,n,tg]{
+      auto r = impl::bulk_range(n);
+      std::vector<K> kbuf(impl::BULK_CHUNK);
+      std::unique_ptr<bool[]> fbuf(new bool[impl::BULK_CHUNK]);
+      size_t nfound = 0;
+      
+      for (size_t i = r.first; i < r.second; i += impl::BULK_CHUNK) {
+        size_t m = std::min(impl::BULK_CHUNK, r.second-i);
+        {
+          typename Incoherent<K>::RO ck(keys+i, m, &kbuf[0]);
+          ck.block_until_acquired();
+        }
+        hashset_lookup_ops += m;
+        hashset_lookup_msgs += impl::bulk_apply(&kbuf[0], fbuf.get(), m,
+          [self](const K& k){ return (self->base+self->computeIndex(k)).core(); },
+          [self](const K& k){
+            Cell * c = (self->base+self->computeIndex(k)).localize();
+            for (auto& e : c->entries) if (e.key == k) return true;
+            return false;
+          });
+        for (size_t j = 0; j < m; j++) if (fbuf[j]) nfound++;
+        {
+          typename Incoherent<bool>::WO cf(found+i, m, fbuf.get());
+        }
+      }
+      auto t = allreduce<size_t,collective_add>(nfound);
+      if (mycore() == tg.core()) *tg.pointer() = t;
+    });
+    return total;
+  }
+  
   /// Inserts the key if not already in the set.
   ///
   /// \note To guarantee completion, user must call 'sync_all_cores()' if any async operations have been done.
@@ -53,6 +53,9 @@ DEFINE_bool(insert_async, false, "do async inserts");
 DEFINE_double(fraction_lookups, 0.0, "fraction of accesses that should be lookups");
 
 GRAPPA_DEFINE_METRIC(SummarizingMetric<double>, trial_time, 0);
+GRAPPA_DEFINE_METRIC(SummarizingMetric<double>, flat_trial_time, 0);
+GRAPPA_DEFINE_METRIC(SimpleMetric<size_t>, map_footprint_bytes, 0);
+GRAPPA_DEFINE_METRIC(SimpleMetric<size_t>, flat_map_footprint_bytes, 0);
 
 template< typename T >
 inline T next_random() {
@@ -80,9 +83,9 @@ uint64_t identity_hash(long k) { return k; }
 enum class Exp { INSERT };
 
 template< Exp EXP,
-          typename K, typename V,
+          typename K, typename V, HashLayout L,
           int64_t          TH = impl::USE_LOOP_THRESHOLD_FLAG >
-double test_insert_throughput(GlobalAddress<GlobalHashMap<K,V>> ha) {
+double test_insert_throughput(GlobalAddress<GlobalHashMap<K,V,L>> ha) {
   double t = Grappa::walltime();
 
   forall<TH>(0, FLAGS_nelems, [ha](int64_t i){
@@ -99,9 +102,12 @@ double test_insert_throughput(GlobalAddress<GlobalHashMap<K,V>> ha) {
   return t;
 }
 
+long nvisited = 0, visited_sum = 0;
+
+template< HashLayout L >
 void test_correctness() {
-  LOG(INFO) << "Testing correctness...";
-  auto ha = GlobalHashMap<long,long>::create(FLAGS_global_hash_size);
+  LOG(INFO) << "Testing correctness (" << (L == HashLayout::Flat ? "flat" : "chained") << ")...";
+  auto ha = GlobalHashMap<long,long,L>::create(FLAGS_global_hash_size);
   for (int i=0; i<10; i++) {
     ha->insert(i, 42);
   }
@@ -119,9 +125,94 @@ void test_correctness() {
     BOOST_CHECK_EQUAL(val, 42);
   });
   
+  // more keys than cells, so flat cells spill into the overflow tables
+  auto nkeys = 4*FLAGS_global_hash_size;
+  forall(0, nkeys, [ha](int64_t i){
+    ha->insert(i, 7*i);
+  });
+  forall(0, nkeys, [ha](int64_t i){
+    long val;
+    BOOST_CHECK_EQUAL(ha->lookup(i, &val), true);
+    BOOST_CHECK_EQUAL(val, 7*i);
+  });
+  if (L == HashLayout::Flat) {
+    size_t spilled = 0;
+    for (Core c = 0; c < cores(); c++) {
+      spilled += delegate::call(c, []{ return hashmap_overflow_inserts.value(); });
+    }
+    BOOST_CHECK(spilled > 0);
+  }
+  
+  // iteration must visit spilled entries exactly once, too
+  on_all_cores([]{ nvisited = 0; visited_sum = 0; });
+  forall(ha, [](long key, long& val){
+    BOOST_CHECK_EQUAL(val, 7*key);
+    nvisited++; visited_sum += key;
+  });
+  BOOST_CHECK_EQUAL(reduce<long,collective_add>(&nvisited), nkeys);
+  BOOST_CHECK_EQUAL(reduce<long,collective_add>(&visited_sum), nkeys*(nkeys-1)/2);
+  
+  on_all_cores([]{ nvisited = 0; visited_sum = 0; });
+  ha->forall_entries([](long& key, long& val){
+    BOOST_CHECK_EQUAL(val, 7*key);
+    nvisited++; visited_sum += key;
+  });
+  BOOST_CHECK_EQUAL(reduce<long,collective_add>(&nvisited), nkeys);
+  BOOST_CHECK_EQUAL(reduce<long,collective_add>(&visited_sum), nkeys*(nkeys-1)/2);
+  
+  ha->destroy();
+}
+
+template< HashLayout L >
+void test_bulk() {
+  LOG(INFO) << "Testing bulk insert/lookup...";
+  auto ha = GlobalHashMap<long,long,L>::create(FLAGS_global_hash_size);
+  auto n = FLAGS_nelems;
+  auto keys = global_alloc<long>(2*n);
+  auto vals = global_alloc<long>(2*n);
+  
+  forall(keys, 2*n, [](int64_t i, long& k){ k = i; });
+  forall(vals, n, [](int64_t i, long& v){ v = 3*i; });
+  
+  ha->insert_bulk(keys, vals, n);
+  
+  // half of the looked-up keys were never inserted
+  forall(vals, 2*n, [](long& v){ v = -1; });
+  BOOST_CHECK_EQUAL(ha->lookup_bulk(keys, vals, 2*n), n);
+  forall(vals, 2*n, [n](int64_t i, long& v){
+    BOOST_CHECK_EQUAL(v, (i < n) ? 3*i : 0);
+  });
+  
+  long val;
+  BOOST_CHECK_EQUAL(ha->lookup(n-1, &val), true);
+  BOOST_CHECK_EQUAL(val, 3*(n-1));
+  
+  global_free(keys);
+  global_free(vals);
   ha->destroy();
 }
 
+void test_set_bulk() {
+  LOG(INFO) << "Testing bulk insert/lookup of GlobalHashSet...";
+  auto sa = GlobalHashSet<long>::create(FLAGS_global_hash_size);
+  auto n = FLAGS_nelems;
+  auto keys = global_alloc<long>(2*n);
+  auto found = global_alloc<bool>(2*n);
+  
+  // insert every key twice
+  forall(keys, 2*n, [n](int64_t i, long& k){ k = i % n; });
+  sa->insert_bulk(keys, 2*n);
+  BOOST_CHECK_EQUAL(sa->size(), n);
+  
+  forall(keys, 2*n, [](int64_t i, long& k){ k = i; });
+  BOOST_CHECK_EQUAL(sa->lookup_bulk(keys, found, 2*n), n);
+  forall(found, 2*n, [n](int64_t i, bool& f){ BOOST_CHECK_EQUAL(f, i < n); });
+  
+  global_free(keys);
+  global_free(found);
+  sa->destroy();
+}
+
 void test_set_correctness() {
   LOG(INFO) << "Testing correctness of GlobalHashSet...";
   auto sa = GlobalHashSet<long>::create(FLAGS_global_hash_size);
@@ -181,18 +272,33 @@ BOOST_AUTO_TEST_CASE( test1 ) {
     
       for (int i=0; i<FLAGS_ntrials; i++) {
         trial_time += test_insert_throughput<Exp::INSERT>(ha);
+        if (i == FLAGS_ntrials-1) map_footprint_bytes = ha->footprint();
         ha->clear();
       }
       
       ha->destroy();
+      
+      auto hf = GlobalHashMap<long,long,HashLayout::Flat>::create(FLAGS_global_hash_size);
+      
+      for (int i=0; i<FLAGS_ntrials; i++) {
+        flat_trial_time += test_insert_throughput<Exp::INSERT>(hf);
+        if (i == FLAGS_ntrials-1) flat_map_footprint_bytes = hf->footprint();
+        hf->clear();
+      }
+      
+      hf->destroy();
     
     } else if (FLAGS_set_perf) { 
       for (int i=0; i<FLAGS_ntrials; i++) {
         trial_time += test_set_insert_throughput();
       }
     } else {
-      test_correctness();
+      test_correctness<HashLayout::Chained>();
+      test_correctness<HashLayout::Flat>();
       test_set_correctness();
+      test_bulk<HashLayout::Chained>();
+      test_bulk<HashLayout::Flat>();
+      test_set_bulk();
     }
   
     Metrics::merge_and_print();
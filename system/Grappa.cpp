@@ -74,6 +74,7 @@ DECLARE_double(locale_shared_fraction);
 
 DECLARE_bool(logtostderr);
 DECLARE_int32(v);
+DECLARE_bool( metrics_series_enable );
 
 
 using namespace Grappa::impl;
@@ -557,6 +558,10 @@ void Grappa_init( int * argc_p, char ** argv_p[], int64_t global_memory_size_byt
            << " num_starting_workers=" << FLAGS_num_starting_workers;
   global_task_manager.init( Grappa::mycore(), node_neighbors, Grappa::cores() ); //TODO: options for local stealing
   global_scheduler.init( master_thread, &global_task_manager );
+
+  if( FLAGS_metrics_series_enable ) {
+    Grappa::Metrics::start_series_here();
+  }
   
   VLOG(2) << "Scheduler initialized.";
   
@@ -703,6 +708,7 @@ int Grappa_finish( int retval )
 
   DVLOG(1) << "Cleaning up Grappa library....";
 
+  Grappa::Metrics::stop_series_here();
   StateTimer::finish();
 
   global_task_manager.finish();
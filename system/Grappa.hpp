@@ -45,6 +45,8 @@
 #include "Delegate.hpp"
 #include "AsyncDelegate.hpp"
 #include "Collective.hpp"
+#include "Scan.hpp"
+#include "Shuffle.hpp"
 #include "ParallelLoop.hpp"
 #include "GlobalAllocator.hpp"
 // #include "Cache.hpp"
@@ -0,0 +1,108 @@
+////////////////////////////////////////////////////////////////////////
+// This file is part of Grappa, a system for scaling irregular
+// applications on commodity clusters. 
+
+// Copyright (C) 2010-2014 University of Washington and Battelle
+// Memorial Institute. University of Washington authorizes use of this
+// Grappa software.
+
+// Grappa is free software: you can redistribute it and/or modify it
+// under the terms of the Affero General Public License as published
+// by Affero, Inc., either version 1 of the License, or (at your
+// option) any later version.
+
+// Grappa is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// Affero General Public License for more details.
+
+// You should have received a copy of the Affero General Public
+// License along with this program. If not, you may obtain one from
+// http://www.affero.org/oagpl.html.
+////////////////////////////////////////////////////////////////////////
+
+#include "LatencyHistogramMetric.hpp"
+#include "Delegate.hpp"
+
+namespace Grappa {
+
+  double LatencyHistogramMetric::stddev() const {
+    if (n_ < 2) return 0.0;
+    double m = mean();
+    double var = (sum_sq_ - n_ * m * m) / (n_ - 1);
+    return var > 0 ? sqrt(var) : 0.0;
+  }
+
+  double LatencyHistogramMetric::percentile(double q) const {
+    if (n_ == 0) return 0.0;
+    // rank of the sample we want, counting from 1
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(ceil(q * n_)));
+    uint64_t seen = 0;
+    for (int i = 0; i < NBUCKETS; i++) {
+      seen += counts_[i];
+      if (seen >= rank) {
+        double mid = bucket_lower(i) + (bucket_upper(i) - bucket_lower(i)) / 2.0;
+        return std::min<double>(std::max<double>(mid, min_), max_);
+      }
+    }
+    return max_;
+  }
+
+  std::ostream& LatencyHistogramMetric::json(std::ostream& o) const {
+    o << '"' << name << "\": " << sum_ << ", ";
+    o << '"' << name << "_count\": " << n_ << ", ";
+    o << '"' << name << "_mean\": " << mean() << ", ";
+    o << '"' << name << "_stddev\": " << stddev() << ", ";
+    o << '"' << name << "_min\": " << (n_ ? min_ : 0) << ", ";
+    o << '"' << name << "_max\": " << max_ << ", ";
+    o << '"' << name << "_p50\": " << percentile(0.5) << ", ";
+    o << '"' << name << "_p99\": " << percentile(0.99) << ", ";
+    o << '"' << name << "_p999\": " << percentile(0.999);
+    return o;
+  }
+
+  void LatencyHistogramMetric::merge_all(impl::MetricBase* static_stat_ptr) {
+    reset();
+    LatencyHistogramMetric* this_static = reinterpret_cast<LatencyHistogramMetric*>(static_stat_ptr);
+
+    // buckets are fetched in blocks, skipping blocks that are all zero
+    const int BLOCK = 64;
+    const int NBLOCKS = (NBUCKETS + BLOCK - 1) / BLOCK;
+    struct Summary { uint64_t n, min, max; double sum, sum_sq; uint64_t nonzero_blocks; };
+    struct Block { uint64_t counts[BLOCK]; };
+    static_assert(NBLOCKS <= 64, "nonzero block mask is 64 bits");
+
+    for (Core c = 0; c < Grappa::cores(); c++) {
+      // we can use the pointer on every core because it points to a global
+      auto s = delegate::call(c, [this_static]() -> Summary {
+        Summary s = { this_static->n_, this_static->min_, this_static->max_,
+                      this_static->sum_, this_static->sum_sq_, 0 };
+        for (int i = 0; i < NBUCKETS; i++) {
+          if (this_static->counts_[i]) s.nonzero_blocks |= uint64_t(1) << (i / BLOCK);
+        }
+        return s;
+      });
+      if (s.n == 0) continue;
+
+      n_ += s.n;
+      sum_ += s.sum;
+      sum_sq_ += s.sum_sq;
+      min_ = std::min(min_, s.min);
+      max_ = std::max(max_, s.max);
+
+      for (int b = 0; b < NBLOCKS; b++) {
+        if (!(s.nonzero_blocks & (uint64_t(1) << b))) continue;
+        auto blk = delegate::call(c, [this_static,b]() -> Block {
+          Block blk;
+          for (int i = 0; i < BLOCK; i++) {
+            int j = b * BLOCK + i;
+            blk.counts[i] = j < NBUCKETS ? this_static->counts_[j] : 0;
+          }
+          return blk;
+        });
+        for (int i = 0; i < BLOCK && b * BLOCK + i < NBUCKETS; i++) counts_[b * BLOCK + i] += blk.counts[i];
+      }
+    }
+  }
+
+} // namespace Grappa
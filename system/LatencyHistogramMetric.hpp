@@ -0,0 +1,142 @@
+////////////////////////////////////////////////////////////////////////
+// This file is part of Grappa, a system for scaling irregular
+// applications on commodity clusters. 
+
+// Copyright (C) 2010-2014 University of Washington and Battelle
+// Memorial Institute. University of Washington authorizes use of this
+// Grappa software.
+
+// Grappa is free software: you can redistribute it and/or modify it
+// under the terms of the Affero General Public License as published
+// by Affero, Inc., either version 1 of the License, or (at your
+// option) any later version.
+
+// Grappa is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// Affero General Public License for more details.
+
+// You should have received a copy of the Affero General Public
+// License along with this program. If not, you may obtain one from
+// http://www.affero.org/oagpl.html.
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MetricBase.hpp"
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+namespace Grappa {
+  /// @addtogroup Utility
+  /// @{
+
+  /// Metric that keeps a full distribution of non-negative integer samples
+  /// (typically latencies in ticks) in fixed log-linear buckets, HDR-histogram
+  /// style: values below 2^SUB_BITS get their own bucket and every power of two
+  /// above that is split into 2^(SUB_BITS-1) equal buckets, so any value is
+  /// recorded with under 1/2^(SUB_BITS-1) relative error.
+  ///
+  /// Recording a sample is a few integer ops and an increment on this core's
+  /// bucket array; merging sums bucket counts exactly, so merged percentiles
+  /// are as accurate as local ones. Prints the same fields as a
+  /// SummarizingMetric plus p50, p99 and p999.
+  class LatencyHistogramMetric : public impl::MetricBase {
+  public:
+    static const int SUB_BITS = 5;
+    static const int64_t SUB_COUNT = 1 << SUB_BITS;
+    static const int64_t HALF_COUNT = SUB_COUNT / 2;
+    static const int NBUCKETS = (64 - SUB_BITS + 1) * HALF_COUNT;
+
+    /// bucket holding value v (v >= 0)
+    static inline int bucket_index(uint64_t v) {
+      if (v < SUB_COUNT) return v;
+      int shift = (63 - __builtin_clzll(v)) - (SUB_BITS - 1);
+      return shift * HALF_COUNT + (v >> shift);
+    }
+
+    /// smallest value recorded in bucket i
+    static inline uint64_t bucket_lower(int i) {
+      if (i < SUB_COUNT) return i;
+      int shift = i / HALF_COUNT - 1;
+      return static_cast<uint64_t>(i - shift * HALF_COUNT) << shift;
+    }
+
+    /// largest value recorded in bucket i
+    static inline uint64_t bucket_upper(int i) {
+      if (i < SUB_COUNT) return i;
+      int shift = i / HALF_COUNT - 1;
+      return bucket_lower(i) + ((uint64_t(1) << shift) - 1);
+    }
+
+  protected:
+    uint64_t counts_[NBUCKETS];
+    uint64_t n_;
+    double sum_;
+    double sum_sq_;
+    uint64_t min_;
+    uint64_t max_;
+
+  public:
+    /// (initial value is accepted for GRAPPA_DEFINE_METRIC; histograms start empty)
+    LatencyHistogramMetric(const char * name, int64_t initial_value = 0, bool reg_new = true)
+      : impl::MetricBase(name, reg_new) {
+      reset();
+    }
+
+    virtual void reset() {
+      std::fill(counts_, counts_ + NBUCKETS, 0);
+      n_ = 0;
+      sum_ = sum_sq_ = 0;
+      min_ = std::numeric_limits<uint64_t>::max();
+      max_ = 0;
+    }
+
+    /// record one sample (negative values are recorded as 0)
+    inline void add(int64_t value) {
+      uint64_t v = value < 0 ? 0 : value;
+      counts_[bucket_index(v)]++;
+      n_++;
+      sum_ += v;
+      sum_sq_ += static_cast<double>(v) * v;
+      if (v < min_) min_ = v;
+      if (v > max_) max_ = v;
+    }
+
+    // <sugar>
+    template<typename U>
+    inline LatencyHistogramMetric& operator+=(U value) {
+      add(static_cast<int64_t>(value));
+      return *this;
+    }
+    // </sugar>
+
+    inline uint64_t count() const { return n_; }
+    inline double mean() const { return n_ ? sum_ / n_ : 0.0; }
+    double stddev() const;
+
+    /// estimate of the value at quantile q (0 <= q <= 1): the middle of the
+    /// bucket holding it, clamped to the observed min and max
+    double percentile(double q) const;
+
+    virtual std::ostream& json(std::ostream& o) const;
+
+    virtual void sample() { }
+
+    virtual LatencyHistogramMetric* clone() const {
+      // (note: must do `reg_new`=false so we don't re-register this stat)
+      return new LatencyHistogramMetric(name, 0, false);
+    }
+
+    virtual void merge_all(impl::MetricBase* static_stat_ptr);
+
+    virtual bool numeric_value(double * out) const {
+      *out = sum_;
+      return true;
+    }
+  };
+
+  /// @}
+} // namespace Grappa
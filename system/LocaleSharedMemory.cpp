@@ -205,6 +205,12 @@ void * LocaleSharedMemory::allocate_aligned( size_t size, size_t alignment ) {
   return p;
 }
 
+void * LocaleSharedMemory::try_allocate_aligned( size_t size, size_t alignment ) {
+  void * p = segment.allocate_aligned( size, alignment, std::nothrow );
+  if( p ) allocated += size;
+  return p;
+}
+
 void LocaleSharedMemory::deallocate( void * ptr ) {
   try {
     segment.deallocate( ptr );
@@ -80,6 +80,8 @@ public:
 
   void * allocate( size_t size );
   void * allocate_aligned( size_t size, size_t alignment );
+  /// Like allocate_aligned, but returns NULL instead of failing if there isn't room.
+  void * try_allocate_aligned( size_t size, size_t alignment );
   void deallocate( void * ptr );
 
   const size_t get_free_memory() const { return segment.get_free_memory(); }
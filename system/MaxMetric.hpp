@@ -92,6 +92,13 @@ namespace Grappa {
     
     virtual void merge_all(impl::MetricBase* static_stat_ptr);
 
+    virtual bool numeric_value(double * out) const {
+      *out = static_cast<double>(value_);
+      return true;
+    }
+
+    virtual bool merges_by_max() const { return true; }
+
     inline const MaxMetric<T>& count() { return (*this)++; }
 
     /// Get the current value
@@ -51,6 +51,15 @@ namespace Grappa {
       
       /// create new copy of the class of the right instance (needed so we can create new copies of stats from their MetricBase pointer
       virtual MetricBase* clone() const = 0;
+      
+      /// current value as a double, for time-series sampling; returns false
+      /// if this kind of stat does not have a single numeric value
+      virtual bool numeric_value(double * out) const { return false; }
+      
+      /// true if values from different cores combine by max rather than sum
+      virtual bool merges_by_max() const { return false; }
+      
+      const char * metric_name() const { return name; }
     };
     
   }
@@ -30,6 +30,7 @@
 #include <fstream>
 #include <sstream>
 #include <cstdint>
+#include <unordered_map>
 #include "Collective.hpp"
 #include <boost/filesystem.hpp>
 namespace fs = boost::filesystem;
@@ -41,6 +42,7 @@ DEFINE_bool( stats_blob_enable, true, "Enable stats dumping" );
 
 
 DECLARE_string(stats_blob_filename);
+DECLARE_bool(stack_high_water);
 
 #ifdef VTRACE_SAMPLED
 #include <vt_user.h>
@@ -129,6 +131,9 @@ namespace Grappa {
     void merge(MetricList& result) {
       result.clear(); // ensure it's empty
       
+      // stack usage takes a syscall per worker, so only measure it when asked
+      if (FLAGS_stack_high_water) call_on_all_cores([]{ impl::record_stack_high_water(); });
+      
       for (Grappa::impl::MetricBase * local_stat : Grappa::impl::registered_stats()) {
         Grappa::impl::MetricBase* merge_target = local_stat->clone();
         result.push_back(merge_target); // slot for merged stat
@@ -244,5 +249,133 @@ namespace Grappa {
         stat->sample();
       }
     }
+    
+    void print_regions(std::ostream& out) {
+      std::ostringstream o;
+      o << "REGIONS{\n";
+      auto& results = MetricsRegion::results();
+      for (size_t r = 0; r < results.size(); r++) {
+        if (r != 0) o << ",\n";
+        o << "  { \"region\": \"" << results[r].name << "\", \"time\": " << results[r].time;
+        for (auto& d : results[r].deltas) {
+          o << ", \"" << d.first << "\": " << d.second;
+        }
+        o << " }";
+      }
+      o << "\n}REGIONS";
+      out << o.str() << std::endl;
+    }
+  }
+  
+  namespace impl {
+    /// this core's snapshots for each open region, by region id
+    static std::unordered_map<int64_t,std::vector<double>> region_snapshots;
+    
+    /// this core's nonzero deltas (metric index, delta) for a finished region
+    struct RegionDeltas {
+      int64_t id;
+      std::vector<std::pair<size_t,double>> deltas;
+    };
+    /// deltas of regions finished since the last merge, in the order they
+    /// ended (the same on every core, since regions end on all cores at once)
+    static std::vector<RegionDeltas> region_deltas;
+    /// name and time of regions created on this core awaiting merge, by id
+    static std::unordered_map<int64_t,std::pair<std::string,double>> region_pending;
+    
+    static std::vector<MetricsRegion::Result> region_results;
+    static int64_t region_count = 0;
+    
+    static void snapshot_numeric(std::vector<double>& values) {
+      auto& stats = registered_stats();
+      values.resize(stats.size());
+      for (size_t i = 0; i < stats.size(); i++) {
+        if (!stats[i]->numeric_value(&values[i])) values[i] = 0;
+      }
+    }
+    
+    /// Combine the per-core deltas of all regions finished since the last
+    /// merge (summing them, or taking the max for metrics that merge by max)
+    /// and record the results on the cores that created the regions.
+    static void merge_regions() {
+      on_all_cores([]{
+        auto& stats = registered_stats();
+        size_t nstats = stats.size();
+        size_t nregions = region_deltas.size();
+        if (nregions == 0) return;
+        
+        std::vector<double> sums(nregions * nstats, 0);
+        std::vector<double> maxes(nregions * nstats, 0);
+        bool any_max = false;
+        for (size_t r = 0; r < nregions; r++) {
+          for (auto& d : region_deltas[r].deltas) {
+            if (stats[d.first]->merges_by_max()) {
+              maxes[r*nstats + d.first] = d.second;
+            } else {
+              sums[r*nstats + d.first] = d.second;
+            }
+          }
+        }
+        for (auto* stat : stats) any_max = any_max || stat->merges_by_max();
+        allreduce_inplace<double,collective_add>(sums.data(), sums.size());
+        if (any_max) {
+          allreduce_inplace<double,collective_max>(maxes.data(), maxes.size());
+          for (size_t i = 0; i < sums.size(); i++) {
+            if (stats[i % nstats]->merges_by_max()) sums[i] = maxes[i];
+          }
+        }
+        
+        for (size_t r = 0; r < nregions; r++) {
+          auto it = region_pending.find(region_deltas[r].id);
+          if (it == region_pending.end()) continue;
+          MetricsRegion::Result result{ it->second.first, it->second.second, {} };
+          for (size_t i = 0; i < nstats; i++) {
+            double d = sums[r*nstats + i];
+            if (d != 0) result.deltas.emplace_back(stats[i]->metric_name(), d);
+          }
+          region_results.push_back(result);
+          region_pending.erase(it);
+        }
+        region_deltas.clear();
+      });
+    }
+  }
+  
+  MetricsRegion::MetricsRegion(const std::string& name, bool enable)
+    : name(name), enabled(enable), id(-1), start_time(0)
+  {
+    if (!enabled) return;
+    // unique across cores so regions started from different cores don't collide
+    id = impl::region_count++ * cores() + mycore();
+    auto region_id = id;
+    call_on_all_cores([region_id]{
+      impl::snapshot_numeric(impl::region_snapshots[region_id]);
+    });
+    start_time = walltime();
+  }
+  
+  MetricsRegion::~MetricsRegion() {
+    if (!enabled) return;
+    double elapsed = walltime() - start_time;
+    auto region_id = id;
+    // only record each core's own deltas here; they are summed across cores
+    // in one batch when results are asked for
+    call_on_all_cores([region_id]{
+      auto it = impl::region_snapshots.find(region_id);
+      std::vector<double> now;
+      impl::snapshot_numeric(now);
+      impl::RegionDeltas rd{ region_id, {} };
+      for (size_t i = 0; i < it->second.size(); i++) {
+        double d = now[i] - it->second[i];
+        if (d != 0) rd.deltas.emplace_back(i, d);
+      }
+      impl::region_deltas.push_back(rd);
+      impl::region_snapshots.erase(it);
+    });
+    impl::region_pending[region_id] = std::make_pair(name, elapsed);
+  }
+  
+  const std::vector<MetricsRegion::Result>& MetricsRegion::results() {
+    impl::merge_regions();
+    return impl::region_results;
   }
 } // namespace Grappa
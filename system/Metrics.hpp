@@ -25,6 +25,7 @@
 
 #include <iostream>
 #include <vector>
+#include <string>
 
 #include "MetricBase.hpp"
 #include "SimpleMetric.hpp"
@@ -32,6 +33,7 @@
 #include "SummarizingMetric.hpp"
 #include "CallbackMetric.hpp"
 #include "MaxMetric.hpp"
+#include "LatencyHistogramMetric.hpp"
 
 /// @addtogroup Utility
 /// @{
@@ -46,6 +48,12 @@ namespace Grappa {
     
     extern bool take_tracing_sample;
     void set_exe_name( char * name );
+    
+    /// timestamp of next time-series sample (max value when not recording)
+    extern int64_t next_series_ts;
+    
+    /// record a time-series sample of the selected metrics (called by the scheduler)
+    void sample_series( int64_t current_ts );
   }
   
   namespace Metrics {
@@ -89,8 +97,69 @@ namespace Grappa {
     
     /// Only call 'stop_tracing' on this core (use in SPMD context)
     void stop_tracing_here();
+    
+    /// Start recording samples of the metrics named by '--metrics_series' every
+    /// '--metrics_series_ticks' into this core's time-series file (see
+    /// MetricsSeries.cpp). Done at init when '--metrics_series_enable' is set.
+    void start_series_here();
+    
+    /// Flush remaining samples and close this core's time-series file.
+    void stop_series_here();
+    
+    /// Print one JSON object per finished MetricsRegion created on this core,
+    /// inside "REGIONS{ }REGIONS" bookends. Blocks on all cores to merge the
+    /// regions' deltas (see MetricsRegion::results).
+    void print_regions(std::ostream& out = std::cerr);
   }
   
+  /// Scoped measurement of one phase of a program. On construction, every core
+  /// snapshots its registered numeric metrics; on destruction, every core diffs
+  /// against its snapshot and keeps its own deltas. The deltas of all finished
+  /// regions are summed across cores (MaxMetric deltas take the max) in one
+  /// batch, onto the cores that created them, only when results() (or
+  /// Metrics::print_regions) is called. Nothing
+  /// is reset, so regions may be nested and the global totals are unaffected.
+  ///
+  /// Construction and destruction block on all cores (like `call_on_all_cores`),
+  /// so create regions from a single task (usually user_main), and don't open
+  /// regions from several tasks at once.
+  ///
+  /// @b Example:
+  /// @code
+  ///   {
+  ///     MetricsRegion r("bfs_level_3");
+  ///     forall(frontier, ...);
+  ///   } // deltas recorded here
+  ///   Metrics::print_regions();
+  /// @endcode
+  class MetricsRegion {
+  public:
+    /// Deltas recorded for a finished region (only metrics that changed).
+    struct Result {
+      std::string name;
+      double time;
+      std::vector<std::pair<std::string,double>> deltas;
+    };
+    
+    /// @param enable  if false, the region does nothing (to make regions optional)
+    explicit MetricsRegion(const std::string& name, bool enable = true);
+    ~MetricsRegion();
+    
+    /// Regions created on this core, in the order they ended. Merges the
+    /// deltas of regions finished since the last call, so like the regions
+    /// themselves this blocks on all cores and must be called from one task.
+    static const std::vector<Result>& results();
+    
+  private:
+    std::string name;
+    bool enabled;
+    int64_t id;
+    double start_time;
+    
+    MetricsRegion(const MetricsRegion&) = delete;
+    MetricsRegion& operator=(const MetricsRegion&) = delete;
+  };
+  
 } // namespace Grappa
 
 /// make statistics printable
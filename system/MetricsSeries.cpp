@@ -0,0 +1,210 @@
+////////////////////////////////////////////////////////////////////////
+// This file is part of Grappa, a system for scaling irregular
+// applications on commodity clusters.
+
+// Copyright (C) 2010-2014 University of Washington and Battelle
+// Memorial Institute. University of Washington authorizes use of this
+// Grappa software.
+
+// Grappa is free software: you can redistribute it and/or modify it
+// under the terms of the Affero General Public License as published
+// by Affero, Inc., either version 1 of the License, or (at your
+// option) any later version.
+
+// Grappa is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// Affero General Public License for more details.
+
+// You should have received a copy of the Affero General Public
+// License along with this program. If not, you may obtain one from
+// http://www.affero.org/oagpl.html.
+////////////////////////////////////////////////////////////////////////
+
+/// Time-series sampling of metrics.
+///
+/// Each core snapshots the selected metrics every '--metrics_series_ticks'
+/// (checked by the scheduler) into one half of a double buffer. When a half
+/// fills, it is handed to a writer thread and sampling continues in the other
+/// half, so file IO never blocks the core. If the writer falls behind, samples
+/// are dropped and counted rather than stalling the run.
+///
+/// Each core writes `<prefix>.<core>.series`:
+///
+///   char[8] "GRPSER1"   magic
+///   int32   core, cores, nmetrics, reserved
+///   double  walltime at start
+///   nmetrics NUL-terminated metric names
+///   records of (1+nmetrics) doubles: seconds since start, then values
+///
+/// util/merge_metrics_series.rb merges the per-core files into one CSV.
+
+#include "Metrics.hpp"
+#include "Communicator.hpp"
+#include "common.hpp"
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+DEFINE_bool( metrics_series_enable, false, "Record time-series samples of metrics to per-core files" );
+DEFINE_string( metrics_series, "", "Comma-separated names of metrics to sample (empty for all numeric metrics)" );
+DEFINE_int64( metrics_series_ticks, 200000000L, "Number of ticks between time-series samples" );
+DEFINE_string( metrics_series_prefix, "metrics", "Time-series samples go to <prefix>.<core>.series" );
+DEFINE_int64( metrics_series_buffer_samples, 1024, "Samples each core buffers before handing them to the writer thread" );
+
+GRAPPA_DEFINE_METRIC(SimpleMetric<uint64_t>, metrics_series_samples, 0);
+GRAPPA_DEFINE_METRIC(SimpleMetric<uint64_t>, metrics_series_dropped, 0);
+
+namespace Grappa {
+  namespace impl {
+
+    int64_t next_series_ts = std::numeric_limits<int64_t>::max();
+
+    class SeriesRecorder {
+      std::vector<MetricBase*> metrics;
+      size_t record_size;            // doubles per sample
+      size_t capacity;               // samples per buffer
+      std::vector<double> buffers[2];
+      int current;                   // buffer being filled
+      size_t fill;                   // samples in current buffer
+      double start_time;
+
+      std::ofstream out;
+      std::thread writer;
+      std::mutex lock;
+      std::condition_variable cv;
+      int pending;                   // buffer waiting for the writer, or -1
+      size_t pending_samples;
+      bool stopping;
+
+      void write_loop() {
+        std::unique_lock<std::mutex> l(lock);
+        while (true) {
+          cv.wait(l, [this]{ return pending >= 0 || stopping; });
+          if (pending < 0) return;
+          int b = pending;
+          size_t n = pending_samples;
+          l.unlock();
+          out.write(reinterpret_cast<char*>(buffers[b].data()), n * record_size * sizeof(double));
+          out.flush();
+          l.lock();
+          pending = -1;
+          cv.notify_all();
+        }
+      }
+
+      /// hand the current buffer to the writer; returns false if it is still busy
+      bool hand_off(bool wait) {
+        std::unique_lock<std::mutex> l(lock);
+        if (wait) cv.wait(l, [this]{ return pending < 0; });
+        if (pending >= 0) return false;
+        pending = current;
+        pending_samples = fill;
+        cv.notify_all();
+        current ^= 1;
+        fill = 0;
+        return true;
+      }
+
+    public:
+      SeriesRecorder(const std::string& path, const std::string& names)
+        : current(0), fill(0), pending(-1), pending_samples(0), stopping(false)
+      {
+        std::vector<std::string> selected;
+        std::stringstream ss(names);
+        std::string name;
+        while (std::getline(ss, name, ',')) if (!name.empty()) selected.push_back(name);
+
+        for (auto* m : registered_stats()) {
+          double v;
+          if (!m->numeric_value(&v)) continue;
+          if (!selected.empty() &&
+              std::find(selected.begin(), selected.end(), m->metric_name()) == selected.end()) continue;
+          metrics.push_back(m);
+        }
+        if (metrics.size() < selected.size()) {
+          LOG(WARNING) << "Only " << metrics.size() << " of " << selected.size()
+                       << " metrics in --metrics_series are registered numeric metrics";
+        }
+
+        record_size = 1 + metrics.size();
+        capacity = std::max<int64_t>(1, FLAGS_metrics_series_buffer_samples);
+        buffers[0].resize(capacity * record_size);
+        buffers[1].resize(capacity * record_size);
+        start_time = Grappa::walltime();
+
+        out.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        CHECK( out.is_open() ) << "failed to open " << path;
+        const char magic[8] = "GRPSER1";
+        int32_t header[4] = { Grappa::mycore(), Grappa::cores(), static_cast<int32_t>(metrics.size()), 0 };
+        out.write(magic, sizeof(magic));
+        out.write(reinterpret_cast<char*>(header), sizeof(header));
+        out.write(reinterpret_cast<char*>(&start_time), sizeof(start_time));
+        for (auto* m : metrics) out.write(m->metric_name(), strlen(m->metric_name())+1);
+
+        writer = std::thread([this]{ write_loop(); });
+      }
+
+      void sample() {
+        if (fill == capacity && !hand_off(false)) {
+          metrics_series_dropped++;
+          return;
+        }
+        double * r = &buffers[current][fill * record_size];
+        r[0] = Grappa::walltime() - start_time;
+        for (size_t i=0; i<metrics.size(); i++) metrics[i]->numeric_value(&r[1+i]);
+        fill++;
+        metrics_series_samples++;
+      }
+
+      ~SeriesRecorder() {
+        hand_off(true);
+        {
+          std::unique_lock<std::mutex> l(lock);
+          cv.wait(l, [this]{ return pending < 0; });
+          stopping = true;
+          cv.notify_all();
+        }
+        writer.join();
+        out.close();
+      }
+    };
+
+    static SeriesRecorder * series_recorder = nullptr;
+
+    void sample_series( int64_t current_ts ) {
+      next_series_ts = current_ts + FLAGS_metrics_series_ticks;
+      if (series_recorder) series_recorder->sample();
+    }
+
+  } // namespace impl
+
+  namespace Metrics {
+
+    void start_series_here() {
+      if (impl::series_recorder) return;
+      std::ostringstream path;
+      path << FLAGS_metrics_series_prefix << "." << Grappa::mycore() << ".series";
+      impl::series_recorder = new impl::SeriesRecorder(path.str(), FLAGS_metrics_series);
+      impl::next_series_ts = 0; // take first sample right away
+    }
+
+    void stop_series_here() {
+      if (!impl::series_recorder) return;
+      impl::next_series_ts = std::numeric_limits<int64_t>::max();
+      impl::series_recorder->sample(); // final state
+      delete impl::series_recorder;
+      impl::series_recorder = nullptr;
+    }
+
+  } // namespace Metrics
+} // namespace Grappa
@@ -22,6 +22,7 @@
 ////////////////////////////////////////////////////////////////////////
 
 #include <iostream>
+#include <fstream>
 #include <boost/test/unit_test.hpp>
 #include "Grappa.hpp"
 #include "Metrics.hpp"
@@ -56,6 +57,11 @@ GRAPPA_DEFINE_METRIC(MaxMetric<uint64_t>, maz, 0);
 GRAPPA_DEFINE_METRIC(StringMetric, foostr, "");
 #define I_FOOSTR 5
 
+GRAPPA_DEFINE_METRIC(LatencyHistogramMetric, lat, 0);
+#define I_LAT 6
+
+GRAPPA_DECLARE_METRIC(SimpleMetric<uint64_t>, metrics_series_samples);
+
 BOOST_AUTO_TEST_CASE( test1 ) {
   Grappa::init( GRAPPA_TEST_ARGS );
   Grappa::run([]{
@@ -137,6 +143,69 @@ BOOST_AUTO_TEST_CASE( test1 ) {
   
     call_on_all_cores([]{ Metrics::reset(); });
     Metrics::merge_and_print();
+
+    // latency histogram: exact below 32, bounded relative error above
+    BOOST_CHECK_EQUAL( LatencyHistogramMetric::bucket_index(31), 31 );
+    for (uint64_t v : {32UL, 1000UL, 123456789UL, 1UL<<62}) {
+      int b = LatencyHistogramMetric::bucket_index(v);
+      BOOST_CHECK( LatencyHistogramMetric::bucket_lower(b) <= v );
+      BOOST_CHECK( v <= LatencyHistogramMetric::bucket_upper(b) );
+      BOOST_CHECK( LatencyHistogramMetric::bucket_upper(b) - LatencyHistogramMetric::bucket_lower(b) <= v / 16 );
+    }
+    on_all_cores([]{
+      for (int i=1; i<=1000; i++) lat += i;
+    });
+    BOOST_CHECK_EQUAL( lat.count(), 1000 );
+    BOOST_CHECK( std::abs(lat.percentile(0.5) - 500) <= 500/16 );
+    BOOST_CHECK( std::abs(lat.percentile(0.99) - 990) <= 990/16 );
+    BOOST_CHECK_EQUAL( lat.percentile(1.0), 1000 );
+    {
+      std::vector<impl::MetricBase*> all;
+      Metrics::merge(all);
+      auto merged = reinterpret_cast<LatencyHistogramMetric*>(all[I_LAT]);
+      BOOST_CHECK_EQUAL( merged->count(), 1000 * Grappa::cores() );
+      BOOST_CHECK_EQUAL( merged->percentile(0.5), lat.percentile(0.5) );
+      BOOST_CHECK_EQUAL( merged->percentile(0.999), lat.percentile(0.999) );
+    }
+
+    // regions: deltas summed over cores (max for MaxMetric), without
+    // resetting the metrics
+    {
+      MetricsRegion outer("outer");
+      on_all_cores([]{ foo++; });
+      {
+        MetricsRegion inner("inner");
+        on_all_cores([]{ foo += 2; maz.add(maz.value() + 10 + mycore()); });
+      }
+    }
+    auto& regions = MetricsRegion::results();
+    BOOST_CHECK_EQUAL( regions.size(), 2 );
+    BOOST_CHECK_EQUAL( regions[0].name, "inner" );
+    BOOST_CHECK_EQUAL( regions[1].name, "outer" );
+    for (auto& r : regions) {
+      double dfoo = 0, dmaz = 0;
+      for (auto& d : r.deltas) {
+        if (d.first == "foo") dfoo = d.second;
+        if (d.first == "maz") dmaz = d.second;
+      }
+      BOOST_CHECK_EQUAL( dfoo, (r.name == "inner" ? 2 : 3) * Grappa::cores() );
+      BOOST_CHECK_EQUAL( dmaz, 10 + Grappa::cores() - 1 );
+    }
+    BOOST_CHECK( foo.value() >= 3 );
+    Metrics::print_regions();
+    
+    // time-series sampling: every core writes its own file
+    on_all_cores([]{
+      Metrics::start_series_here();
+      for (int i=0; i<1000; i++) { foo++; Grappa::yield(); }
+      Metrics::stop_series_here();
+    });
+    BOOST_CHECK( metrics_series_samples.value() >= 2 );
+    std::ifstream series("metrics.0.series", std::ios::binary);
+    BOOST_CHECK( series.is_open() );
+    char magic[8];
+    series.read(magic, sizeof(magic));
+    BOOST_CHECK_EQUAL( std::string(magic), "GRPSER1" );
   });
   Grappa::finalize();
 }
@@ -230,6 +230,59 @@ void check_call_suspending() {
   BOOST_CHECK_EQUAL(x, y);
 }
 
+void check_multicast() {
+  BOOST_MESSAGE("check_multicast");
+  call_on_all_cores([]{ global_x = 0; });
+  
+  // every core, with duplicates, which must run once each
+  std::vector<Core> targets;
+  for (Core c=0; c<cores(); c++) targets.push_back(c);
+  for (Core c=cores()-1; c>=0; c--) targets.push_back(c);
+  
+  int64_t n = delegate::multicast<&mygce>(targets, []{ global_x++; });
+  mygce.wait();
+  BOOST_CHECK_EQUAL(n, cores());
+  BOOST_CHECK_EQUAL((reduce<int,collective_add>(&global_x)), cores());
+  
+  // excluding the caller
+  finish([]{
+    std::vector<Core> others;
+    for (Core c=0; c<cores(); c++) if (c != mycore()) others.push_back(c);
+    BOOST_CHECK_EQUAL(delegate::multicast(others, []{ global_x += 2; }), cores()-1);
+  });
+  BOOST_CHECK_EQUAL(global_x, 1);
+  BOOST_CHECK_EQUAL((reduce<int,collective_add>(&global_x)), 3*cores()-2);
+}
+
+int64_t global_y;
+
+void check_multicast_concurrent() {
+  BOOST_MESSAGE("check_multicast_concurrent");
+  call_on_all_cores([]{ global_y = 0; });
+  
+  // many tasks per core multicasting from one call site at once, each to
+  // its own targets with its own value; sends yield, so they interleave
+  const int64_t N = 256;
+  on_all_cores([N]{
+    finish<&mygce>([N]{
+      for (int64_t i = 0; i < N; i++) {
+        spawn<&mygce>([i]{
+          std::vector<Core> targets;
+          for (Core c=0; c<cores(); c++) if (c != i % cores()) targets.push_back(c);
+          if (i % 2) std::reverse(targets.begin(), targets.end());
+          delegate::multicast<&mygce>(targets, [i]{ global_y += i+1; });
+        });
+      }
+    });
+  });
+  
+  on_all_cores([N]{
+    int64_t expected = 0;
+    for (int64_t i = 0; i < N; i++) if (i % cores() != mycore()) expected += i+1;
+    BOOST_CHECK_EQUAL(global_y, cores()*expected);
+  });
+}
+
 BOOST_AUTO_TEST_CASE( test1 ) {
   Grappa::init( GRAPPA_TEST_ARGS );
   Grappa::run([]{
@@ -247,6 +300,10 @@ BOOST_AUTO_TEST_CASE( test1 ) {
  
     check_call_suspending();
  
+    check_multicast();
+    
+    check_multicast_concurrent();
+ 
     int64_t seed = 111;
     GlobalAddress<int64_t> seed_addr = make_global(&seed);
 
@@ -29,6 +29,7 @@
 #include "RDMAAggregator.hpp"
 #include "Message.hpp"
 #include "Aggregator.hpp"
+#include "SharedMessagePool.hpp"
 
 
 namespace Grappa {
@@ -59,6 +60,15 @@ DEFINE_string( route_graph_filename, "", "Name of file for routing graph output
 
 DEFINE_bool( rdma_flush_on_idle, true, "Flush RDMA buffers when idle" );
 
+DEFINE_bool( rdma_mesh_routing, false, "Arrange locales in a virtual 2D grid and relay buffers for locales outside our row/column through an intermediate locale" );
+DEFINE_int64( rdma_mesh_width, 0, "Locales per row of the virtual grid used for mesh routing (0 = ceil(sqrt(locales)))" );
+
+DEFINE_bool( rdma_adaptive_flush, false, "Adjust flush timeout per destination locale online instead of using the fixed aggregator_autoflush_ticks" );
+DEFINE_int64( rdma_flush_latency_target_ticks, 0, "Goal for adaptive flush: keep time between sends to a locale under this many ticks (0 = maximize buffer fill instead)" );
+DEFINE_double( rdma_flush_target_fill, 0.5, "Goal for adaptive flush: fraction of an RDMA buffer to fill before sending" );
+DEFINE_int64( rdma_flush_min_ticks, 1000, "Smallest flush timeout the adaptive flush policy will choose" );
+DEFINE_int64( rdma_flush_max_ticks, 0, "Largest flush timeout the adaptive flush policy will choose (0 = 16 * aggregator_autoflush_ticks)" );
+
 /// stats for application messages
 GRAPPA_DEFINE_METRIC( SimpleMetric<int64_t>, app_messages_enqueue, 0 );
 GRAPPA_DEFINE_METRIC( SimpleMetric<int64_t>, app_messages_enqueue_cas, 0 );
@@ -107,7 +117,16 @@ GRAPPA_DEFINE_METRIC( SimpleMetric<int64_t>, rdma_poll_yields, 0 );
 GRAPPA_DEFINE_METRIC( SimpleMetric<int64_t>, rdma_flush_send, 0 );
 GRAPPA_DEFINE_METRIC( SimpleMetric<int64_t>, rdma_flush_receive, 0 );
 
-GRAPPA_DEFINE_METRIC( SummarizingMetric<double>, rdma_local_delivery_time, 0 );
+GRAPPA_DEFINE_METRIC( LatencyHistogramMetric, rdma_local_delivery_time, 0 );
+
+GRAPPA_DEFINE_METRIC( SimpleMetric<int64_t>, rdma_adaptive_timeout_flushes, 0 );
+GRAPPA_DEFINE_METRIC( SimpleMetric<int64_t>, rdma_adaptive_fill_flushes, 0 );
+GRAPPA_DEFINE_METRIC( SimpleMetric<int64_t>, rdma_adaptive_requested_flushes, 0 );
+GRAPPA_DEFINE_METRIC( SimpleMetric<int64_t>, rdma_adaptive_timeout_increases, 0 );
+GRAPPA_DEFINE_METRIC( SimpleMetric<int64_t>, rdma_adaptive_timeout_decreases, 0 );
+GRAPPA_DEFINE_METRIC( SummarizingMetric<int64_t>, rdma_adaptive_timeout_ticks, 0 );
+GRAPPA_DEFINE_METRIC( SummarizingMetric<double>, rdma_adaptive_target_bytes, 0 );
+GRAPPA_DEFINE_METRIC( SummarizingMetric<double>, rdma_adaptive_buffer_fill, 0 );
 
 GRAPPA_DEFINE_METRIC( SimpleMetric<int64_t>, workers_send_blocked, 0 );
 GRAPPA_DEFINE_METRIC( SimpleMetric<int64_t>, workers_idle_blocked, 0 );
@@ -118,6 +137,11 @@ GRAPPA_DEFINE_METRIC( SimpleMetric<int64_t>, workers_active_send, 0 );
 
 GRAPPA_DEFINE_METRIC( SimpleMetric<int64_t>, rdma_enqueue_buffer_am, 0 );
 
+GRAPPA_DEFINE_METRIC( SimpleMetric<int64_t>, rdma_mesh_peer_locales, 0 );
+GRAPPA_DEFINE_METRIC( SimpleMetric<int64_t>, rdma_forwarded_bundles, 0 );
+GRAPPA_DEFINE_METRIC( SummarizingMetric<int64_t>, rdma_forwarded_bundle_bytes, 0 );
+GRAPPA_DEFINE_METRIC( SimpleMetric<int64_t>, rdma_relayed_bundles, 0 );
+
 
 GRAPPA_DEFINE_METRIC(HistogramMetric, app_bytes_sent_histogram, 0);
 GRAPPA_DEFINE_METRIC(HistogramMetric, rdma_bytes_sent_histogram, 0);
@@ -247,6 +271,42 @@ namespace Grappa {
     }
   }
 
+  /// compute next hop for each locale. Without mesh routing, every
+  /// locale is a direct peer. With mesh routing, locales are laid out
+  /// row-major in a grid; locales in our row or column are peers, and
+  /// traffic for any other locale goes to the locale at the
+  /// intersection of our row and its column (or, if that spot in a
+  /// partial last row is empty, our column and its row), which
+  /// re-aggregates it with its own traffic for that column.
+  void RDMAAggregator::compute_mesh_routes() {
+    const Locale nlocales = Grappa::locales();
+    const Locale me = Grappa::mylocale();
+
+    route_next_hop_.resize( nlocales );
+    relayed_locales_.assign( nlocales, std::vector< Locale >() );
+
+    Locale width = FLAGS_rdma_mesh_width;
+    if( width <= 0 ) {
+      width = 1;
+      while( width * width < nlocales ) ++width;
+    }
+
+    for( Locale d = 0; d < nlocales; ++d ) {
+      Locale hop = d;
+      if( FLAGS_rdma_mesh_routing && d != me &&
+          (me / width) != (d / width) && (me % width) != (d % width) ) {
+        hop = (me / width) * width + (d % width);
+        if( hop >= nlocales ) {
+          hop = (d / width) * width + (me % width);
+        }
+        CHECK_LT( hop, nlocales );
+        relayed_locales_[ hop ].push_back( d );
+      }
+      route_next_hop_[ d ] = hop;
+      DVLOG(2) << "From locale " << me << " to locale " << d << " next hop " << hop;
+    }
+  }
+
     void RDMAAggregator::fill_free_pool( size_t num_buffers ) {
         void * p = Grappa::impl::locale_shared_memory.allocate_aligned( sizeof(RDMABuffer) * num_buffers, 8 );
         CHECK_NOTNULL( p );
@@ -359,6 +419,21 @@ namespace Grappa {
       // what locales is my core responsible for?
       //
 
+      // find next hop for each locale
+      compute_mesh_routes();
+
+      // start adaptive flush policy from the static settings
+      {
+        FlushController fc;
+        fc.timeout_ = FLAGS_aggregator_autoflush_ticks;
+        fc.rate_ = 0.0;
+        fc.target_bytes_ = FLAGS_rdma_flush_target_fill * BUFFER_SIZE;
+        fc.last_data_sent_ = Grappa::timestamp();
+        fc.fill_triggered_ = false;
+        fc.requested_ = false;
+        flush_controllers_.assign( Grappa::locales(), fc );
+      }
+
       // draw route map if enabled
       draw_routing_graph();
 
@@ -369,14 +444,16 @@ namespace Grappa {
 
       // generate list of locales this core is responsible for
       core_partner_locales_ = new Locale[ locales_per_core ];
+      // (locales we relay through another locale get no sender of their own)
       for( int i = 0; i < Grappa::locales(); ++i ) {
-        if( source_core_for_locale_[i] == Grappa::mycore() ) {
+        if( source_core_for_locale_[i] == Grappa::mycore() && route_next_hop_[i] == i ) {
           CHECK_LT( core_partner_locale_count_, locales_per_core ) << "this core is responsible for more locales than expected";
           core_partner_locales_[ core_partner_locale_count_++ ] = i;
           DVLOG(2) << "Core " << Grappa::mycore() << " responsible for locale " << i;
         }
       }
       DVLOG(2) << "Partner locale count is " << core_partner_locale_count_ << ", locales per core is " << locales_per_core;
+      rdma_mesh_peer_locales += core_partner_locale_count_;
 
       // fill pool of buffers
       if( core_partner_locale_count_ > 0 ) {
@@ -531,10 +608,19 @@ void RDMAAggregator::draw_routing_graph() {
         //for( int c = n * Grappa::locale_cores(); c < (n+1) * Grappa::locale_cores(); ++c ) {
         for( int d = 0; d < Grappa::locales(); ++d ) {
           if( d != Grappa::mylocale() ) {
-            o << "    n" << n << ":c" << source_core_for_locale_[d] << ":e"
-              << " -> n" << d << ":c" << dest_core_for_locale_[d] << ":w"
-              << " [headlabel=\"c" << source_core_for_locale_[d] << "\"]"
-              << ";\n";
+            Locale hop = route_next_hop_[d];
+            if( hop == d ) {
+              o << "    n" << n << ":c" << source_core_for_locale_[d] << ":e"
+                << " -> n" << d << ":c" << dest_core_for_locale_[d] << ":w"
+                << " [headlabel=\"c" << source_core_for_locale_[d] << "\"]"
+                << ";\n";
+            } else {
+              // relayed: show which peer carries traffic for this locale
+              o << "    n" << n << ":c" << source_core_for_locale_[hop] << ":e"
+                << " -> n" << d
+                << " [style=dashed, label=\"via n" << hop << "\"]"
+                << ";\n";
+            }
           }
         }
 
@@ -687,19 +773,118 @@ void RDMAAggregator::draw_routing_graph() {
       if( disable_everything_ ) LOG(WARNING) << "Sending while disabled...";
 
       // send to locale
-      send_locale( locale );
+      int64_t bytes = send_locale( locale );
 
       // record when we last sent
       // TODO: should this go earlier? probably not.
       // TODO: should we tick here?
       Grappa::tick();
-      locale_core->last_sent_ = Grappa::timestamp();
+      Grappa::Timestamp now = Grappa::timestamp();
+      if( FLAGS_rdma_adaptive_flush ) {
+        update_flush_policy( locale, bytes, now );
+      }
+      locale_core->last_sent_ = now;
 
       // send done! loop!
       active_send_workers_--;
     }
   }
 
+  /// Adaptive flush policy. We track the rate at which bytes are sent
+  /// to each locale, and after each send that carried data adjust its
+  /// timeout:
+  ///  - with a latency goal, halve the timeout whenever the time since
+  ///    the previous send exceeds the goal, and otherwise let it creep
+  ///    back up toward the goal while buffers are underfilled;
+  ///  - with a throughput goal, grow the timeout while buffers go out
+  ///    less full than the target fill, and shrink it once they are
+  ///    full enough, so sends happen at about the target fill.
+  /// check_for_work_on() additionally flushes early once the rate
+  /// predicts target_bytes_ are waiting. When such an early flush
+  /// comes out emptier or fuller than the target fill, target_bytes_
+  /// is corrected by a fraction of the error; with a latency goal it
+  /// is also capped at what the observed rate delivers within the
+  /// goal. Empty idle/timeout sends are ignored. Sends forced by an
+  /// explicit flush() only update the rate: their fill and age say
+  /// more about the caller than about the traffic.
+  void RDMAAggregator::update_flush_policy( Locale locale, int64_t bytes, Grappa::Timestamp now ) {
+    FlushController & fc = flush_controllers_[ locale ];
+    bool fill_triggered = fc.fill_triggered_;
+    bool requested = fc.requested_;
+    fc.fill_triggered_ = false;
+    fc.requested_ = false;
+
+    // nothing was sent, so this tells us nothing about the traffic
+    if( bytes == 0 ) return;
+
+    if( requested ) {
+      rdma_adaptive_requested_flushes++;
+    } else if( fill_triggered ) {
+      rdma_adaptive_fill_flushes++;
+    } else {
+      rdma_adaptive_timeout_flushes++;
+    }
+
+    Grappa::Timestamp elapsed = now - fc.last_data_sent_;
+    if( elapsed < 1 ) elapsed = 1;
+    fc.last_data_sent_ = now;
+
+    // exponential moving average of send rate
+    const double alpha = 0.125;
+    fc.rate_ = alpha * ( (double) bytes / elapsed ) + ( 1.0 - alpha ) * fc.rate_;
+
+    if( requested ) return;
+
+    const Grappa::Timestamp min_ticks = FLAGS_rdma_flush_min_ticks;
+    const Grappa::Timestamp max_ticks = ( FLAGS_rdma_flush_max_ticks > 0
+                                          ? FLAGS_rdma_flush_max_ticks
+                                          : 16 * FLAGS_aggregator_autoflush_ticks );
+
+    const double fill = (double) bytes / BUFFER_SIZE;
+    const double goal_bytes = FLAGS_rdma_flush_target_fill * BUFFER_SIZE;
+
+    // correct the early-flush threshold for the error in its prediction
+    double target_bytes = fc.target_bytes_;
+    if( fill_triggered ) {
+      target_bytes += 0.25 * ( goal_bytes - bytes );
+    }
+    double max_target_bytes = BUFFER_SIZE;
+
+    Grappa::Timestamp timeout = fc.timeout_;
+    if( FLAGS_rdma_flush_latency_target_ticks > 0 ) {
+      const Grappa::Timestamp goal = std::min< Grappa::Timestamp >( FLAGS_rdma_flush_latency_target_ticks, max_ticks );
+      if( elapsed > goal ) {
+        timeout = timeout / 2;
+      } else if( fill < FLAGS_rdma_flush_target_fill ) {
+        timeout = std::min( goal, timeout + timeout / 8 + 1 );
+      }
+      // don't wait for more bytes than arrive within the goal
+      max_target_bytes = std::min( max_target_bytes, fc.rate_ * goal );
+    } else {
+      if( fill < FLAGS_rdma_flush_target_fill ) {
+        timeout = timeout + timeout / 4 + 1;
+      } else {
+        timeout = timeout - timeout / 8;
+      }
+    }
+    timeout = std::max( min_ticks, std::min( max_ticks, timeout ) );
+
+    const double min_target_bytes = std::min( 0.25 * goal_bytes, max_target_bytes );
+    fc.target_bytes_ = std::max( min_target_bytes, std::min( max_target_bytes, target_bytes ) );
+
+    if( timeout > fc.timeout_ ) rdma_adaptive_timeout_increases++;
+    if( timeout < fc.timeout_ ) rdma_adaptive_timeout_decreases++;
+    fc.timeout_ = timeout;
+
+    rdma_adaptive_timeout_ticks += timeout;
+    rdma_adaptive_target_bytes += fc.target_bytes_;
+    rdma_adaptive_buffer_fill += fill;
+
+    DVLOG(4) << "Adaptive flush for locale " << locale << ": sent " << bytes << " bytes after " << elapsed
+             << " ticks, rate " << fc.rate_ << " timeout now " << fc.timeout_
+             << " target bytes now " << fc.target_bytes_;
+  }
+
   // block until there's something to receive and do so
   void RDMAAggregator::receive_worker() {
     RDMABuffer * buf = NULL;
@@ -1003,37 +1188,53 @@ void RDMAAggregator::draw_routing_graph() {
 
 
 
+  /// Walks the message lists to be sent in a buffer for a locale. With
+  /// mesh routing, a buffer also carries traffic for the locales we
+  /// relay through that locale; since the receiver splits a buffer into
+  /// one contiguous slice per local core index, we visit lists
+  /// slot-major: for each core index, the core with that index on the
+  /// locale itself and then on each relayed locale.
   class MessageListChooser {
   private:
-    // indices of source core message lists
-    Core dest_cores_start_;
-    Core dest_cores_end_;
-    
+    // locale we are sending to, and locales relayed through it
+    Locale locale_;
+    const std::vector< Locale > & relayed_;
+
     // cores in this locale to pull from
     Core source_cores_start_;
     Core source_cores_end_;
     
     // where are we right now?
+    Core current_slot_;
+    size_t current_locale_index_; // 0 is locale_; i > 0 is relayed_[i-1]
     Core current_dest_core_;
     Core current_source_core_;
     
     bool done;
     
+    void update_dest_core() {
+      Locale l = ( current_locale_index_ == 0 ) ? locale_ : relayed_[ current_locale_index_ - 1 ];
+      current_dest_core_ = l * Grappa::locale_cores() + current_slot_;
+    }
+
   public:
     MessageListChooser() = delete;
     MessageListChooser( const MessageListChooser& ) = delete;
     MessageListChooser( MessageListChooser&& ) = delete;
 
-    MessageListChooser( Core dest_start, Core dest_end, Core source_start, Core source_end ) 
-      : dest_cores_start_( dest_start )
-      , dest_cores_end_( dest_end )
+    MessageListChooser( Locale locale, const std::vector< Locale > & relayed, Core source_start, Core source_end ) 
+      : locale_( locale )
+      , relayed_( relayed )
       , source_cores_start_( source_start )
       , source_cores_end_( source_end )
-      , current_dest_core_( dest_cores_start_ )
+      , current_slot_( 0 )
+      , current_locale_index_( 0 )
+      , current_dest_core_( -1 )
       , current_source_core_( source_cores_start_ )
       , done( false )
     { 
-      DVLOG(4) << __func__ << "Initialized with dest range " << dest_cores_start_ << "/" << dest_cores_end_
+      update_dest_core();
+      DVLOG(4) << __func__ << "Initialized with locale " << locale_ << " relaying for " << relayed_.size()
                << " source range " << source_cores_start_ << "/" << source_cores_end_;
     }
 
@@ -1056,12 +1257,17 @@ void RDMAAggregator::draw_routing_graph() {
           if( current_source_core_ >= source_cores_end_ ) {
             // reset source
             current_source_core_ = source_cores_start_;
-            // and increment dest
-            current_dest_core_++;
-            // if we've also checked all the destinations
-            if( current_dest_core_ >= dest_cores_end_ ) {
-              done = true; // we're done.
+            // and move to the same slot on the next relayed locale
+            current_locale_index_++;
+            if( current_locale_index_ > relayed_.size() ) {
+              current_locale_index_ = 0;
+              current_slot_++;
+              // if we've also checked all the destinations
+              if( current_slot_ >= Grappa::locale_cores() ) {
+                done = true; // we're done.
+              }
             }
+            if( !done ) update_dest_core();
           }
 
           // if we still have something to fetch, prefetch for next
@@ -1083,7 +1289,89 @@ void RDMAAggregator::draw_routing_graph() {
   };
 
 
-  void RDMAAggregator::send_locale( Locale locale ) {
+  /// A bundle of serialized messages relayed through this core on
+  /// their way to a core on a locale the sender had no direct route
+  /// to. The bundle's bytes are stored right after the message object.
+  class RelayedBundle : public Grappa::impl::MessageBase {
+  private:
+    uint32_t bundle_size_;
+
+    char * bundle() { return reinterpret_cast< char * >( this + 1 ); }
+
+  public:
+    RelayedBundle( Core dest, const char * buf, uint32_t size )
+      : MessageBase( dest )
+      , bundle_size_( size )
+    {
+      std::memcpy( bundle(), buf, size );
+    }
+
+    /// bytes to request from the shared message pool for a bundle of this size
+    static size_t alloc_size( uint32_t size ) {
+      size_t sz = sizeof( RelayedBundle ) + size;
+      return ( (sz + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE ) * CACHE_LINE_SIZE;
+    }
+
+    virtual const char * typestr() { return "RelayedBundle"; }
+
+    virtual const size_t serialized_size() const {
+      return sizeof( MessageFPAddr ) + sizeof( uint32_t ) + bundle_size_;
+    }
+
+    virtual const size_t size() const { return alloc_size( bundle_size_ ); }
+
+    virtual void deliver_locally() {
+      if( !is_delivered_ ) {
+        RDMAAggregator::deaggregate_buffer( bundle(), bundle_size_ );
+        is_delivered_ = true;
+      }
+      this->mark_sent();
+    }
+
+    virtual char * serialize_to( char * p, size_t max_size ) {
+      Grappa::impl::MessageBase::serialize_to( p, max_size );
+      if( serialized_size() > max_size ) {
+        return p;
+      } else {
+        MessageFPAddr gfp = { destination_, reinterpret_cast< intptr_t >( &RDMAAggregator::deliver_bundle ) };
+        *(reinterpret_cast< MessageFPAddr* >(p)) = gfp;
+        p += sizeof( gfp );
+
+        *(reinterpret_cast< uint32_t* >(p)) = bundle_size_;
+        p += sizeof( uint32_t );
+
+        std::memcpy( p, bundle(), bundle_size_ );
+        return p + bundle_size_;
+      }
+    }
+  };
+
+  /// Called on the intermediate core: re-enqueue the bundle for its
+  /// final core, so it is aggregated with our own traffic for that locale.
+  char * RDMAAggregator::relay_bundle( char * buf ) {
+    uint32_t size = *(reinterpret_cast< uint32_t* >( buf ));
+    buf += sizeof( uint32_t );
+    Core dest = *(reinterpret_cast< Core* >( buf ));
+    buf += sizeof( Core );
+
+    auto m = new (SharedMessagePool::alloc( RelayedBundle::alloc_size( size ) )) RelayedBundle( dest, buf, size );
+    m->delete_after_send();
+    m->enqueue();
+    rdma_relayed_bundles++;
+
+    return buf + size;
+  }
+
+  /// Called on the final core: run the messages in the bundle.
+  char * RDMAAggregator::deliver_bundle( char * buf ) {
+    uint32_t size = *(reinterpret_cast< uint32_t* >( buf ));
+    buf += sizeof( uint32_t );
+    deaggregate_buffer( buf, size );
+    return buf + size;
+  }
+
+
+  int64_t RDMAAggregator::send_locale( Locale locale ) {
     rdma_send_start++;
     active_send_workers_++;
     ++workers_active_send;
@@ -1101,7 +1389,7 @@ void RDMAAggregator::draw_routing_graph() {
     Core max_core = first_core + Grappa::locale_cores();
     Core current_dest_core = -1;
 
-    MessageListChooser mlc( first_core, max_core, 0, Grappa::locale_cores() );
+    MessageListChooser mlc( locale, relayed_locales_[ locale ], 0, Grappa::locale_cores() );
     DVLOG(3) << __PRETTY_FUNCTION__ << "/" << Grappa::impl::global_scheduler.get_current_thread() 
              << " MessageListChooser constructed at " << &mlc;
 
@@ -1190,8 +1478,36 @@ void RDMAAggregator::draw_routing_graph() {
           Grappa::impl::MessageBase * prev_messages_to_send = messages_to_send;
           CHECK_EQ( messages_to_send->destination_, current_dest_core ) << "hmm. this doesn't seem right";
           static_assert(sizeof(size_t) == sizeof(uint64_t), "must be 64-bit");
-          char * end = aggregate_to_buffer( current_buf, &messages_to_send, remaining_size, &aggregate_counts_[current_dest_core] );
-          size_t current_aggregated_size = end - current_buf;
+          // messages for a relayed locale are framed as a bundle for
+          // the core with the same index on the intermediate locale
+          bool relayed = Grappa::locale_of( current_dest_core ) != locale;
+          size_t header_size = relayed ? relay_header_size : 0;
+          if( remaining_size <= header_size ) {
+            ready_to_send = true;
+            break;
+          }
+
+          char * start = current_buf + header_size;
+          char * end = aggregate_to_buffer( start, &messages_to_send, remaining_size - header_size, &aggregate_counts_[current_dest_core] );
+          size_t current_aggregated_size = 0;
+          if( end != start ) {
+            if( relayed ) {
+              char * h = current_buf;
+              MessageFPAddr gfp = { static_cast< Core >( locale * Grappa::locale_cores() + current_dest_core % Grappa::locale_cores() ),
+                                    reinterpret_cast< intptr_t >( &relay_bundle ) };
+              *(reinterpret_cast< MessageFPAddr* >( h )) = gfp;
+              h += sizeof( gfp );
+              *(reinterpret_cast< uint32_t* >( h )) = end - start;
+              h += sizeof( uint32_t );
+              *(reinterpret_cast< Core* >( h )) = current_dest_core;
+
+              rdma_forwarded_bundles++;
+              rdma_forwarded_bundle_bytes += end - start;
+            }
+            current_aggregated_size = end - current_buf;
+          } else {
+            end = current_buf;
+          }
           CHECK_LE( aggregated_size + current_aggregated_size, max_size );
           CHECK_GE( remaining_size, 0 );
 
@@ -1201,7 +1517,7 @@ void RDMAAggregator::draw_routing_graph() {
                    << " end-start=" << end - current_buf;
 
           // record how much this core has
-          int index = current_dest_core - first_core;
+          int index = current_dest_core % Grappa::locale_cores();
           DVLOG(4) << __func__ << "/" << sequence_number 
                    << ": Recording " << current_aggregated_size << " bytes"
                    << " for core " << current_dest_core
@@ -1300,6 +1616,8 @@ void RDMAAggregator::draw_routing_graph() {
     active_send_workers_--;
     rdma_send_end++;
     --workers_active_send;
+
+    return bytes_sent;
   }
 
 
@@ -52,12 +52,16 @@
 #include "NTMessage.hpp"
 #include "NTBuffer.hpp"
 
+#include <vector>
+
 // #include <boost/interprocess/containers/vector.hpp>
 
 DECLARE_int64( target_size );
 DECLARE_int64( aggregator_target_size );
 DECLARE_int64( aggregator_autoflush_ticks );
 DECLARE_bool( enable_aggregation );
+DECLARE_bool( rdma_mesh_routing );
+DECLARE_bool( rdma_adaptive_flush );
 
 /// stats for application messages
 GRAPPA_DECLARE_METRIC( SimpleMetric<int64_t>, app_messages_enqueue );
@@ -77,7 +81,12 @@ GRAPPA_DECLARE_METRIC( SimpleMetric<int64_t>, rdma_poll_send_success );
 GRAPPA_DECLARE_METRIC( SimpleMetric<int64_t>, rdma_poll_receive_success );
 GRAPPA_DECLARE_METRIC( SimpleMetric<int64_t>, rdma_poll_yields );
 
-GRAPPA_DECLARE_METRIC( SummarizingMetric<double>, rdma_local_delivery_time );
+GRAPPA_DECLARE_METRIC( LatencyHistogramMetric, rdma_local_delivery_time );
+
+/// stats for adaptive flush policy
+GRAPPA_DECLARE_METRIC( SimpleMetric<int64_t>, rdma_adaptive_timeout_flushes );
+GRAPPA_DECLARE_METRIC( SimpleMetric<int64_t>, rdma_adaptive_fill_flushes );
+GRAPPA_DECLARE_METRIC( SimpleMetric<int64_t>, rdma_adaptive_requested_flushes );
 
 
 namespace Grappa {
@@ -231,10 +240,43 @@ namespace Grappa {
       Core * core_partner_locales_;
       int core_partner_locale_count_;
 
+      /// Next locale on the route to each locale. This is the locale
+      /// itself unless mesh routing is enabled and the locale is not
+      /// in our row or column of the virtual grid.
+      std::vector< Locale > route_next_hop_;
+
+      /// For each locale, the locales whose traffic we relay through it.
+      std::vector< std::vector< Locale > > relayed_locales_;
+
+      /// State of the adaptive flush policy for one destination locale.
+      struct FlushController {
+        /// flush if nothing has been sent for this many ticks
+        Grappa::Timestamp timeout_;
+        /// moving average of bytes sent per tick
+        double rate_;
+        /// flush early once we expect this many bytes to be waiting
+        double target_bytes_;
+        /// when we last sent a buffer that carried data
+        Grappa::Timestamp last_data_sent_;
+        /// was the pending flush requested because of predicted fill?
+        bool fill_triggered_;
+        /// was the pending flush requested explicitly with flush()?
+        bool requested_;
+      };
+
+      /// Adaptive flush state, indexed by destination locale (only
+      /// used with --rdma_adaptive_flush)
+      std::vector< FlushController > flush_controllers_;
+
+      /// Adjust flush timeout and early-flush threshold for a locale
+      /// after a send of some bytes finished at time now.
+      void update_flush_policy( Locale locale, int64_t bytes, Grappa::Timestamp now );
+
       NTBuffer * ntbuffers_;
       NTBuffer * ntbuffer_mru_root_;
 
       void compute_route_map();
+      void compute_mesh_routes();
       void draw_routing_graph();
       void fill_free_pool( size_t num_buffers );
 
@@ -260,6 +302,16 @@ namespace Grappa {
       /// Active message to enqueue a buffer to be received
       static void enqueue_buffer_am( void * buf, int size, CommunicatorContext * c );
 
+      /// Deserializer for a bundle of messages relayed through this
+      /// locale; re-enqueues the bundle toward its final core.
+      static char * relay_bundle( char * buf );
+
+      /// Deserializer for a relayed bundle at its final core.
+      static char * deliver_bundle( char * buf );
+
+      /// Bytes of framing in front of a bundle on its first hop
+      static const size_t relay_header_size = sizeof(MessageFPAddr) + sizeof(uint32_t) + sizeof(Core);
+
       /// buffers for message transmission
       RDMABuffer * rdma_buffers_;
 
@@ -357,7 +409,7 @@ namespace Grappa {
       void issue_initial_prefetches( Core core, Core locale_source );
       void issue_initial_prefetches( CoreData * cd );
       void send_locale_medium( Locale locale );
-      void send_locale( Locale locale );
+      int64_t send_locale( Locale locale );
 
       void send_with_buffers( Core core,
                               MessageBase ** messages_to_send_ptr,
@@ -395,7 +447,26 @@ namespace Grappa {
 
         // have we timed out?
         Grappa::Timestamp current_ts = Grappa::timestamp();
-        if( current_ts - localeCoreData(c)->last_sent_ > FLAGS_aggregator_autoflush_ticks ) {
+        Grappa::Timestamp elapsed = current_ts - localeCoreData(c)->last_sent_;
+        if( !FLAGS_rdma_adaptive_flush ) {
+          return elapsed > FLAGS_aggregator_autoflush_ticks;
+        }
+
+        // flushes are counted in update_flush_policy() once we know
+        // they actually carried data
+        FlushController & fc = flush_controllers_[ locale ];
+        if( localeCoreData(c)->last_sent_ == 0 ) {
+          // flush() from another core; see below
+          fc.requested_ = true;
+          return true;
+        }
+        if( elapsed > fc.timeout_ ) {
+          return true;
+        }
+
+        // at the observed rate, has a buffer's worth probably built up?
+        if( fc.rate_ * elapsed >= fc.target_bytes_ && check_for_any_work_on( locale ) ) {
+          fc.fill_triggered_ = true;
           return true;
         }
 
@@ -406,6 +477,17 @@ namespace Grappa {
       }
 
       bool check_for_any_work_on( Locale locale ) {
+        if( check_for_any_work_on_cores_of( locale ) ) return true;
+        // also check locales we relay through this one
+        if( !relayed_locales_.empty() ) {
+          for( auto l : relayed_locales_[ locale ] ) {
+            if( check_for_any_work_on_cores_of( l ) ) return true;
+          }
+        }
+        return false;
+      }
+
+      bool check_for_any_work_on_cores_of( Locale locale ) {
         Core start = locale * Grappa::locale_cores();
         Core max = start + Grappa::locale_cores();
         // for all the cores for this locale,
@@ -498,6 +580,15 @@ namespace Grappa {
 
       void dump_counts();
 
+      /// next locale on the route to a locale (for tests)
+      Locale next_hop( Locale locale ) const { return route_next_hop_[ locale ]; }
+
+      /// current adaptive flush timeout for a locale (for tests)
+      Grappa::Timestamp flush_timeout( Locale locale ) const { return flush_controllers_[ locale ].timeout_; }
+
+      /// current adaptive early-flush threshold for a locale (for tests)
+      double flush_target_bytes( Locale locale ) const { return flush_controllers_[ locale ].target_bytes_; }
+
       bool receive_poll() {
         rdma_poll_receive++;
         //DVLOG(4) << "RDMA receive poll";
@@ -512,13 +603,12 @@ namespace Grappa {
           DVLOG(4) << "Polling found messages.raw " << (void*) localeCoreData(c)->messages_.raw_  
                    << " count " << localeCoreData(c)->messages_.count_ ;
             
-          //Grappa::Timestamp start = Grappa::force_tick();
+          Grappa::Timestamp start = Grappa::force_tick();
             
           Grappa::impl::MessageList ml = grab_locale_messages( c );
           size_t count = deliver_locally( c, ml, localeCoreData( c ) );
 
-          //Grappa::Timestamp elapsed = Grappa::force_tick() - start;
-          //rdma_local_delivery_time += (double) elapsed / tick_rate;
+          rdma_local_delivery_time += Grappa::force_tick() - start;
         }
 
         for( Core locale_source = 0; locale_source < Grappa::locale_cores(); ++locale_source ) {
@@ -528,13 +618,12 @@ namespace Grappa {
             DVLOG(4) << "Polling found messages.raw " << (void*) coreData(c,locale_source)->messages_.raw_  
                      << " count " << coreData(c,locale_source)->messages_.count_ ;
             
-            //Grappa::Timestamp start = Grappa::force_tick();
+            Grappa::Timestamp start = Grappa::force_tick();
             
             Grappa::impl::MessageList ml = grab_messages( c, locale_source );
             size_t count = deliver_locally( c, ml, coreData( c, locale_source ) );
 
-            //Grappa::Timestamp elapsed = Grappa::force_tick() - start;
-            //rdma_local_delivery_time += (double) elapsed / tick_rate;
+            rdma_local_delivery_time += Grappa::force_tick() - start;
           }
         }
         if( useful ) rdma_poll_receive_success++;
@@ -788,8 +877,10 @@ namespace Grappa {
       /// Flush one destination.
       void flush( Core c ) {
         rdma_requested_flushes++;
-        Locale locale = Grappa::locale_of(c);
+        Locale locale = route_next_hop_[ Grappa::locale_of(c) ];
         if( source_core_for_locale_[ locale ] == Grappa::mycore() ) {
+          // keep explicit flushes out of the adaptive policy's statistics
+          if( FLAGS_rdma_adaptive_flush ) flush_controllers_[ locale ].requested_ = true;
           Grappa::signal( &(localeCoreData( locale * Grappa::locale_cores() )->send_cv_) );
         } else {
           // not on our core, so we can't signal it. instead, cause
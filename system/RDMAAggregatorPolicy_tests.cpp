@@ -0,0 +1,100 @@
+////////////////////////////////////////////////////////////////////////
+// This file is part of Grappa, a system for scaling irregular
+// applications on commodity clusters. 
+
+// Copyright (C) 2010-2014 University of Washington and Battelle
+// Memorial Institute. University of Washington authorizes use of this
+// Grappa software.
+
+// Grappa is free software: you can redistribute it and/or modify it
+// under the terms of the Affero General Public License as published
+// by Affero, Inc., either version 1 of the License, or (at your
+// option) any later version.
+
+// Grappa is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// Affero General Public License for more details.
+
+// You should have received a copy of the Affero General Public
+// License along with this program. If not, you may obtain one from
+// http://www.affero.org/oagpl.html.
+////////////////////////////////////////////////////////////////////////
+
+
+#include <boost/test/unit_test.hpp>
+#include "Grappa.hpp"
+#include "Delegate.hpp"
+#include "CompletionEvent.hpp"
+#include "RDMAAggregator.hpp"
+#include "RDMABuffer.hpp"
+
+DECLARE_int64( rdma_mesh_width );
+DECLARE_int64( rdma_flush_latency_target_ticks );
+DECLARE_double( rdma_flush_target_fill );
+
+BOOST_AUTO_TEST_SUITE( RDMAAggregatorPolicy_tests );
+
+using namespace Grappa;
+
+int64_t received_sum = 0;
+
+/// With 3 locales in a grid 2 wide, locale 1 reaches locale 2 (and
+/// back) only through locale 0.
+void check_mesh_route() {
+  BOOST_MESSAGE( "multi-hop mesh route..." );
+  const int64_t N = 1 << 12;
+
+  delegate::call( 1, [N]{
+    BOOST_CHECK_EQUAL( impl::global_rdma_aggregator.next_hop( 2 ), 0 );
+
+    // enough blocked delegates in flight to keep the relay busy
+    CompletionEvent ce;
+    for( int64_t i = 0; i < N; ++i ) {
+      spawn( &ce, [i]{
+        auto l = delegate::call( 2, [i]{
+          received_sum += i;
+          return mylocale();
+        });
+        BOOST_CHECK_EQUAL( l, 2 );
+      });
+    }
+    ce.wait();
+  });
+
+  BOOST_CHECK_EQUAL( delegate::call( 2, []{ return received_sum; } ), N * (N-1) / 2 );
+}
+
+/// The sends above went out on timeouts and idle flushes, never on an
+/// explicit flush(), so core 1's controller for its next hop must have
+/// moved off its starting settings.
+void check_adaptive_flush() {
+  BOOST_MESSAGE( "adaptive flush policy..." );
+  delegate::call( 1, []{
+    auto& a = impl::global_rdma_aggregator;
+    BOOST_CHECK_NE( a.flush_timeout( 0 ), FLAGS_aggregator_autoflush_ticks );
+    BOOST_CHECK_LE( a.flush_timeout( 0 ), FLAGS_rdma_flush_latency_target_ticks );
+    BOOST_CHECK_LT( a.flush_target_bytes( 0 ), FLAGS_rdma_flush_target_fill * BUFFER_SIZE );
+  });
+}
+
+BOOST_AUTO_TEST_CASE( test1 ) {
+  // these are read when the aggregator is initialized
+  FLAGS_rdma_mesh_routing = true;
+  FLAGS_rdma_mesh_width = 2;
+  FLAGS_rdma_adaptive_flush = true;
+  // a latency goal well under the starting timeout, so the policy must
+  // shrink both the timeout and the early-flush threshold
+  FLAGS_rdma_flush_latency_target_ticks = FLAGS_aggregator_autoflush_ticks / 5;
+
+  Grappa::init( GRAPPA_TEST_ARGS );
+  Grappa::run([]{
+    CHECK_EQ( locales(), 3 ) << "need 3 locales for a multi-hop route";
+
+    check_mesh_route();
+    check_adaptive_flush();
+  });
+  Grappa::finalize();
+}
+
+BOOST_AUTO_TEST_SUITE_END();
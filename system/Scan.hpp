@@ -0,0 +1,297 @@
+////////////////////////////////////////////////////////////////////////
+// This file is part of Grappa, a system for scaling irregular
+// applications on commodity clusters. 
+
+// Copyright (C) 2010-2014 University of Washington and Battelle
+// Memorial Institute. University of Washington authorizes use of this
+// Grappa software.
+
+// Grappa is free software: you can redistribute it and/or modify it
+// under the terms of the Affero General Public License as published
+// by Affero, Inc., either version 1 of the License, or (at your
+// option) any later version.
+
+// Grappa is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// Affero General Public License for more details.
+
+// You should have received a copy of the Affero General Public
+// License along with this program. If not, you may obtain one from
+// http://www.affero.org/oagpl.html.
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Collective.hpp"
+#include "Addressing.hpp"
+#include "LocaleSharedMemory.hpp"
+
+#include <vector>
+
+namespace Grappa {
+  
+  /// @addtogroup Collectives
+  /// @{
+  
+  /// Element of a segmented scan: the scan restarts at every element whose
+  /// `start` flag is set.
+  template< typename T >
+  struct Segmented {
+    T value;
+    bool start;
+  };
+  
+  /// Associative lifting of ReduceOp to Segmented values (for scan()/exscan()).
+  template< typename T, T (*ReduceOp)(const T&, const T&) >
+  Segmented<T> segmented_op(const Segmented<T>& a, const Segmented<T>& b) {
+    return Segmented<T>{ b.start ? b.value : ReduceOp(a.value, b.value), a.start || b.start };
+  }
+  
+  namespace impl {
+    
+    /// Elementwise exclusive scan of per-core arrays over cores, ordered by
+    /// rank relative to a root core. Work-efficient up-sweep/down-sweep on a
+    /// binomial tree: each core exchanges O(log cores) messages, and the
+    /// whole scan combines O(cores) arrays, instead of O(cores * log cores)
+    /// for recursive doubling. Operand order follows rank, so ReduceOp only
+    /// has to be associative.
+    template< typename T, T (*ReduceOp)(const T&, const T&) >
+    class InplaceScan {
+    protected:
+      enum Kind { DOWN = -1 }; // UP from child r is kind r
+      
+      size_t n;
+      T * acc;          // my subtree's combined values
+      T * pre;          // prefix from my parent
+      T * child[32];    // each child's subtree
+      CompletionEvent down_ce;
+      CompletionEvent up_ce[32];
+      
+      void receive(int kind, size_t k, const T * in, size_t len) {
+        if (kind == DOWN) {
+          std::copy(in, in+len, pre+k);
+          down_ce.complete();
+        } else {
+          std::copy(in, in+len, child[kind]+k);
+          up_ce[kind].complete();
+        }
+      }
+      
+      void send(MessagePool& pool, Core dest, int kind, T * src) {
+        size_t per = elems_per_msg<T>();
+        for (size_t k=0; k<n; k+=per) {
+          pool.send_message(dest, [this,kind,k](void * payload, size_t payload_size) {
+            this->receive(kind, k, static_cast<T*>(payload), payload_size/sizeof(T));
+          }, (void*)(src+k), sizeof(T)*std::min(per, n-k));
+        }
+      }
+      
+    public:
+      /// SPMD, must be called on static/file-global object on all cores.
+      /// Replaces `array` with the combination of the arrays of all lower
+      /// ranks, and returns false (leaving `array` alone) on the root.
+      /// If `totals` is given, the root also gets the combination over all
+      /// cores there.
+      bool call_exscan(T * array, size_t nelem, Core root, T * totals = nullptr) {
+        n = nelem;
+        const Core P = cores(), rank = (mycore() - root + P) % P;
+        auto core_of = [root,P](Core rank) -> Core { return (rank + root) % P; };
+        const size_t nmsg = nchunks(n, elems_per_msg<T>());
+        
+        // children are rank + 2^r for r below my lowest set bit
+        int nchildren = 0;
+        while ((rank == 0 || !(rank & (1 << nchildren))) && rank + (1 << nchildren) < P) nchildren++;
+        
+        acc = locale_alloc<T>(std::max<size_t>(1, n));
+        pre = locale_alloc<T>(std::max<size_t>(1, n));
+        for (int r=0; r<nchildren; r++) {
+          child[r] = locale_alloc<T>(std::max<size_t>(1, n));
+          up_ce[r].enroll(nmsg);
+        }
+        if (rank > 0) down_ce.enroll(nmsg);
+        std::copy(array, array+n, acc);
+        
+        MessagePool pool(std::max<size_t>(1, (nchildren+1) * nmsg) *
+                         sizeof(PayloadMessage<std::function<void(void*,size_t)>>));
+        barrier();
+        
+        // up-sweep: combine children's subtrees (which follow mine) into acc
+        for (int r=0; r<nchildren; r++) {
+          up_ce[r].wait();
+          for (size_t i=0; i<n; i++) acc[i] = ReduceOp(acc[i], child[r][i]);
+        }
+        if (rank > 0) {
+          Core parent = core_of(rank - (rank & -rank));
+          send(pool, parent, __builtin_ctz(rank), acc);
+        } else if (totals) {
+          std::copy(acc, acc+n, totals);
+        }
+        
+        // down-sweep: child r's prefix is mine, then me, then children below r
+        if (rank > 0) down_ce.wait();
+        if (nchildren > 0) {
+          T * running = acc; // no longer needed for the up-sweep
+          pool.block_until_all_sent();
+          for (size_t i=0; i<n; i++) running[i] = (rank > 0) ? ReduceOp(pre[i], array[i]) : array[i];
+          for (int r=0; r<nchildren; r++) {
+            send(pool, core_of(rank + (1 << r)), DOWN, running);
+            pool.block_until_all_sent();
+            for (size_t i=0; i<n; i++) running[i] = ReduceOp(running[i], child[r][i]);
+          }
+        }
+        if (rank > 0) std::copy(pre, pre+n, array);
+        
+        pool.block_until_all_sent();
+        for (int r=0; r<nchildren; r++) locale_free(child[r]);
+        locale_free(acc);
+        locale_free(pre);
+        return rank > 0;
+      }
+    };
+    
+    /// Scan of a block-distributed global array. Each core combines each of
+    /// its local blocks, the block sums are scanned across cores (blocks in
+    /// the same row of the block-cyclic layout are ordered by core, rows by
+    /// row totals), and each core then rescans its own blocks starting from
+    /// their offsets. Work is O(n/cores) per core plus O(n/(cores*block))
+    /// elements of communication.
+    template< typename T, T (*ReduceOp)(const T&, const T&), void (*Keep)(T&, const T&) = nullptr >
+    void scan_array(GlobalAddress<T> base, int64_t n, bool exclusive, T init) {
+      static_assert(BLOCK_SIZE % sizeof(T) == 0, "array scan needs elements that tile blocks");
+      on_all_cores([base,n,exclusive,init]{
+        static InplaceScan<T,ReduceOp> scanner;
+        const int64_t block_elems = block_size / sizeof(T);
+        const Core P = cores(), rank = (mycore() - base.core() + P) % P;
+        
+        int64_t nfirst = std::min<int64_t>(n, base.block_max() - base);
+        int64_t nblocks = (n == 0) ? 0 : 1 + nchunks(n - nfirst, block_elems);
+        size_t rows = nchunks(nblocks, P);
+        
+        // my blocks, in order: the j-th is in row j
+        T * local = base.localize();
+        size_t nlocal = (base+n).localize() - local;
+        std::vector<size_t> starts;
+        for (size_t i = 0; i < nlocal; ) {
+          starts.push_back(i);
+          auto a = make_linear(local+i);
+          i += std::min<size_t>(nlocal - i, a.block_max() - a);
+        }
+        starts.push_back(nlocal);
+        
+        std::vector<T> sums(rows, init), totals(rows, init);
+        for (size_t j=0; j+1<starts.size(); j++) {
+          sums[j] = local[starts[j]];
+          for (size_t i=starts[j]+1; i<starts[j+1]; i++) sums[j] = ReduceOp(sums[j], local[i]);
+        }
+        
+        bool has_pre = scanner.call_exscan(sums.data(), rows, base.core(), totals.data());
+        broadcast_inplace(totals.data(), rows, base.core());
+        
+        T row_pre = init;
+        for (size_t j=0; j+1<starts.size(); j++) {
+          // offset of block j: earlier rows, then lower ranks in this row
+          bool has_offset = (j > 0) || has_pre;
+          T offset = (j == 0) ? sums[j] : has_pre ? ReduceOp(row_pre, sums[j]) : row_pre;
+          
+          for (size_t i=starts[j]; i<starts[j+1]; i++) {
+            T orig = local[i];
+            T incl = has_offset ? ReduceOp(offset, orig) : orig;
+            local[i] = exclusive ? (has_offset ? offset : init) : incl;
+            if (Keep) Keep(local[i], orig);
+            offset = incl;
+            has_offset = true;
+          }
+          row_pre = (j == 0) ? totals[0] : ReduceOp(row_pre, totals[j]);
+        }
+      });
+    }
+    
+    template< typename T >
+    void keep_start(Segmented<T>& result, const Segmented<T>& orig) { result.start = orig.start; }
+    
+  } // namespace impl
+  
+  /// Called from SPMD context. Inclusive scan over cores: returns the
+  /// combination of `myval` from cores 0..mycore(), in core order.
+  /// Blocks until the scan is complete; all cores must call it.
+  ///
+  /// @warning May only one with a given type/op combination may be used at a time,
+  ///          uses a function-private static variable.
+  ///
+  /// @b Example:
+  /// @code
+  ///   Grappa::on_all_cores([]{
+  ///     size_t mine = local_count();
+  ///     size_t end = Grappa::scan<size_t,collective_add>(mine);
+  ///     // this core's items go at [end-mine, end)
+  ///   });
+  /// @endcode
+  template< typename T, T (*ReduceOp)(const T&, const T&) >
+  T scan(T myval) {
+    static impl::InplaceScan<T,ReduceOp> scanner;
+    T pre = myval;
+    return scanner.call_exscan(&pre, 1, 0) ? ReduceOp(pre, myval) : myval;
+  }
+  
+  /// Called from SPMD context. Exclusive scan over cores: returns the
+  /// combination of `myval` from cores 0..mycore()-1, and `init` on core 0.
+  template< typename T, T (*ReduceOp)(const T&, const T&) >
+  T exscan(T myval, T init = T()) {
+    static impl::InplaceScan<T,ReduceOp> scanner;
+    T pre = myval;
+    return scanner.call_exscan(&pre, 1, 0) ? pre : init;
+  }
+  
+  /// Called from SPMD context. Elementwise exclusive scan of an array over
+  /// cores: element i becomes the combination of element i on cores
+  /// 0..mycore()-1 (`init` on core 0). Useful for finding where each core's
+  /// items go within each of a set of buckets.
+  template< typename T, T (*ReduceOp)(const T&, const T&) >
+  void exscan_inplace(T * array, size_t nelem, T init = T()) {
+    static impl::InplaceScan<T,ReduceOp> scanner;
+    if (!scanner.call_exscan(array, nelem, 0)) std::fill(array, array+nelem, init);
+  }
+  
+  /// Called from SPMD context. Inclusive scan over cores that restarts at
+  /// every core passing `start`.
+  template< typename T, T (*ReduceOp)(const T&, const T&) >
+  T segmented_scan(T myval, bool start) {
+    return scan<Segmented<T>,&segmented_op<T,ReduceOp>>(Segmented<T>{ myval, start }).value;
+  }
+  
+  /// Called from a single task. In-place inclusive scan of `n` elements of
+  /// a block-distributed global array (e.g. from global_alloc()).
+  /// Blocks until complete.
+  ///
+  /// @b Example:
+  /// @code
+  ///   auto counts = global_alloc<int64_t>(nbuckets);
+  ///   ...
+  ///   scan<int64_t,collective_add>(counts, nbuckets);
+  /// @endcode
+  template< typename T, T (*ReduceOp)(const T&, const T&) >
+  void scan(GlobalAddress<T> base, int64_t n) {
+    impl::scan_array<T,ReduceOp>(base, n, false, T());
+  }
+  
+  /// Called from a single task. In-place exclusive scan of a
+  /// block-distributed global array; the first element becomes `init`.
+  template< typename T, T (*ReduceOp)(const T&, const T&) >
+  void exscan(GlobalAddress<T> base, int64_t n, T init = T()) {
+    impl::scan_array<T,ReduceOp>(base, n, true, init);
+  }
+  
+  /// Called from a single task. In-place segmented inclusive scan of a
+  /// block-distributed global array: each `value` becomes the combination
+  /// of the values since the closest element at or before it with `start`
+  /// set. The `start` flags are left unchanged.
+  template< typename T, T (*ReduceOp)(const T&, const T&) >
+  void segmented_scan(GlobalAddress<Segmented<T>> base, int64_t n) {
+    impl::scan_array<Segmented<T>,&segmented_op<T,ReduceOp>,&impl::keep_start<T>>(
+      base, n, false, Segmented<T>{ T(), false });
+  }
+  
+  /// @}
+  
+} // namespace Grappa
@@ -0,0 +1,86 @@
+////////////////////////////////////////////////////////////////////////
+// This file is part of Grappa, a system for scaling irregular
+// applications on commodity clusters. 
+
+// Copyright (C) 2010-2014 University of Washington and Battelle
+// Memorial Institute. University of Washington authorizes use of this
+// Grappa software.
+
+// Grappa is free software: you can redistribute it and/or modify it
+// under the terms of the Affero General Public License as published
+// by Affero, Inc., either version 1 of the License, or (at your
+// option) any later version.
+
+// Grappa is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// Affero General Public License for more details.
+
+// You should have received a copy of the Affero General Public
+// License along with this program. If not, you may obtain one from
+// http://www.affero.org/oagpl.html.
+////////////////////////////////////////////////////////////////////////
+
+#include <boost/test/unit_test.hpp>
+#include "Grappa.hpp"
+#include "Scan.hpp"
+#include "ParallelLoop.hpp"
+#include "GlobalAllocator.hpp"
+#include "Delegate.hpp"
+
+// Tests the functions in Scan.hpp
+
+BOOST_AUTO_TEST_SUITE( Scan_tests );
+
+using namespace Grappa;
+
+BOOST_AUTO_TEST_CASE( test1 ) {
+  Grappa::init( GRAPPA_TEST_ARGS );
+  Grappa::run([]{
+    BOOST_MESSAGE("testing scan over cores");
+    Grappa::on_all_cores([]{
+      int64_t me = Grappa::mycore() + 1;
+      BOOST_CHECK_EQUAL((Grappa::scan<int64_t,collective_add>(me)), me*(me+1)/2);
+      BOOST_CHECK_EQUAL((Grappa::exscan<int64_t,collective_add>(me)), (me-1)*me/2);
+      BOOST_CHECK_EQUAL((Grappa::scan<int64_t,collective_max>(Grappa::cores()-me)), Grappa::cores()-1);
+      
+      // segments of 3 cores
+      int64_t seg = Grappa::segmented_scan<int64_t,collective_add>(1, Grappa::mycore() % 3 == 0);
+      BOOST_CHECK_EQUAL(seg, Grappa::mycore() % 3 + 1);
+      
+      const size_t N = 1000;
+      int64_t xs[N];
+      for (size_t i=0; i<N; i++) xs[i] = i;
+      Grappa::exscan_inplace<int64_t,collective_add>(xs, N);
+      for (size_t i=0; i<N; i++) BOOST_CHECK_EQUAL(xs[i], Grappa::mycore()*i);
+    });
+    
+    BOOST_MESSAGE("testing scan of global arrays");
+    const int64_t N = 10007;
+    auto xs = global_alloc<int64_t>(N+3);
+    auto a = xs+3; // not block-aligned
+    
+    forall(a, N, [](int64_t& x){ x = 1; });
+    scan<int64_t,collective_add>(a, N);
+    forall(a, N, [](int64_t i, int64_t& x){ BOOST_CHECK_EQUAL(x, i+1); });
+    
+    forall(a, N, [](int64_t i, int64_t& x){ x = i; });
+    exscan<int64_t,collective_add>(a, N, int64_t(100));
+    forall(a, N, [](int64_t i, int64_t& x){ BOOST_CHECK_EQUAL(x, (i == 0) ? 100 : (i-1)*i/2); });
+    
+    BOOST_MESSAGE("testing segmented scan of global arrays");
+    auto ss = global_alloc<Segmented<int64_t>>(N);
+    forall(ss, N, [](int64_t i, Segmented<int64_t>& s){ s = {1, i % 77 == 0}; });
+    segmented_scan<int64_t,collective_add>(ss, N);
+    forall(ss, N, [](int64_t i, Segmented<int64_t>& s){
+      BOOST_CHECK_EQUAL(s.value, i % 77 + 1);
+      BOOST_CHECK_EQUAL(s.start, i % 77 == 0);
+    });
+    
+    global_free(xs);
+    global_free(ss);
+  });
+  Grappa::finalize();
+}
+
+BOOST_AUTO_TEST_SUITE_END();
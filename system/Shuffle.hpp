@@ -0,0 +1,177 @@
+////////////////////////////////////////////////////////////////////////
+// This file is part of Grappa, a system for scaling irregular
+// applications on commodity clusters. 
+
+// Copyright (C) 2010-2014 University of Washington and Battelle
+// Memorial Institute. University of Washington authorizes use of this
+// Grappa software.
+
+// Grappa is free software: you can redistribute it and/or modify it
+// under the terms of the Affero General Public License as published
+// by Affero, Inc., either version 1 of the License, or (at your
+// option) any later version.
+
+// Grappa is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// Affero General Public License for more details.
+
+// You should have received a copy of the Affero General Public
+// License along with this program. If not, you may obtain one from
+// http://www.affero.org/oagpl.html.
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Collective.hpp"
+#include "LocaleSharedMemory.hpp"
+#include "Metrics.hpp"
+
+#include <vector>
+
+GRAPPA_DECLARE_METRIC(SimpleMetric<uint64_t>, shuffle_bytes_sent);
+GRAPPA_DECLARE_METRIC(SimpleMetric<uint64_t>, shuffle_messages_sent);
+
+namespace Grappa {
+  
+  /// @addtogroup Collectives
+  /// @{
+  
+  namespace impl {
+    
+    /// State for alltoallv(): per-source offsets into this core's receive
+    /// array, so each incoming chunk is copied straight into place.
+    template< typename T >
+    class Alltoallv {
+    protected:
+      T * recv;
+      std::vector<int64_t> recv_offsets;
+      CompletionEvent ce;
+      
+    public:
+      /// SPMD, must be called on static/file-global object on all cores
+      void call_alltoallv(const T * send, const int64_t * send_counts,
+                          std::vector<T>& out, std::vector<int64_t> * recv_counts) {
+        const Core P = cores(), me = mycore();
+        const size_t per = elems_per_msg<T>();
+        
+        // how much is coming from whom
+        std::vector<int64_t> from(P);
+        CollectiveRequest::start([send_counts,&from](MPI_Request * request){
+          MPI_CHECK( MPI_Ialltoall( send_counts, 1, MPI_INT64_T, from.data(), 1, MPI_INT64_T,
+                                    global_communicator.grappa_comm, request ) );
+        }).wait();
+        
+        int64_t total = 0;
+        size_t nmsg_in = 0, nmsg_out = 0;
+        recv_offsets.resize(P);
+        std::vector<int64_t> send_offsets(P);
+        for (Core c=0; c<P; c++) {
+          recv_offsets[c] = total;
+          total += from[c];
+          send_offsets[c] = (c == 0) ? 0 : send_offsets[c-1] + send_counts[c-1];
+          if (c != me) {
+            nmsg_in += nchunks(from[c], per);
+            nmsg_out += nchunks(send_counts[c], per);
+          }
+        }
+        out.resize(total);
+        recv = out.data();
+        ce.enroll(nmsg_in);
+        
+        // handler copying the chunk at offset `k` of our block into place on the receiver
+        auto deliver = [this,me](int64_t k) {
+          return [this,me,k](void * payload, size_t payload_size) {
+            auto in = static_cast<T*>(payload);
+            std::copy(in, in + payload_size/sizeof(T), this->recv + this->recv_offsets[me] + k);
+            this->ce.complete();
+          };
+        };
+        MessagePool pool(std::max<size_t>(1, nmsg_out) *
+                         sizeof(PayloadMessage<decltype(deliver(0))>));
+        barrier(); // everyone is ready to receive
+        
+        std::copy(send + send_offsets[me], send + send_offsets[me] + send_counts[me],
+                  recv + recv_offsets[me]);
+        
+        // start with the next core, so not everyone sends to core 0 first
+        for (Core i=1; i<P; i++) {
+          Core d = (me + i) % P;
+          for (int64_t k=0; k<send_counts[d]; k+=per) {
+            size_t n = std::min<int64_t>(per, send_counts[d]-k);
+            pool.send_message(d, deliver(k), (void*)(send + send_offsets[d] + k), sizeof(T)*n);
+            shuffle_bytes_sent += sizeof(T)*n;
+            shuffle_messages_sent++;
+          }
+        }
+        
+        ce.wait();
+        pool.block_until_all_sent();
+        if (recv_counts) recv_counts->swap(from);
+      }
+    };
+    
+  } // namespace impl
+  
+  /// Called from SPMD context. All-to-all personalized exchange: `send`
+  /// holds this core's outgoing elements grouped by destination core
+  /// (`send_counts[c]` of them for core c, in core order). Returns the
+  /// elements sent to this core, grouped by source core in core order;
+  /// `recv_counts`, if given, gets how many came from each core.
+  ///
+  /// Each destination's block travels in a few large payload messages
+  /// rather than one message per element. `send` must be in locale shared
+  /// memory (e.g. from locale_alloc(), or a task's stack), and T must be
+  /// trivially copyable.
+  ///
+  /// @warning May only one with a given type may be used at a time,
+  ///          uses a function-private static variable.
+  template< typename T >
+  std::vector<T> alltoallv(const T * send, const int64_t * send_counts,
+                           std::vector<int64_t> * recv_counts = nullptr) {
+    static impl::Alltoallv<T> exchange;
+    std::vector<T> out;
+    exchange.call_alltoallv(send, send_counts, out, recv_counts);
+    return out;
+  }
+  
+  /// Called from SPMD context. Send each of this core's `n` elements to
+  /// core `dest_of(element)` and return the elements sent to this core
+  /// (grouped by source core, in each source's original order).
+  ///
+  /// Does a local counting sort by destination and then an alltoallv(), so
+  /// redistributing data costs a few bulk transfers per pair of cores
+  /// instead of one message per element.
+  ///
+  /// @b Example:
+  /// @code
+  ///   Grappa::on_all_cores([]{
+  ///     // move every edge to the core owning its source vertex
+  ///     auto mine = Grappa::shuffle(local_edges, nlocal, [](const Edge& e){
+  ///       return (vertices + e.v0).core();
+  ///     });
+  ///   });
+  /// @endcode
+  template< typename T, typename F >
+  std::vector<T> shuffle(const T * local, size_t n, F dest_of) {
+    const Core P = cores();
+    std::vector<int64_t> counts(P, 0), pos(P, 0);
+    std::vector<Core> dests(n);
+    for (size_t i=0; i<n; i++) {
+      dests[i] = dest_of(local[i]);
+      DCHECK(dests[i] >= 0 && dests[i] < P);
+      counts[dests[i]]++;
+    }
+    for (Core c=1; c<P; c++) pos[c] = pos[c-1] + counts[c-1];
+    
+    T * sorted = locale_alloc<T>(std::max<size_t>(1, n));
+    for (size_t i=0; i<n; i++) sorted[pos[dests[i]]++] = local[i];
+    
+    auto out = alltoallv(sorted, counts.data());
+    locale_free(sorted);
+    return out;
+  }
+  
+  /// @}
+  
+} // namespace Grappa
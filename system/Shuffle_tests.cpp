@@ -0,0 +1,86 @@
+////////////////////////////////////////////////////////////////////////
+// This file is part of Grappa, a system for scaling irregular
+// applications on commodity clusters. 
+
+// Copyright (C) 2010-2014 University of Washington and Battelle
+// Memorial Institute. University of Washington authorizes use of this
+// Grappa software.
+
+// Grappa is free software: you can redistribute it and/or modify it
+// under the terms of the Affero General Public License as published
+// by Affero, Inc., either version 1 of the License, or (at your
+// option) any later version.
+
+// Grappa is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// Affero General Public License for more details.
+
+// You should have received a copy of the Affero General Public
+// License along with this program. If not, you may obtain one from
+// http://www.affero.org/oagpl.html.
+////////////////////////////////////////////////////////////////////////
+
+#include <boost/test/unit_test.hpp>
+#include "Grappa.hpp"
+#include "Shuffle.hpp"
+
+// Tests the functions in Shuffle.hpp
+
+BOOST_AUTO_TEST_SUITE( Shuffle_tests );
+
+using namespace Grappa;
+
+BOOST_AUTO_TEST_CASE( test1 ) {
+  Grappa::init( GRAPPA_TEST_ARGS );
+  Grappa::run([]{
+    BOOST_MESSAGE("testing shuffle");
+    Grappa::on_all_cores([]{
+      // core c sends c+k*cores() for k < N to core (c+k) % cores()
+      const int64_t N = 5000;
+      auto xs = locale_alloc<int64_t>(N);
+      for (int64_t k=0; k<N; k++) xs[k] = mycore() + k*cores();
+      
+      auto mine = Grappa::shuffle(xs, N, [](const int64_t& x){
+        return Core((x % cores() + x / cores()) % cores());
+      });
+      
+      int64_t expected = 0;
+      for (Core c=0; c<cores(); c++) {
+        for (int64_t k=0; k<N; k++) if ((c+k) % cores() == mycore()) expected++;
+      }
+      BOOST_CHECK_EQUAL(mine.size(), expected);
+      
+      // grouped by source, in the source's order
+      for (size_t i=1; i<mine.size(); i++) {
+        Core a = mine[i-1] % cores(), b = mine[i] % cores();
+        BOOST_CHECK(a < b || (a == b && mine[i-1] < mine[i]));
+      }
+      for (auto x : mine) BOOST_CHECK_EQUAL((x % cores() + x / cores()) % cores(), mycore());
+      locale_free(xs);
+    });
+    
+    BOOST_MESSAGE("testing alltoallv");
+    Grappa::on_all_cores([]{
+      // core c sends d+1 copies of c to core d
+      std::vector<int64_t> counts(cores());
+      int64_t n = 0;
+      for (Core d=0; d<cores(); d++) n += counts[d] = d+1;
+      auto xs = locale_alloc<int64_t>(n);
+      std::fill(xs, xs+n, mycore());
+      
+      std::vector<int64_t> from;
+      auto mine = Grappa::alltoallv(xs, counts.data(), &from);
+      
+      BOOST_CHECK_EQUAL(mine.size(), cores()*(mycore()+1));
+      for (Core c=0; c<cores(); c++) {
+        BOOST_CHECK_EQUAL(from[c], mycore()+1);
+        for (int64_t i=0; i<mycore()+1; i++) BOOST_CHECK_EQUAL(mine[c*(mycore()+1)+i], c);
+      }
+      locale_free(xs);
+    });
+  });
+  Grappa::finalize();
+}
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -29,6 +29,8 @@
 
 BOOST_AUTO_TEST_SUITE( Tasking_tests );
 
+DECLARE_uint64( num_starting_workers );
+
 using namespace Grappa;
 
 //
@@ -104,6 +106,28 @@ BOOST_AUTO_TEST_CASE( test1 ) {
     for (int i=0; i<num_tasks; i++) {
       BOOST_CHECK( array[i] >= 0 );
     }
+    
+    // stacks are committed lazily: this worker has touched some of its
+    // stack, but (hopefully) not all of it
+    size_t hw = impl::stack_high_water( Grappa::current_worker() );
+    BOOST_MESSAGE( "stack high water: " << hw << " of " << FLAGS_stack_size );
+    BOOST_CHECK( hw > 0 );
+    BOOST_CHECK( hw <= static_cast<size_t>( FLAGS_stack_size ) );
+  
+    // more blocked tasks than starting workers: the pool has to grow
+    {
+      int64_t n = FLAGS_num_starting_workers + 100;
+      CompletionEvent started(n), done(n);
+      for (int64_t i=0; i<n; i++) {
+        spawn([&started,&done]{
+          started.complete();
+          started.wait();
+          done.complete();
+        });
+      }
+      done.wait();
+      BOOST_CHECK( impl::global_scheduler.worker_count() > FLAGS_num_starting_workers );
+    }
   
     Metrics::merge_and_print();
   });
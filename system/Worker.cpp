@@ -29,8 +29,19 @@
 #include "PerformanceTools.hpp"
 #include <stdlib.h> // valloc
 #include "LocaleSharedMemory.hpp"
+#include "Metrics.hpp"
+#include <vector>
 
 DEFINE_int64( stack_size, MIN_STACK_SIZE, "Default stack size" );
+DEFINE_int64( stack_pool_chunk_workers, 256, "Number of worker stacks reserved at a time by the stack pool" );
+DEFINE_bool( stack_pool_decommit, true, "Give stack pages back to the OS when a worker is returned to the stack pool" );
+DEFINE_bool( stack_high_water, false, "Measure worker stack high-water marks (one mincore call per stack) when workers are released and metrics are merged" );
+
+DECLARE_uint64( num_starting_workers );
+
+GRAPPA_DEFINE_METRIC(MaxMetric<uint64_t>, worker_stack_high_water, 0);
+GRAPPA_DEFINE_METRIC(SimpleMetric<uint64_t>, worker_stack_chunks, 0);
+GRAPPA_DEFINE_METRIC(SimpleMetric<uint64_t>, worker_stacks_reused, 0);
 
 namespace Grappa {
 namespace impl {
@@ -43,6 +54,108 @@ size_t total_coros = 0;
 DEFINE_int32( stack_offset, 64, "offset between coroutine stacks" );
 size_t current_stack_offset = 0;
 
+static const size_t stack_page_size = 4096;
+
+/// Release the pages of a range of stack memory; they read back as zeros
+/// and are committed again when touched.
+static void decommit( void * addr, size_t len ) {
+#ifdef MADV_REMOVE
+  // stacks live in locale shared memory, and for shared mappings only
+  // MADV_REMOVE actually frees the pages
+  const int advice = MADV_REMOVE;
+#else
+  const int advice = MADV_DONTNEED;
+#endif
+  if( 0 != madvise( addr, len, advice ) ) {
+    VLOG(2) << "madvise failed; addr= " << addr << "; len= " << len << "; errno=" << errno;
+  }
+}
+
+/// Pool of Workers with their stacks.
+///
+/// Stacks are carved out of chunks of locale shared memory, each holding
+/// slots of [guard page | stack | guard page]. The first chunk has exactly
+/// '--num_starting_workers' slots (as adjusted to fit the footprint budget),
+/// later ones '--stack_pool_chunk_workers'.
+/// Guard pages are armed once when a chunk is carved and stay armed while
+/// the slot is reused. Stack pages are never touched up front, so a worker
+/// only commits the pages it actually uses, and returning a worker to the
+/// pool decommits them again.
+class StackPool {
+  std::vector<Worker*> free_workers;
+  size_t ssize;
+  size_t nchunks;
+
+  /// Carve a new chunk of slots. With `may_fail`, fall back to smaller
+  /// chunks if locale shared memory is short, and return false if not even
+  /// one stack fits (otherwise running out is fatal).
+  bool add_chunk( bool may_fail ) {
+    size_t slot = ssize + 2*stack_page_size;
+    size_t n = ( nchunks == 0
+                 ? FLAGS_num_starting_workers
+                 : std::max<int64_t>( 1, FLAGS_stack_pool_chunk_workers ) );
+    n = std::max<size_t>( 1, n );
+    char * chunk = nullptr;
+    if( may_fail ) {
+      for( ; n > 0; n /= 2 ) {
+        chunk = static_cast<char*>( locale_shared_memory.try_allocate_aligned( n * slot, stack_page_size ) );
+        if( chunk != nullptr ) break;
+      }
+      if( chunk == nullptr ) return false;
+    } else {
+      chunk = static_cast<char*>( locale_shared_memory.allocate_aligned( n * slot, stack_page_size ) );
+      CHECK_NOTNULL( chunk );
+    }
+    // the memory may have been used before; start with nothing committed
+    decommit( chunk, n * slot );
+    nchunks++;
+    worker_stack_chunks++;
+
+    // push in reverse so workers are handed out in address order
+    for( size_t i = n; i-- > 0; ) {
+      Worker * w = nullptr;
+      CHECK_EQ( 0, posix_memalign( reinterpret_cast<void**>( &w ), stack_page_size, sizeof(Worker) ) );
+      w->base = chunk + i * slot;
+      w->ssize = ssize;
+      w->pooled = true;
+#ifdef GUARD_PAGES_ON_STACK
+      checked_mprotect( w->base, stack_page_size, PROT_NONE );
+      checked_mprotect( (char*)w->base + ssize + stack_page_size, stack_page_size, PROT_NONE );
+#endif
+      free_workers.push_back( w );
+    }
+    return true;
+  }
+
+public:
+  StackPool(): ssize(0), nchunks(0) {}
+
+  /// Get a Worker with a stack of at least `size` bytes (rounded up to pages).
+  /// With `may_fail`, returns nullptr if there is no memory for another stack.
+  Worker * acquire( size_t size, bool may_fail ) {
+    size = (size + stack_page_size - 1) & ~(stack_page_size - 1);
+    if( ssize == 0 ) ssize = size;
+    CHECK_EQ( size, ssize ) << "stack pool only supports one stack size";
+
+    if( free_workers.empty() ) {
+      if( !add_chunk( may_fail ) ) return nullptr;
+    } else {
+      worker_stacks_reused++;
+    }
+    Worker * w = free_workers.back();
+    free_workers.pop_back();
+    return w;
+  }
+
+  void release( Worker * w ) {
+    if( FLAGS_stack_high_water ) worker_stack_high_water.add( stack_high_water( w ) );
+    if( FLAGS_stack_pool_decommit ) decommit( (char*)w->base + stack_page_size, w->ssize );
+    free_workers.push_back( w );
+  }
+};
+
+static StackPool stack_pool;
+
 /// insert a coroutine into the list of all coroutines
 /// (used only for debugging)
 void insert_coro( Worker * c ) {
@@ -60,6 +173,7 @@ void insert_coro( Worker * c ) {
 /// remove a coroutine from the list of all coroutines
 /// (used only for debugging)
 void remove_coro( Worker * c ) {
+  if( all_coros == c ) all_coros = c->tracking_next;
   // is there something to our left?
   if( c->tracking_prev ) {
     // remove us from next list
@@ -88,6 +202,7 @@ Worker * convert_to_master( Worker * me ) {
   // We don't need to free this (it's just the main stack segment)
   // so ignore it.
   me->base = NULL;
+  me->pooled = false;
   // This'll get overridden when we swapstacks out of here.
   me->stack = NULL;
 
@@ -127,10 +242,14 @@ void coro_spawn(Worker * me, Worker * c, coro_func f, size_t ssize) {
   c->suspended = 0;
   c->idle = 0;
 
-  // allocate stack and guard page
-  c->base = Grappa::impl::locale_shared_memory.allocate_aligned( ssize+4096*2, 4096 );
-  CHECK_NOTNULL( c->base );
-  c->ssize = ssize;
+  if( !c->pooled ) {
+    // allocate stack and guard page
+    c->base = Grappa::impl::locale_shared_memory.allocate_aligned( ssize+4096*2, 4096 );
+    CHECK_NOTNULL( c->base );
+    c->ssize = ssize;
+  }
+  // (pooled Workers come with a stack of their own, guard pages already armed)
+  ssize = c->ssize;
 
   // set stack pointer
   c->stack = (char*) c->base + ssize + 4096 - current_stack_offset;
@@ -148,13 +267,14 @@ void coro_spawn(Worker * me, Worker * c, coro_func f, size_t ssize) {
   c->valgrind_stack_id = VALGRIND_STACK_REGISTER( (char *) c->base + 4096, c->stack );
 #endif
 
-  // clear stack
-  memset(c->base, 0, ssize+4096*2);
+  // (stack is not cleared, so its pages are only committed when used)
 
 #ifdef GUARD_PAGES_ON_STACK
-  // arm guard page
-  checked_mprotect( c->base, 4096, PROT_NONE );
-  checked_mprotect( (char*)c->base + ssize + 4096, 4096, PROT_NONE );
+  if( !c->pooled ) {
+    // arm guard page
+    checked_mprotect( c->base, 4096, PROT_NONE );
+    checked_mprotect( (char*)c->base + ssize + 4096, 4096, PROT_NONE );
+  }
 #endif
 
   // set up coroutine to be able to run next time we're switched in
@@ -172,12 +292,12 @@ void coro_spawn(Worker * me, Worker * c, coro_func f, size_t ssize) {
 }
 
 // TODO: refactor not to take <me> argument
-Worker * worker_spawn(Worker * me, Scheduler * sched, thread_func f, void * arg) {
+Worker * worker_spawn(Worker * me, Scheduler * sched, thread_func f, void * arg, bool may_fail) {
   CHECK( sched->get_current_thread() == me ) << "parent arg differs from current thread";
  
-  // allocate the Worker and stack
-  Worker * thr = nullptr;
-  posix_memalign( reinterpret_cast<void**>( &thr ), 4096, sizeof(Worker) );
+  // get a Worker and stack from the pool
+  Worker * thr = stack_pool.acquire( FLAGS_stack_size, may_fail );
+  if( thr == nullptr ) return nullptr;
   thr->sched = sched;
   sched->assignTid( thr );
   
@@ -203,7 +323,14 @@ void destroy_coro(Worker * c) {
     VALGRIND_STACK_DEREGISTER( c->valgrind_stack_id );
   }
 #endif
-  if( c->base != NULL ) {
+  if( c->pooled ) {
+#ifdef CORO_PROTECT_UNUSED_STACK
+    checked_mprotect( (void*)((intptr_t)c->base + 4096), c->ssize, PROT_READ | PROT_WRITE );
+    checked_mprotect( (void*)(c), 4096, PROT_READ | PROT_WRITE );
+#endif
+    // stack stays with the Worker (and guard pages stay armed) in the pool
+    remove_coro(c); // remove from debugging list of coros
+  } else if( c->base != NULL ) {
     // disarm guard page
     checked_mprotect( c->base, 4096, PROT_READ | PROT_WRITE );
     checked_mprotect( (char*)c->base + c->ssize + 4096, 4096, PROT_READ | PROT_WRITE );
@@ -219,7 +346,31 @@ void destroy_coro(Worker * c) {
 
 void destroy_thread(Worker * thr) {
   destroy_coro(thr);
-  free (thr);
+  if( thr->pooled ) {
+    stack_pool.release( thr );
+  } else {
+    free (thr);
+  }
+}
+
+size_t stack_high_water(Worker * c) {
+  if( c->base == NULL ) return 0;
+  // the lowest resident page is the deepest the stack has grown
+  size_t npages = c->ssize / stack_page_size;
+  std::vector<unsigned char> resident( npages );
+  if( 0 != mincore( (char*)c->base + stack_page_size, npages * stack_page_size, resident.data() ) ) return 0;
+  for( size_t i = 0; i < npages; i++ ) {
+    if( resident[i] & 1 ) return (npages - i) * stack_page_size;
+  }
+  return 0;
+}
+
+void record_stack_high_water() {
+  for( Worker * c = all_coros; c != NULL; c = c->tracking_next ) {
+    size_t hw = stack_high_water( c );
+    DVLOG(3) << "worker " << c->id << " stack high water: " << hw << " of " << c->ssize;
+    worker_stack_high_water.add( hw );
+  }
 }
 
 void thread_exit(Worker * me, void * retval) {
@@ -95,6 +95,8 @@ class Worker {
   void * base;
   // size of the stack
   size_t ssize;
+  // stack (and this Worker) belong to the stack pool
+  bool pooled;
   threadid_t id;
 
   /* debugging state */
@@ -237,15 +239,27 @@ static void tramp(Worker * me, void * arg) {
 
 /// Spawn a new Worker belonging to the Scheduler.
 /// Current Worker is parent. Does NOT enqueue into any scheduling queue.
+/// If `may_fail`, returns NULL when there is no memory left for another
+/// stack (otherwise that is fatal).
 Worker * worker_spawn(Worker * me, Scheduler * sched,
-                     thread_func f, void * arg);
+                     thread_func f, void * arg, bool may_fail = false);
 
 /// Tear down a coroutine
 void destroy_coro(Worker * c);
 
-/// Delete the thread.
+/// Delete the thread. Pooled Workers are returned to the stack pool with
+/// their stack pages decommitted, to be reused by the next worker_spawn.
 void destroy_thread(Worker * thr);
 
+/// Bytes of the Worker's stack that have been touched since it was last
+/// spawned (stack pages are committed lazily, so this is the high-water mark
+/// rounded up to a page).
+size_t stack_high_water(Worker * c);
+
+/// Measure the stack high-water mark of every live Worker on this core into
+/// 'worker_stack_high_water'.
+void record_stack_high_water();
+
 
 /// Perform a context switch to another Worker
 /// @param running the current Worker
@@ -23,3 +23,72 @@
 
 #include "Graph.hpp"
 
+
+#include <set>
+
+DEFINE_bool(graph_balance_edges, false, "Relabel high-degree vertices in Graph::create() so each core owns about the same number of adjacencies");
+DEFINE_double(graph_balance_hub_factor, 8.0, "With --graph_balance_edges, vertices whose degree exceeds this multiple of the average are rebalanced");
+
+GRAPPA_DEFINE_METRIC(SummarizingMetric<int64_t>, graph_local_edges, 0);
+GRAPPA_DEFINE_METRIC(SimpleMetric<double>, graph_edge_imbalance, 0);
+GRAPPA_DEFINE_METRIC(SimpleMetric<int64_t>, graph_relabeled_vertices, 0);
+
+namespace Grappa {
+  namespace impl {
+    
+    EdgeBalancer& edge_balancer() {
+      static EdgeBalancer b;
+      return b;
+    }
+    
+    void EdgeBalancer::reset(Core ncores) {
+      hubs.clear();
+      loads.assign(ncores, 0);
+      light.assign(ncores, 0);
+      wanted.assign(ncores, 0);
+      incoming.assign(ncores, std::vector<Hub>());
+      swaps.clear();
+      local_load = 0;
+      local_light = 0;
+    }
+    
+    int64_t EdgeBalancer::plan() {
+      std::sort(hubs.begin(), hubs.end(), [](const Hub& a, const Hub& b){
+        return a.degree > b.degree || (a.degree == b.degree && a.id < b.id);
+      });
+      
+      // cores that can still take a hub from elsewhere, by load
+      std::set<std::pair<int64_t,Core>> open;
+      for (Core c = 0; c < static_cast<Core>(loads.size()); c++) if (light[c] > 0) open.insert({loads[c], c});
+      int64_t max_load = *std::max_element(loads.begin(), loads.end());
+      
+      int64_t moved = 0;
+      for (auto& h : hubs) {
+        Core c = h.core;
+        // move only if staying would raise the maximum load more than moving
+        if (!open.empty() && open.begin()->second != h.core &&
+            loads[h.core] + h.degree > std::max(max_load, open.begin()->first + h.degree)) {
+          c = open.begin()->second;
+        }
+        
+        bool was_open = open.erase({loads[c], c}) > 0;
+        loads[c] += h.degree;
+        if (c != h.core) {
+          wanted[c]++;
+          incoming[c].push_back(h);
+          moved++;
+        }
+        if (was_open && wanted[c] < light[c]) open.insert({loads[c], c});
+        max_load = std::max(max_load, loads[c]);
+      }
+      return moved;
+    }
+    
+    void EdgeBalancer::pair(Core core, VertexID spare, int64_t spare_degree) {
+      auto h = incoming[core].back();
+      incoming[core].pop_back();
+      swaps.push_back(Swap{ h.id, spare, h.degree, spare_degree });
+    }
+    
+  } // namespace impl
+} // namespace Grappa
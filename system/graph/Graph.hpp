@@ -31,16 +31,24 @@
 #include <Delegate.hpp>
 #include <AsyncDelegate.hpp>
 #include <Array.hpp>
+#include <BulkApply.hpp>
+#include <Metrics.hpp>
+#include <Shuffle.hpp>
 #include "TupleGraph.hpp"
 
 #include <algorithm>
 #include <iomanip>
+#include <unordered_map>
 
 // #define USE_MPI3_COLLECTIVES
 #undef USE_MPI3_COLLECTIVES
-#ifdef USE_MPI3_COLLECTIVES
-#include <mpi.h>
-#endif
+
+DECLARE_bool(graph_balance_edges);
+DECLARE_double(graph_balance_hub_factor);
+
+GRAPPA_DECLARE_METRIC(SummarizingMetric<int64_t>, graph_local_edges);
+GRAPPA_DECLARE_METRIC(SimpleMetric<double>, graph_edge_imbalance);
+GRAPPA_DECLARE_METRIC(SimpleMetric<int64_t>, graph_relabeled_vertices);
 
 namespace Grappa {
   /// @addtogroup Graph
@@ -52,6 +60,28 @@ namespace Grappa {
   /// Empty struct, for specifying lack of either Vertex or Edge data in @ref Graph.
   struct Empty {};
   
+  /// How Graph::create() initializes edge state from the payload of a
+  /// TupleGraph edge (TupleGraph::Edge::data), when the TupleGraph has one.
+  /// By default the payload is ignored and edge state default-constructed.
+  /// Specialize for edge types that should carry it:
+  ///
+  /// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  /// struct EdgeDistance { double dist; };
+  /// namespace Grappa {
+  ///   template<> struct EdgePayload<EdgeDistance> {
+  ///     static constexpr bool used = true;
+  ///     static void init(EdgeDistance * e, const TupleGraph::Edge& te) {
+  ///       new (e) EdgeDistance{ te.weight() };
+  ///     }
+  ///   };
+  /// }
+  /// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  template< typename E >
+  struct EdgePayload {
+    static constexpr bool used = false;
+    static void init(E * e, const TupleGraph::Edge& te) { new (e) E(); }
+  };
+  
   namespace impl {
     
     struct VertexBase {
@@ -70,6 +100,57 @@ namespace Grappa {
       { }
     };
     
+    /// One adjacency (directed edge) in flight while building a Graph.
+    struct Adjacency {
+      VertexID src, dst;
+      bool operator<(const Adjacency& o) const {
+        return src < o.src || (src == o.src && dst < o.dst);
+      }
+      bool operator==(const Adjacency& o) const {
+        return src == o.src && dst == o.dst;
+      }
+    };
+    
+    /// An adjacency along with its edge's payload, as shuffled by Graph::create().
+    struct PayloadAdjacency {
+      VertexID src, dst;
+      uint64_t data;
+    };
+    
+    /// Plan for relabeling vertices in Graph::create() with
+    /// --graph_balance_edges. Each core reports its hubs (vertices whose
+    /// degree is far above average) and the edge load of everything else to
+    /// core 0, which hands the hubs out to cores greedily by load. A hub
+    /// that moves swaps ids with a low-degree vertex of its new core, so
+    /// the relabeling is a set of swaps and is its own inverse.
+    struct EdgeBalancer {
+      struct Hub { VertexID id; int64_t degree; Core core; };
+      struct Swap { VertexID hub, spare; int64_t hub_degree, spare_degree; };
+      
+      // on core 0
+      std::vector<Hub> hubs;
+      std::vector<int64_t> loads;               ///< edges per core, excluding hubs
+      std::vector<int64_t> light;               ///< non-hub vertices per core
+      std::vector<int64_t> wanted;              ///< vertices each core must give up
+      std::vector<std::vector<Hub>> incoming;   ///< hubs moving to each core
+      std::vector<Swap> swaps;
+      
+      // on every core
+      int64_t local_load, local_light;
+      
+      void reset(Core ncores);
+      
+      /// Assign hubs to cores (on core 0), filling in `wanted` and `incoming`.
+      /// @return number of hubs that move
+      int64_t plan();
+      
+      /// Pair an incoming hub of `core` with a vertex it gave up (on core 0).
+      void pair(Core core, VertexID spare, int64_t spare_degree);
+    };
+    
+    /// This core's EdgeBalancer.
+    EdgeBalancer& edge_balancer();
+    
     /// Vertex with customizable inline 'data' field. Will attempt 
     /// to pack the provided type into the block-aligned Vertex 
     /// class, but if it is too large, will heap-allocate (from 
@@ -272,6 +353,9 @@ namespace Grappa {
     // Temporary internal state
     void* scratch;
     
+    // swapped vertex ids (see relabel()), or null if not relabeled
+    std::unordered_map<VertexID,VertexID> * relabeled;
+    
     GlobalAddress<Graph> self;
     
     Graph(GlobalAddress<Graph> self, GlobalAddress<Vertex> vs, int64_t nv)
@@ -282,9 +366,11 @@ namespace Grappa {
       , nadj_local(0)
       , adj_buf(nullptr)
       , scratch(nullptr)
+      , relabeled(nullptr)
     { }
   
     ~Graph() {
+      delete relabeled;
       for (Vertex& v : iterate_local(vs, nv)) { v.~Vertex(); }
       if (edge_storage) {
         for (int64_t i=0; i<nadj_local; i++) {
@@ -360,6 +446,13 @@ namespace Grappa {
     
     static GlobalAddress<Graph> Undirected(const TupleGraph& tg) { return create(tg, false); }
     static GlobalAddress<Graph> Directed(const TupleGraph& tg) { return create(tg, true); }
+    
+    /// Construct directly from an edge file, streaming edges to the cores
+    /// that own them without building an intermediate TupleGraph.
+    /// (only "bintsv4" supported so far, without edge payloads or
+    /// --graph_balance_edges)
+    static GlobalAddress<Graph> Load(std::string path, std::string format = "bintsv4",
+                                     bool directed = false, bool solo_invalid = true);
       
     VertexID id(Vertex& v) {
       return make_linear(&v) - vs;
@@ -370,6 +463,19 @@ namespace Grappa {
       return Edge{ j, vs+j, v.local_edge_state[i] };
     }
     
+    /// Map a vertex id of the input edges to its id in this Graph, or back
+    /// (the mapping is its own inverse). Ids only differ if the Graph was
+    /// built by create() with --graph_balance_edges.
+    VertexID relabel(VertexID i) const {
+      if (!relabeled) return i;
+      auto it = relabeled->find(i);
+      return (it == relabeled->end()) ? i : it->second;
+    }
+    
+  private:
+    static void finish_create(GlobalAddress<Graph> g, bool solo_invalid);
+    static void balance_edges(GlobalAddress<Graph> g);
+    
   } GRAPPA_BLOCK_ALIGNED;  
   
   ////////////////////////////////////////////////////
@@ -605,6 +711,10 @@ namespace Grappa {
   /// @param solo_invalid  mark vertices with no in- or out-edges as 
   ///                      invalid (not to be visited when iterating 
   ///                      over vertices)
+  /// 
+  /// With --graph_balance_edges, high-degree vertices are relabeled so
+  /// that each core owns about the same number of adjacencies; use
+  /// Graph::relabel() to translate between input and Graph vertex ids.
   template< typename V, typename E >
   GlobalAddress<Graph<V,E>> Graph<V,E>::create(const TupleGraph& tg,
       bool directed, bool solo_invalid) {
@@ -612,6 +722,10 @@ namespace Grappa {
     double t;
     auto g = symmetric_global_alloc<Graph>();
     
+    // carry edge payloads along with adjacencies? (stored after them in
+    // each vertex's temporary array, then used to initialize edge state)
+    const bool payload = EdgePayload<E>::used && tg.has_data;
+    
     // find nv
         t = walltime();
     forall(tg.edges, tg.nedge, [g](TupleGraph::Edge& e){
@@ -662,17 +776,16 @@ namespace Grappa {
     });
     VLOG(2) << "count_time: " << walltime() - t;
 
+  #ifdef SMALL_GRAPH
+    CHECK(!FLAGS_graph_balance_edges) << "--graph_balance_edges is not supported with SMALL_GRAPH";
+  #else
+    if (FLAGS_graph_balance_edges) balance_edges(g);
+  #endif
+
   #ifdef SMALL_GRAPH
     t = walltime();  
   #ifdef USE_MPI3_COLLECTIVES
-    on_all_cores([g]{
-      MPI_Request r; int done;
-      MPI_Iallreduce(MPI_IN_PLACE, g->scratch, g->nv, MPI_INT64_T, MPI_SUM, global_communicator.grappa_comm, &r);
-      do {
-        MPI_Test( &r, &done, MPI_STATUS_IGNORE );
-        if(!done) { Grappa::yield(); }
-      } while(!done);
-    });
+    on_all_cores([g]{ iallreduce<int64_t,collective_add>(g->scratch, g->nv).wait(); });
   #else
     on_all_cores([g]{ allreduce_inplace<int64_t,collective_add>(g->scratch, g->nv); });
   #endif // USE_MPI3_COLLECTIVES
@@ -681,49 +794,84 @@ namespace Grappa {
   #endif // SMALL_GRAPH  
 
     // allocate space for each vertex's adjacencies (+ duplicates)
-    forall(g->vs, g->nv, [g](int64_t i, Vertex& v) {
+    forall(g->vs, g->nv, [g,payload](int64_t i, Vertex& v) {
   #ifdef SMALL_GRAPH
       // adjust b/c allreduce didn't account for having 1 instance per locale
       v.local_sz = g->scratch[i] / locale_cores();
   #endif
   
       v.nadj = 0;
-      if (v.local_sz > 0) v.local_adj = new VertexID[v.local_sz];
+      if (v.local_sz > 0) v.local_adj = new VertexID[payload ? 2*v.local_sz : v.local_sz];
     });
     VLOG(3) << "after adj allocs";
 
-    // scatter
-    forall(tg.edges, tg.nedge, [g,directed](TupleGraph::Edge& e){
-      auto scatter = [g](int64_t vi, int64_t adj) {
-        auto vaddr = g->vs+vi;
-        delegate::call<SyncMode::Async>(vaddr.core(), [vaddr,adj]{
-          auto& v = *vaddr.pointer();
-          v.local_adj[v.nadj++] = adj;
+    // scatter: shuffle each core's edges, as adjacencies, to the cores owning
+    // their source vertices (a round of up to BULK_CHUNK edges at a time, so
+    // staging stays small)
+    auto edges = tg.edges; auto nedge = tg.nedge;
+    on_all_cores([g,edges,nedge,directed,payload]{
+      auto vs = g->vs;
+      auto local = iterate_local(edges, nedge);
+      TupleGraph::Edge * es = local.begin();
+      int64_t n = local.size();
+      auto rounds = allreduce<int64_t,collective_max>((n + impl::BULK_CHUNK - 1) / impl::BULK_CHUNK);
+      
+      std::vector<impl::PayloadAdjacency> out;
+      out.reserve(2*impl::BULK_CHUNK);
+      for (int64_t r = 0; r < rounds; r++) {
+        out.clear();
+        for (int64_t i = r*impl::BULK_CHUNK; i < std::min<int64_t>(n, (r+1)*impl::BULK_CHUNK); i++) {
+          auto v0 = g->relabel(es[i].v0), v1 = g->relabel(es[i].v1);
+          out.push_back({v0, v1, es[i].data});
+          if (!directed) out.push_back({v1, v0, es[i].data});
+        }
+        auto mine = shuffle(out.data(), out.size(), [vs](const impl::PayloadAdjacency& a){
+          return (vs+a.src).core();
         });
-      };
-      scatter(e.v0, e.v1);
-      if (!directed) scatter(e.v1, e.v0);
+        for (auto& a : mine) {
+          auto& v = *(vs+a.src).pointer();
+          if (payload) v.local_adj[v.local_sz+v.nadj] = a.data;
+          v.local_adj[v.nadj++] = a.dst;
+        }
+      }
     });
     VLOG(3) << "after scatter, nv = " << g->nv;
 
     // sort & de-dup
-    forall(g->vs, g->nv, [g](int64_t vi, Vertex& v){
+    forall(g->vs, g->nv, [g,payload](int64_t vi, Vertex& v){
       CHECK_EQ(v.nadj, v.local_sz);
-      std::sort(v.local_adj, v.local_adj+v.nadj);
-  
-      int64_t tail = 0;
-      for (int64_t i=0; i<v.nadj; i++, tail++) {
-        v.local_adj[tail] = v.local_adj[i];
-        while (v.local_adj[tail] == v.local_adj[i+1]) i++;
+      if (payload) {
+        // sort adjacencies together with their payloads; keep first of duplicates
+        auto data = v.local_adj + v.local_sz;
+        std::vector<std::pair<VertexID,VertexID>> pairs(v.nadj);
+        for (int64_t i=0; i<v.nadj; i++) pairs[i] = std::make_pair(v.local_adj[i], data[i]);
+        std::sort(pairs.begin(), pairs.end());
+        
+        int64_t tail = 0;
+        for (int64_t i=0; i<v.nadj; i++) {
+          if (tail > 0 && v.local_adj[tail-1] == pairs[i].first) continue;
+          v.local_adj[tail] = pairs[i].first;
+          data[tail] = pairs[i].second;
+          tail++;
+        }
+        v.nadj = tail;
+      } else {
+        std::sort(v.local_adj, v.local_adj+v.nadj);
+        
+        int64_t tail = 0;
+        for (int64_t i=0; i<v.nadj; i++, tail++) {
+          v.local_adj[tail] = v.local_adj[i];
+          while (i+1 < v.nadj && v.local_adj[tail] == v.local_adj[i+1]) i++;
+        }
+        v.nadj = tail;
       }
-      v.nadj = tail;
       // VLOG(0) << "<" << vi << ">" << util::array_str("", v.local_adj, v.nadj);
       g->nadj_local += v.nadj;
     });
     VLOG(3) << "after sort";
 
     // compact
-    on_all_cores([g]{
+    on_all_cores([g,payload]{
   #ifdef SMALL_GRAPH
       if (locale_mycore() == 0) locale_free(g->scratch);
   #endif
@@ -734,10 +882,11 @@ namespace Grappa {
       g->adj_buf = locale_alloc<VertexID>(g->nadj_local);
       g->edge_storage = locale_alloc<EdgeState>(g->nadj_local);
       
-      // default-initialize edges
-      // TODO: import edge info from TupleGraph
-      for (size_t i=0; i<g->nadj_local; i++) {
-        new (g->edge_storage+i) EdgeState();
+      // default-initialize edges (unless initializing from payloads below)
+      if (!payload) {
+        for (size_t i=0; i<g->nadj_local; i++) {
+          new (g->edge_storage+i) EdgeState();
+        }
       }
       
       // compute total nadj
@@ -747,6 +896,15 @@ namespace Grappa {
       for (Vertex& v : iterate_local(g->vs, g->nv)) {
         auto adj = g->adj_buf + offset;
         Grappa::memcpy(adj, v.local_adj, v.nadj);
+        if (payload) {
+          // (payloads see the input's vertex ids)
+          auto vi = g->relabel(g->id(v));
+          auto data = v.local_adj + v.local_sz;
+          for (int64_t i=0; i<v.nadj; i++) {
+            TupleGraph::Edge te = { vi, g->relabel(v.local_adj[i]), static_cast<uint64_t>(data[i]) };
+            EdgePayload<E>::init(g->edge_storage+offset+i, te);
+          }
+        }
         if (v.local_sz > 0) delete[] v.local_adj;
         v.local_sz = v.nadj;
         v.local_adj = adj;
@@ -756,6 +914,94 @@ namespace Grappa {
       CHECK_EQ(offset, g->nadj_local);
     });
     
+    finish_create(g, solo_invalid);
+    return g;
+  }
+  
+  /// Relabel hubs so each core owns about the same number of adjacencies.
+  /// Runs in create() after the edges are counted (so `local_sz` is each
+  /// vertex's degree) and before they are scattered.
+  template< typename V, typename E >
+  void Graph<V,E>::balance_edges(GlobalAddress<Graph> g) {
+    double t = walltime();
+    auto total = sum_all_cores([g]{
+      int64_t n = 0;
+      for (Vertex& v : iterate_local(g->vs, g->nv)) n += v.local_sz;
+      return n;
+    });
+    auto threshold = std::max<int64_t>(1, FLAGS_graph_balance_hub_factor * total / g->nv);
+    
+    // report hubs and the load of everything else to core 0
+    call_on_all_cores([]{ impl::edge_balancer().reset(cores()); });
+    on_all_cores([g,threshold]{
+      auto& b = impl::edge_balancer();
+      for (Vertex& v : iterate_local(g->vs, g->nv)) {
+        if (v.local_sz > threshold) {
+          impl::EdgeBalancer::Hub h = { g->id(v), v.local_sz, mycore() };
+          delegate::call<SyncMode::Async>(0, [h]{ impl::edge_balancer().hubs.push_back(h); });
+        } else {
+          b.local_load += v.local_sz;
+          b.local_light++;
+        }
+      }
+      auto c = mycore(); auto load = b.local_load; auto light = b.local_light;
+      delegate::call<SyncMode::Async>(0, [c,load,light]{
+        impl::edge_balancer().loads[c] = load;
+        impl::edge_balancer().light[c] = light;
+      });
+    });
+    impl::local_gce.wait();
+    
+    auto moved = delegate::call(0, []{ return impl::edge_balancer().plan(); });
+    VLOG(1) << "balance_edges: hub degree > " << threshold << ", moving " << moved << " hubs";
+    if (moved == 0) return;
+    
+    // each core gives up its lowest-degree vertices to make room for its incoming hubs
+    on_all_cores([g,threshold]{
+      auto c = mycore();
+      auto wanted = delegate::call(0, [c]{ return impl::edge_balancer().wanted[c]; });
+      if (wanted == 0) return;
+      std::vector<std::pair<int64_t,VertexID>> light;
+      for (Vertex& v : iterate_local(g->vs, g->nv)) {
+        if (v.local_sz <= threshold) light.emplace_back(v.local_sz, g->id(v));
+      }
+      CHECK_LE(wanted, static_cast<int64_t>(light.size()));
+      std::partial_sort(light.begin(), light.begin()+wanted, light.end());
+      for (int64_t k = 0; k < wanted; k++) {
+        auto spare = light[k];
+        delegate::call<SyncMode::Async>(0, [c,spare]{
+          impl::edge_balancer().pair(c, spare.second, spare.first);
+        });
+      }
+    });
+    impl::local_gce.wait();
+    
+    // replicate the swaps on all cores, moving the degree counts along
+    on_all_cores([g]{
+      std::vector<impl::EdgeBalancer::Swap> swaps;
+      if (mycore() == 0) swaps = impl::edge_balancer().swaps;
+      auto nswaps = allreduce<int64_t,collective_max>(static_cast<int64_t>(swaps.size()));
+      swaps.resize(nswaps);
+      broadcast_inplace(swaps.data(), swaps.size());
+      
+      g->relabeled = new std::unordered_map<VertexID,VertexID>(2*nswaps);
+      for (auto& s : swaps) {
+        (*g->relabeled)[s.hub] = s.spare;
+        (*g->relabeled)[s.spare] = s.hub;
+        auto h = g->vs+s.hub, p = g->vs+s.spare;
+        if (h.core() == mycore()) h.pointer()->local_sz = s.spare_degree;
+        if (p.core() == mycore()) p.pointer()->local_sz = s.hub_degree;
+      }
+    });
+    call_on_all_cores([]{ impl::edge_balancer().reset(0); });
+    
+    graph_relabeled_vertices = 2*moved;
+    VLOG(2) << "balance_edges_time: " << walltime() - t;
+  }
+  
+  /// Mark solo vertices invalid and report memory usage (common to all constructors).
+  template< typename V, typename E >
+  void Graph<V,E>::finish_create(GlobalAddress<Graph> g, bool solo_invalid) {
     if (solo_invalid) {
       // (note: this isn't necessary if we don't create vertices for those with no edges)
       // find which are actually active (first, those with outgoing edges)
@@ -765,6 +1011,16 @@ namespace Grappa {
     }    
     VLOG(1) << "-- vertices: " << g->nv;
     
+    // how evenly are adjacencies spread over cores? (max / mean)
+    on_all_cores([g]{
+      graph_local_edges += g->nadj_local;
+      auto max_local = allreduce<int64_t,collective_max>(g->nadj_local);
+      if (mycore() == 0 && g->nadj > 0) {
+        graph_edge_imbalance = static_cast<double>(max_local) * cores() / g->nadj;
+        VLOG(1) << "-- edge imbalance: " << graph_edge_imbalance.value();
+      }
+    });
+    
     auto gsz = Vertex::global_heap_size()*g->nv
                           + sizeof(Graph) * cores();
     auto lsz = Vertex::locale_heap_size()*g->nv
@@ -774,6 +1030,150 @@ namespace Grappa {
               << "\n  locale_heap_size: " << GB(lsz) << " GB"
               << "\n  global_heap_size: " << GB(gsz) << " GB"
               << "\n  graph_total_size: " << GB(lsz+gsz) << " GB";
+  }
+  
+  /// @brief Construct a distributed adjacency-list Graph from an edge file.
+  /// 
+  /// Unlike create(), this never materializes the edge list as a TupleGraph
+  /// or per-vertex temporary arrays, and never holds a core's whole slice of
+  /// the file: each core scans its slice in chunks, once to find nv, once to
+  /// count adjacencies per owner core (so receive buffers are allocated
+  /// exactly), and once to ship each adjacency to the owner of its source
+  /// vertex in packed bulk messages. Each core then sorts, de-dups and
+  /// compacts what it received, and frees the received adjacencies before
+  /// allocating edge storage, so only the adjacency list and its compacted
+  /// copy are ever alive at once.
+  /// 
+  /// bintsv4 edges carry no payload, so edge state is always
+  /// default-constructed (EdgePayload is not consulted), and vertices are
+  /// never relabeled: --graph_balance_edges is only supported by create().
+  /// 
+  /// @param path          edge file
+  /// @param format        file format (currently only "bintsv4")
+  /// @param directed      if false, add the reverse of each edge to make
+  ///                      the graph undirected
+  /// @param solo_invalid  mark vertices with no in- or out-edges as invalid
+  template< typename V, typename E >
+  GlobalAddress<Graph<V,E>> Graph<V,E>::Load(std::string path, std::string format,
+      bool directed, bool solo_invalid) {
+    CHECK_EQ(format, "bintsv4") << "Graph::Load only supports bintsv4; use TupleGraph::Load() with Graph::create()";
+    CHECK(!FLAGS_graph_balance_edges) << "--graph_balance_edges is not supported by Graph::Load; use TupleGraph::Load() with Graph::create()";
+    VLOG(1) << "Graph: " << (directed ? "directed" : "undirected") << ", streaming from " << path;
+    
+    const size_t max_path_length = 1024;
+    CHECK_LT(path.size() + 1, max_path_length) << "Sorry, filename exceeds preset limit.";
+    char filename[ max_path_length ];
+    strncpy(&filename[0], path.c_str(), max_path_length);
+    
+    double t;
+    auto g = symmetric_global_alloc<Graph>();
+    
+    // scan each core's share of the file to find nv
+        t = walltime();
+    on_all_cores([=]{
+      new (g.localize()) Graph(g, GlobalAddress<Vertex>(), 0);
+      int64_t nv = 0;
+      TupleGraph::scan_local_bintsv4(filename, impl::BULK_CHUNK, [&nv](const int32_t * pairs, int64_t n){
+        for (int64_t i=0; i<2*n; i++) if (pairs[i] > nv) nv = pairs[i];
+      });
+      g->nv = allreduce<int64_t,collective_max>(nv) + 1;
+    });
+        VLOG(2) << "scan_time: " << walltime() - t;
+    
+    auto vs = global_alloc<Vertex>(g->nv);
+    on_all_cores([g,vs]{
+      g->vs = vs;
+      for (Vertex& v : iterate_local(g->vs, g->nv)) {
+        new (&v) Vertex();
+      }
+    });
+    
+    // send each adjacency to the core owning its source vertex
+                                                              t = walltime();
+    on_all_cores([=]{
+      auto vs = g->vs;
+      auto owner = [vs](const impl::Adjacency& a){ return (vs+a.src).core(); };
+      
+      // count adjacencies destined for each core, so receivers can size buffers
+      std::vector<int64_t> counts(cores(), 0);
+      TupleGraph::scan_local_bintsv4(filename, impl::BULK_CHUNK, [&](const int32_t * pairs, int64_t n){
+        for (int64_t i=0; i<n; i++) {
+          counts[(vs+pairs[2*i]).core()]++;
+          if (!directed) counts[(vs+pairs[2*i+1]).core()]++;
+        }
+      });
+      allreduce_inplace<int64_t,collective_add>(counts.data(), cores());
+      int64_t nrecv = counts[mycore()];
+      
+      g->scratch = locale_alloc<impl::Adjacency>(std::max<int64_t>(nrecv, 1));
+      g->nadj_local = 0;
+      barrier(); // everyone's receive buffer must exist before we send
+      
+      std::vector<impl::Adjacency> reqs;
+      reqs.reserve(2*impl::BULK_CHUNK);
+      TupleGraph::scan_local_bintsv4(filename, impl::BULK_CHUNK, [&](const int32_t * pairs, int64_t n){
+        reqs.clear();
+        for (int64_t i=0; i<n; i++) {
+          reqs.push_back({pairs[2*i], pairs[2*i+1]});
+          if (!directed) reqs.push_back({pairs[2*i+1], pairs[2*i]});
+        }
+        impl::bulk_apply(reqs.data(), reqs.size(), owner, [g](const impl::Adjacency& a){
+          auto p = g.localize();
+          static_cast<impl::Adjacency*>(p->scratch)[p->nadj_local++] = a;
+        });
+      });
+      
+      barrier(); // all adjacencies have arrived
+      CHECK_EQ(g->nadj_local, nrecv);
+    });
+    VLOG(2) << "exchange_time: " << walltime() - t;
+    
+    // sort, de-dup, and compact into CSR
+                                                              t = walltime();
+    on_all_cores([g]{
+      auto adjs = static_cast<impl::Adjacency*>(g->scratch);
+      int64_t m = g->nadj_local;
+      std::sort(adjs, adjs+m);
+      m = std::unique(adjs, adjs+m) - adjs;
+      
+      // compact destinations into the front of the same buffer, recording
+      // degrees as we go (dsts[j] only overwrites adjacencies before j)
+      auto dsts = reinterpret_cast<VertexID*>(adjs);
+      for (int64_t i=0; i<m; ) {
+        auto src = adjs[i].src;
+        auto& v = *(g->vs+src).pointer();
+        int64_t j = i;
+        for (; j<m && adjs[j].src == src; j++) dsts[j] = adjs[j].dst;
+        v.nadj = v.local_sz = j - i;
+        i = j;
+      }
+      
+      g->nadj_local = m;
+      g->adj_buf = locale_alloc<VertexID>(m);
+      std::copy(dsts, dsts+m, g->adj_buf);
+      locale_free(adjs);
+      g->scratch = nullptr;
+      
+      g->edge_storage = locale_alloc<EdgeState>(m);
+      for (int64_t i=0; i<m; i++) {
+        new (g->edge_storage+i) EdgeState();
+      }
+      
+      // local vertices are in increasing id order, like the sorted adjacencies
+      int64_t offset = 0;
+      for (Vertex& v : iterate_local(g->vs, g->nv)) {
+        v.local_adj = g->adj_buf + offset;
+        v.local_edge_state = g->edge_storage + offset;
+        offset += v.local_sz;
+      }
+      CHECK_EQ(offset, m);
+      
+      VLOG(2) << "nadj_local = " << g->nadj_local;
+      g->nadj = allreduce<int64_t,collective_add>(g->nadj_local);
+    });
+    VLOG(2) << "build_time: " << walltime() - t;
+    
+    finish_create(g, solo_invalid);
     return g;
   }
   
@@ -25,6 +25,20 @@
 #include <Grappa.hpp>
 #include <graph/Graph.hpp>
 #include <GlobalVector.hpp>
+#include <fstream>
+
+struct EData {
+  double weight;
+};
+
+namespace Grappa {
+  template<> struct EdgePayload<EData> {
+    static constexpr bool used = true;
+    static void init(EData * e, const TupleGraph::Edge& te) {
+      new (e) EData{ te.weight() };
+    }
+  };
+}
 
 BOOST_AUTO_TEST_SUITE( Graph_tests );
 
@@ -35,15 +49,17 @@ struct VData {
   VertexID parent;
 };
 
-struct EData {
-  double weight;
-};
-
 using MyGraph = Graph<VData,EData>;
 
+/// symmetric, so both directions of an undirected edge agree
+double expected_weight(VertexID i, VertexID j) {
+  return static_cast<double>(std::min(i,j)) + 1.0 / (1 + std::max(i,j));
+}
+
 GlobalCompletionEvent c;
 
 int64_t count;
+double weight_sum;
 
 DEFINE_int32(scale, 10, "Log2 number of vertices.");
 
@@ -165,6 +181,181 @@ BOOST_AUTO_TEST_CASE( test1 ) {
       count += (total > 0);
     });
     
+    ////////////////////////////////////////////////////////////
+    // streaming construction from a file should match create()
+    {
+      std::string path = "Graph_tests.bintsv4";
+      tg.save(path, "bintsv4");
+      auto gl = MyGraph::Load(path, "bintsv4");
+      
+      CHECK_EQ(gl->nv, g->nv);
+      CHECK_EQ(gl->nadj, g->nadj);
+      
+      forall(g, [gl](VertexID i, MyGraph::Vertex& v){
+        int64_t sum = 0;
+        for (int64_t k=0; k<v.nadj; k++) sum += v.local_adj[k];
+        auto nadj = v.nadj;
+        delegate::call(gl->vs+i, [=](MyGraph::Vertex& u){
+          CHECK_EQ(u.nadj, nadj) << "vertex " << i;
+          int64_t usum = 0;
+          for (int64_t k=0; k<u.nadj; k++) {
+            if (k > 0) CHECK_LT(u.local_adj[k-1], u.local_adj[k]);
+            usum += u.local_adj[k];
+          }
+          CHECK_EQ(usum, sum) << "vertex " << i;
+        });
+      });
+      
+      gl->destroy();
+      std::remove(path.c_str());
+    }
+    
+    ////////////////////////////////////////////////////////////////
+    // edge-balanced construction: same graph up to relabeling of hubs
+    {
+      auto hub_factor = FLAGS_graph_balance_hub_factor;
+      FLAGS_graph_balance_hub_factor = 2.0;
+      FLAGS_graph_balance_edges = true;
+      auto gb = MyGraph::create(tg);
+      FLAGS_graph_balance_edges = false;
+      FLAGS_graph_balance_hub_factor = hub_factor;
+      
+      CHECK_EQ(gb->nv, g->nv);
+      CHECK_EQ(gb->nadj, g->nadj);
+      LOG(INFO) << "edge imbalance: " << graph_edge_imbalance.value()
+                << " (" << graph_relabeled_vertices << " relabeled)";
+      
+      forall(g, [gb](VertexID i, MyGraph::Vertex& v){
+        int64_t sum = 0;
+        for (int64_t k=0; k<v.nadj; k++) sum += gb->relabel(v.local_adj[k]);
+        auto nadj = v.nadj;
+        auto bi = gb->relabel(i);
+        CHECK_EQ(gb->relabel(bi), i);
+        delegate::call(gb->vs+bi, [=](MyGraph::Vertex& u){
+          CHECK_EQ(u.nadj, nadj) << "vertex " << i;
+          int64_t usum = 0;
+          for (int64_t k=0; k<u.nadj; k++) usum += u.local_adj[k];
+          CHECK_EQ(usum, sum) << "vertex " << i;
+        });
+      });
+      
+      gb->destroy();
+    }
+    
+    ////////////////////////////////////////////////////////////////
+    // balancing should even out a graph whose hubs all live on core 0
+    if (cores() > 1) {
+      const int64_t nv = 64 * cores(), nhubs = 4, nspokes = nv - nhubs * cores();
+      TupleGraph sk(nhubs * nspokes);
+      forall(sk.edges, sk.nedge, [=](int64_t i, TupleGraph::Edge& e){
+        e.v0 = (i / nspokes) * cores();        // hubs 0, c, 2c, ... are all on core 0
+        e.v1 = nhubs * cores() + i % nspokes;  // spokes are spread over all cores
+        e.data = 0;
+      });
+      
+      auto gs = MyGraph::create(sk);
+      double before = graph_edge_imbalance.value();
+      CHECK_GT(before, 1.2);
+      
+      auto hub_factor = FLAGS_graph_balance_hub_factor;
+      FLAGS_graph_balance_hub_factor = 8.0;
+      FLAGS_graph_balance_edges = true;
+      graph_relabeled_vertices = 0;
+      auto gb = MyGraph::create(sk);
+      FLAGS_graph_balance_edges = false;
+      FLAGS_graph_balance_hub_factor = hub_factor;
+      double after = graph_edge_imbalance.value();
+      
+      CHECK_EQ(gb->nadj, gs->nadj);
+      CHECK_GT(graph_relabeled_vertices.value(), 0);
+      CHECK_LT(after, 0.75 * before) << "edge imbalance: " << before << " -> " << after;
+      LOG(INFO) << "skewed edge imbalance: " << before << " -> " << after;
+      
+      gb->destroy();
+      gs->destroy();
+      sk.destroy();
+    }
+    
+    ////////////////////////////////////////////////////
+    // text loader should read back what we saved
+    {
+      std::string path = "Graph_tests.tsv";
+      tg.save(path, "tsv");
+      auto tl = TupleGraph::Load(path, "tsv");
+      CHECK_EQ(tl.nedge, tg.nedge);
+      CHECK(!tl.has_data);
+      
+      auto checksum = [](TupleGraph t){
+        call_on_all_cores([]{ count = 0; });
+        forall(t.edges, t.nedge, [](TupleGraph::Edge& e){ count += e.v0 * 7 + e.v1; });
+        return reduce<int64_t,collective_add>(&count);
+      };
+      CHECK_EQ(checksum(tl), checksum(tg));
+      
+      tl.destroy();
+      std::remove(path.c_str());
+    }
+    
+    ////////////////////////////////////////////////////
+    // MatrixMarket: header, comments, and lines of varying length, so each
+    // core's byte range starts and ends in the middle of a line
+    {
+      std::string path = "Graph_tests.mm";
+      const int64_t n = 1000;
+      int64_t expected_sum = 0;
+      double expected_weights = 0;
+      {
+        std::ofstream out(path);
+        out << "%%MatrixMarket matrix coordinate real general\n"
+            << "% written by Graph_tests\n"
+            << "%\n"
+            << "100 100 " << n << "\n";
+        for (int64_t k = 0; k < n; k++) {
+          int64_t i = k % 97 + 1, j = (k * 31) % 89 + 1;
+          double w = k + 0.5;
+          if (k % 50 == 0) out << "% comment among the entries\n";
+          out << std::string(k % 5, ' ') << i << std::string(1 + k % 13, ' ')
+              << j << std::string(1 + k % 7, '\t') << w << "\n";
+          expected_sum += i * 7 + j;
+          expected_weights += w;
+        }
+      }
+      
+      auto tm = TupleGraph::Load(path, "mm");
+      CHECK_EQ(tm.nedge, n);
+      CHECK(tm.has_data);
+      
+      call_on_all_cores([]{ count = 0; weight_sum = 0; });
+      forall(tm.edges, tm.nedge, [](TupleGraph::Edge& e){
+        count += e.v0 * 7 + e.v1;
+        weight_sum += e.weight();
+      });
+      CHECK_EQ(reduce<int64_t,collective_add>(&count), expected_sum);
+      CHECK_EQ(reduce<double,collective_add>(&weight_sum), expected_weights);
+      
+      tm.destroy();
+      std::remove(path.c_str());
+    }
+    
+    ///////////////////////////////////////////////////////////////
+    // edge payloads from the TupleGraph should end up in edge state
+    {
+      forall(tg.edges, tg.nedge, [](TupleGraph::Edge& e){
+        double w = expected_weight(e.v0, e.v1);
+        std::memcpy(&e.data, &w, sizeof(w));
+      });
+      tg.has_data = true;
+      
+      auto gw = MyGraph::create(tg);
+      CHECK_EQ(gw->nadj, g->nadj);
+      forall(gw, [gw](MyGraph::Vertex& v, MyGraph::Edge& e){
+        auto vi = make_linear(&v) - gw->vs;
+        CHECK_EQ(e->weight, expected_weight(vi, e.id));
+      });
+      gw->destroy();
+      tg.has_data = false;
+    }
+    
     LOG(INFO) << degree;
     Metrics::merge_and_dump_to_file();
     
@@ -27,9 +27,14 @@
 #include "ParallelLoop.hpp"
 #include "FileIO.hpp"
 #include "Delegate.hpp"
+#include "BulkApply.hpp"
+#include "Metrics.hpp"
 
 #include <fstream>
+#include <sstream>
 #include <vector>
+#include <sys/mman.h>
+#include <fcntl.h>
 
 DEFINE_bool( use_mpi_io, false, "Use MPI IO optimizations" );
 
@@ -43,6 +48,15 @@ struct Int32Edge { int32_t v0, v1; };
 /// TODO: replace with scan operation once we're using MPI non-blocking collectives
 static int64_t local_offset = 0;
 
+/// number of edges read on this core that had a payload column
+static int64_t local_payload_count = 0;
+
+/// text loader statistics
+GRAPPA_DEFINE_METRIC( SimpleMetric<int64_t>, tuplegraph_text_bytes_parsed, 0 );
+GRAPPA_DEFINE_METRIC( SimpleMetric<int64_t>, tuplegraph_text_edges_moved, 0 );
+GRAPPA_DEFINE_METRIC( SimpleMetric<double>, tuplegraph_text_parse_time, 0 );
+GRAPPA_DEFINE_METRIC( SimpleMetric<double>, tuplegraph_text_parse_MBps, 0 );
+
 namespace Grappa {
 
 /// helper method for parallel load of a single file
@@ -113,169 +127,293 @@ void local_load_bintsv4( const char * filename,
     auto v1 = local_load_ptr[i].v1;
     local_ptr[i].v0 = v0;
     local_ptr[i].v1 = v1;
+    local_ptr[i].data = 0; // no payload in this format
   }
 }
 
 
-/// helper method for parallel load of a single file
-static std::vector< Grappa::TupleGraph::Edge > read_edges;
+void TupleGraph::scan_local_bintsv4( const char * filename, int64_t chunk,
+                                     std::function< void( const int32_t * pairs, int64_t n ) > f ) {
+  CHECK( fs::exists( filename ) ) << "File not found.";
+  CHECK( fs::is_regular_file( filename ) ) << "File is not a regular file.";
+  CHECK_GT( chunk, 0 );
+
+  int64_t nedge = fs::file_size( filename ) / sizeof(Int32Edge);
+  int64_t start = nedge * Grappa::mycore() / Grappa::cores();
+  int64_t end = nedge * (Grappa::mycore()+1) / Grappa::cores();
+
+  std::vector< Int32Edge > buf( std::min( chunk, std::max< int64_t >( end - start, 1 ) ) );
+
+  std::ifstream infile( filename, std::ios_base::in | std::ios_base::binary );
+  infile.seekg( start * sizeof(Int32Edge) );
+  for( int64_t i = start; i < end; i += chunk ) {
+    int64_t count = std::min( chunk, end - i );
+    infile.read( (char*) buf.data(), count * sizeof(Int32Edge) );
+    CHECK_EQ( infile.gcount(), static_cast< std::streamsize >( count * sizeof(Int32Edge) ) ) << "Short read from " << filename;
+    f( reinterpret_cast< const int32_t* >( buf.data() ), count );
+  }
+}
+
+
+///
+/// text parsing helpers
+///
+
+/// Is this byte space or tab (but not end of line)?
+static inline bool is_blank( char c ) { return c == ' ' || c == '\t'; }
+
+static inline const char * skip_blanks( const char * p, const char * end ) {
+  while( p < end && is_blank( *p ) ) ++p;
+  return p;
+}
+
+/// Are all eight bytes ASCII digits? (SWAR check, from simdjson)
+static inline bool eight_digits( uint64_t chunk ) {
+  return ( ( chunk & 0xF0F0F0F0F0F0F0F0ULL ) |
+           ( ( ( chunk + 0x0606060606060606ULL ) & 0xF0F0F0F0F0F0F0F0ULL ) >> 4 ) ) == 0x3333333333333333ULL;
+}
+
+/// Value of eight ASCII digits (first byte most significant), without a
+/// per-digit loop: combine pairs, then quads, then the two halves.
+static inline uint64_t parse_eight_digits( uint64_t chunk ) {
+  chunk = ( chunk & 0x0F0F0F0F0F0F0F0FULL ) * 2561 >> 8;
+  chunk = ( chunk & 0x00FF00FF00FF00FFULL ) * 6553601 >> 16;
+  return ( ( chunk & 0x0000FFFF0000FFFFULL ) * 42949672960001ULL ) >> 32;
+}
+
+/// Parse a decimal integer at `p`, eight digits at a time where possible.
+/// @return pointer past the integer, or `p` if there was none
+static inline const char * parse_int( const char * p, const char * end, int64_t * out ) {
+  const char * start = p;
+  bool negative = ( p < end && *p == '-' );
+  p += negative;
+  const char * digits = p;
+
+  uint64_t v = 0;
+  while( end - p >= 8 ) {
+    uint64_t chunk;
+    std::memcpy( &chunk, p, sizeof(chunk) );
+    if( !eight_digits( chunk ) ) break;
+    v = v * 100000000 + parse_eight_digits( chunk );
+    p += 8;
+  }
+  while( p < end && static_cast< unsigned >( *p - '0' ) < 10 ) {
+    v = v * 10 + ( *p - '0' );
+    ++p;
+  }
+
+  if( p == digits ) return start;
+  *out = negative ? -static_cast< int64_t >( v ) : static_cast< int64_t >( v );
+  return p;
+}
+
+/// Parse a floating-point value at `p` (copied out so strtod can't run
+/// past the end of the mapping).
+/// @return pointer past the value, or `p` if there was none
+static inline const char * parse_double( const char * p, const char * end, double * out ) {
+  char tmp[64];
+  size_t n = 0;
+  while( p + n < end && n < sizeof(tmp)-1 && !is_blank( p[n] ) && p[n] != '\n' && p[n] != '\r' ) {
+    tmp[n] = p[n];
+    ++n;
+  }
+  tmp[n] = '\0';
+  char * tmp_end;
+  *out = strtod( tmp, &tmp_end );
+  return p + ( tmp_end - tmp );
+}
+
+/// Start of the first line beginning at or after `p` (a line belongs to
+/// the core whose range contains its first byte).
+static inline const char * first_line_at( const char * begin, const char * p, const char * end ) {
+  if( p == begin || p[-1] == '\n' ) return p;
+  const char * nl = static_cast< const char * >( memchr( p, '\n', end - p ) );
+  return nl ? nl + 1 : end;
+}
+
+/// End of the line starting at `p` (pointer to its newline, or `end`).
+static inline const char * line_end( const char * p, const char * end ) {
+  const char * nl = static_cast< const char * >( memchr( p, '\n', end - p ) );
+  return nl ? nl : end;
+}
+
+/// Does this line hold an edge (not blank or a comment)?
+static inline bool is_edge_line( const char * p, const char * eol, char comment ) {
+  p = skip_blanks( p, eol );
+  return p < eol && *p != comment && *p != '\r';
+}
+
+/// An edge parsed on one core that belongs in another core's portion of the edge array.
+struct PlacedEdge {
+  Core dest;
+  int64_t slot;
+  Grappa::TupleGraph::Edge e;
+};
+
+/// Tab-separated "v0 v1 [weight]" edge list loader
 TupleGraph TupleGraph::load_tsv( std::string path ) {
-  // make sure file exists
+  return load_text( path, 0, '#', false );
+}
+
+/// Each core maps the file and parses the lines that begin in its share of
+/// the bytes from `data_start` on. A first pass counts edge lines so the
+/// TupleGraph can be allocated; the second pass parses straight into this
+/// core's local portion of `edges`. Cores that parsed more edges than they
+/// have local slots send the excess to cores with room, in bulk.
+TupleGraph TupleGraph::load_text( std::string path, size_t data_start, char comment, bool integer_data ) {
   CHECK( fs::exists( path ) ) << "File not found.";
   CHECK( fs::is_regular_file( path ) ) << "File is not a regular file.";
 
   size_t file_size = fs::file_size( path );
+  CHECK_LE( data_start, file_size );
 
   size_t path_length = path.size() + 1; // include space for terminator
-
   CHECK_LT( path_length, max_path_length )
     << "Sorry, filename exceeds preset limit. Please change max_path_length constant in this file and rerun.";
 
   char filename[ max_path_length ];
   strncpy( &filename[0], path.c_str(), max_path_length );
 
-  Core mycore = Grappa::mycore();
-  auto bytes_each_core = file_size / Grappa::cores();
+  double start_time = Grappa::walltime();
 
-  // read into temporary buffer
+  // map file and count edge lines in our range
+  static const char * map = nullptr;
+  static const char * range_begin = nullptr;
+  static const char * range_end = nullptr;
   on_all_cores( [=] {
-      // use standard C++/POSIX IO
-
-      // make one core take any data remaining after truncation
-      auto my_bytes_each_core = bytes_each_core;
-      if( Grappa::mycore() == 0 ) {
-        my_bytes_each_core += file_size - (bytes_each_core * Grappa::cores());
-      }
-      
-      // compute initial offset into ASCII file
-      // TODO: fix this with scan
-      local_offset = 0; // do on all cores
-      Grappa::barrier();
-      int64_t start_offset = Grappa::delegate::fetch_and_add( make_global( &local_offset, 0 ),
-                                                              my_bytes_each_core );
-      Grappa::barrier();
-      int64_t end_offset = start_offset + my_bytes_each_core;
-
-      DVLOG(7) << "Reading about " << my_bytes_each_core
-               << " bytes starting at " << start_offset
-               << " of " << file_size;
-      
-      // start reading at start offset
-      std::ifstream infile( filename, std::ios_base::in );
-      infile.seekg( start_offset );
-
-      if( start_offset > 0 ) {
-        // move past next newline so we start parsing from a record boundary
-        std::string s;
-        std::getline( infile, s );
-        DVLOG(6) << "Skipped '" << s << "'";
+      int fd;
+      PCHECK( (fd = open( filename, O_RDONLY )) >= 0 ) << "Could not open " << filename;
+      map = nullptr;
+      if( file_size > 0 ) {
+        void * p = mmap( nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+        PCHECK( p != MAP_FAILED ) << "Could not map " << filename;
+        madvise( p, file_size, MADV_SEQUENTIAL );
+        map = static_cast< const char * >( p );
       }
-      
-      start_offset = infile.tellg();
-      DVLOG(6) << "Start reading at " << start_offset;
-
-      // read up to one entry past the end_offset
-      while( infile.good() && start_offset < end_offset ) {
-        int64_t v0 = -1;
-        int64_t v1 = -1;
-        if( infile.peek() == '#' ) { // if a comment
-          std::string str;
-          std::getline( infile, str );
-        } else {
-          infile >> v0;
-          if( !infile.good() ) break;
-          infile >> v1;
-          Edge e = { v0, v1 };
-          DVLOG(6) << "Read " << v0 << " -> " << v1;
-          read_edges.push_back( e );
-          start_offset = infile.tellg();
-        }
+      PCHECK( close( fd ) >= 0 );
+
+      const char * data = map + data_start;
+      const char * end = map + file_size;
+      size_t data_size = file_size - data_start;
+      range_begin = first_line_at( data, data + data_size * Grappa::mycore() / Grappa::cores(), end );
+      range_end = first_line_at( data, data + data_size * (Grappa::mycore()+1) / Grappa::cores(), end );
+
+      local_offset = 0;
+      for( const char * p = range_begin; p < range_end; ) {
+        const char * eol = line_end( p, end );
+        if( is_edge_line( p, eol, comment ) ) local_offset++;
+        p = eol + 1;
       }
-
-      DVLOG(6) << "Done reading at " << start_offset << " end_offset " << end_offset;
-      
-      // collect sizes
-      local_offset = read_edges.size();
-      DVLOG(7) << "Read " << local_offset << " edges";
     } );
 
   auto nedge = Grappa::reduce<int64_t,collective_add>(&local_offset);
-  
+  LOG(INFO) << "Loading " << nedge << " edges";
   TupleGraph tg( nedge );
   auto edges = tg.edges;
-  //auto leftovers = GlobalVector<int64_t>::create(N);
 
   on_all_cores( [=] {
       Edge * local_ptr = edges.localize();
       Edge * local_end = (edges+nedge).localize();
-      auto local_count = local_end - local_ptr;
-      auto read_count = read_edges.size();
-
-      DVLOG(7) << "local_count " << local_count
-               << " read_count " << read_count;
-      
-      // copy everything in our read buffer that fits locally
-      auto local_max = MIN( local_count, read_count );
-      std::memcpy( local_ptr, &read_edges[0], local_max * sizeof(Edge) );
-      local_offset = local_max;
-      Grappa::barrier();
-
-      // get rid of remaining edges
-      auto mycore = Grappa::mycore();
-      auto likely_consumer = (mycore + 1) % Grappa::cores();
-      while( local_max < read_count ) {
-        Edge e = read_edges[local_max];
-        DVLOG(7) << "Looking for somewhere to place edge " << local_max;
-        
-        int retval = delegate::call( likely_consumer, [=] ()->int {
-            Edge * local_ptr = edges.localize();
-            Edge * local_end = (edges+nedge).localize();
-            auto local_count = local_end - local_ptr;
-
-            DVLOG(7) << "Trying to place edge " << local_max
-                      << " on core " << Grappa::mycore()
-                      << " with local_offset " << local_offset
-                      << " and local_count " << local_count;
-            
-            // do we have space to insert here?
-            if( local_offset < local_count ) {
-              // yes, so do so
-              local_ptr[local_offset] = e;
-              local_offset++;
-
-              if( local_offset < local_count ) {
-                DVLOG(7) << "Succeeded with space available";
-                return 0; // succeeded with more space available
-              } else {
-                DVLOG(7) << "Succeeded with no more space available";
-                return 1; // succeeded with no more space available
-              }
+      int64_t local_count = local_end - local_ptr;
+      int64_t parsed_count = local_offset;
+      const char * end = map + file_size;
+
+      // parse, filling local slots first and keeping any excess
+      std::vector< Edge > excess;
+      int64_t n = 0;
+      local_payload_count = 0;
+      for( const char * p = range_begin; p < range_end; ) {
+        const char * eol = line_end( p, end );
+        if( is_edge_line( p, eol, comment ) ) {
+          Edge e = { -1, -1, 0 };
+          const char * q = skip_blanks( p, eol );
+          q = parse_int( q, eol, &e.v0 );
+          q = skip_blanks( q, eol );
+          const char * r = parse_int( q, eol, &e.v1 );
+          CHECK( r != q ) << "Malformed edge line at byte " << (p - map) << " of " << filename;
+          q = skip_blanks( r, eol );
+          if( q < eol && *q != '\r' ) {
+            if( integer_data ) {
+              int64_t d;
+              r = parse_int( q, eol, &d );
+              std::memcpy( &e.data, &d, sizeof(d) );
             } else {
-              // no, so return nack.
-              DVLOG(7) << "Failed with no more space available";
-              return -1; // did not succeed
+              double d;
+              r = parse_double( q, eol, &d );
+              std::memcpy( &e.data, &d, sizeof(d) );
             }
-          } );
+            if( r != q ) local_payload_count++;
+          }
 
-        // insert succeeded, so move to next edge
-        if( retval >= 0 ) {
-          local_max++;
+          if( n < local_count ) {
+            local_ptr[n] = e;
+          } else {
+            excess.push_back( e );
+          }
+          n++;
         }
+        p = eol + 1;
+      }
+      CHECK_EQ( n, parsed_count ) << "File changed while loading?";
+      tuplegraph_text_bytes_parsed += range_end - range_begin;
+
+      if( map ) {
+        PCHECK( munmap( const_cast< char * >( map ), file_size ) >= 0 );
+      }
+      map = nullptr;
+
+      // find where excess edges go: match surplus cores with cores
+      // that have local slots left over, in core order
+      std::vector< int64_t > parsed( Grappa::cores(), 0 ), slots( Grappa::cores(), 0 );
+      parsed[ Grappa::mycore() ] = parsed_count;
+      slots[ Grappa::mycore() ] = local_count;
+      allreduce_inplace<int64_t,collective_add>( parsed.data(), Grappa::cores() );
+      allreduce_inplace<int64_t,collective_add>( slots.data(), Grappa::cores() );
+
+      int64_t surplus_before = 0;
+      for( Core c = 0; c < Grappa::mycore(); ++c ) {
+        surplus_before += std::max< int64_t >( 0, parsed[c] - slots[c] );
+      }
 
-        // no more space available on target, so move to next core
-        if( local_max < read_count && retval != 0 ) {
-          likely_consumer = (likely_consumer + 1) % Grappa::cores();
-          CHECK_NE( likely_consumer, Grappa::mycore() ) << "No more space to place edge on cluster?";
+      std::vector< PlacedEdge > placed;
+      placed.reserve( excess.size() );
+      int64_t deficit_before = 0;
+      size_t i = 0;
+      for( Core c = 0; c < Grappa::cores() && i < excess.size(); ++c ) {
+        int64_t deficit = std::max< int64_t >( 0, slots[c] - parsed[c] );
+        // overlap of our surplus [surplus_before, +excess) with this core's deficit
+        while( i < excess.size() && surplus_before + (int64_t) i < deficit_before + deficit ) {
+          int64_t k = surplus_before + i - deficit_before;
+          if( k >= 0 ) {
+            placed.push_back( PlacedEdge{ c, parsed[c] + k, excess[i] } );
+            ++i;
+          } else {
+            break;
+          }
         }
+        deficit_before += deficit;
       }
-      
-      // wait for everybody else to fill in our remaining spaces
+      CHECK_EQ( placed.size(), excess.size() );
+      tuplegraph_text_edges_moved += placed.size();
+
+      impl::bulk_apply( placed.data(), placed.size(),
+                        [](const PlacedEdge& pe) { return pe.dest; },
+                        [edges](const PlacedEdge& pe) {
+                          edges.localize()[ pe.slot ] = pe.e;
+                        } );
+
+      // wait for everybody else to fill in our remaining slots
       Grappa::barrier();
-      
-      // discard temporary read buffer
-      read_edges.clear();
     } );
 
+  tg.has_data = Grappa::reduce<int64_t,collective_add>(&local_payload_count) > 0;
+
+  double elapsed = Grappa::walltime() - start_time;
+  tuplegraph_text_parse_time = elapsed;
+  tuplegraph_text_parse_MBps = ( file_size - data_start ) / elapsed / (1L << 20);
+  VLOG(1) << "Parsed " << file_size - data_start << " bytes in " << elapsed << " s ("
+          << tuplegraph_text_parse_MBps.value() << " MB/s)";
+
   // done!
   return tg;
 }
@@ -286,8 +424,6 @@ TupleGraph TupleGraph::load_mm( std::string path ) {
   CHECK( fs::exists( path ) ) << "File not found.";
   CHECK( fs::is_regular_file( path ) ) << "File is not a regular file.";
 
-  size_t file_size = fs::file_size( path );
-
   size_t path_length = path.size() + 1; // include space for terminator
 
   CHECK_LT( path_length, max_path_length )
@@ -373,167 +509,17 @@ TupleGraph TupleGraph::load_mm( std::string path ) {
     }
     
     header_info.header_end_offset = infile.tellg();
-    file_size -= header_info.header_end_offset;
-    DVLOG(7) << "Header ends at " << local_offset;
+    DVLOG(7) << "Header ends at " << header_info.header_end_offset;
   }
 
   DVLOG(7) << "Reading matrix of size " << size_m << "x" << size_n << " with " << size_nonzero << " nonzeros";
 
 
   
-  Core mycore = Grappa::mycore();
-  auto bytes_each_core = file_size / Grappa::cores();
-
-  // read into temporary buffer
-  on_all_cores( [=] {
-      // use standard C++/POSIX IO
-
-      // make one core take any data remaining after truncation
-      auto my_bytes_each_core = bytes_each_core;
-      if( Grappa::mycore() == 0 ) {
-        my_bytes_each_core += file_size - (bytes_each_core * Grappa::cores());
-      }
-      
-      // compute initial offset into ASCII file
-      // TODO: fix this with scan
-      local_offset = header_info.header_end_offset-1; // do on all cores
-      Grappa::barrier();
-      int64_t start_offset = Grappa::delegate::fetch_and_add( make_global( &local_offset, 0 ),
-                                                              my_bytes_each_core );
-      Grappa::barrier();
-      int64_t end_offset = start_offset + my_bytes_each_core;
-
-      DVLOG(7) << "Reading about " << my_bytes_each_core
-               << " bytes starting at " << start_offset
-               << " of " << file_size;
-      
-      // start reading at start offset
-      std::ifstream infile( filename, std::ios_base::in );
-      infile.seekg( start_offset );
-
-      if( start_offset > 0 ) {
-        // move past next newline so we start parsing from a record boundary
-        std::string s;
-        std::getline( infile, s );
-        DVLOG(6) << "Skipped '" << s << "'";
-      }
-      
-      start_offset = infile.tellg();
-      DVLOG(6) << "Start reading at " << start_offset;
-
-      // read up to one entry past the end_offset
-      while( infile.good() && start_offset < end_offset ) {
-        int64_t v0 = -1;
-        int64_t v1 = -1;
-        uint64_t data = 0;
-        if( infile.peek() == '#' ) { // if a comment
-          std::string str;
-          std::getline( infile, str );
-        } else {
-          infile >> v0;
-          if( !infile.good() ) break;
-          infile >> v1;
-          if( header_info.field_double ) {
-            double d;
-            infile >> d;
-            data = *((uint64_t*)&d); // hack. reuse bits for data.
-          } else {
-            int64_t d;
-            infile >> d;
-            data = *((uint64_t*)&d);
-          }
-          Edge e = { v0, v1, data };
-          DVLOG(6) << "Read " << v0 << " -> " << v1 << " with data " << (void*) data;
-          read_edges.push_back( e );
-          start_offset = infile.tellg();
-        }
-      }
-
-      DVLOG(6) << "Done reading at " << start_offset << " end_offset " << end_offset;
-      
-      // collect sizes
-      local_offset = read_edges.size();
-      DVLOG(7) << "Read " << local_offset << " edges";
-    } );
-
-  auto nedge = Grappa::reduce<int64_t,collective_add>(&local_offset);
-  LOG(INFO) << "Loading " << nedge << " edges";
-  TupleGraph tg( nedge );
-  auto edges = tg.edges;
-  //auto leftovers = GlobalVector<int64_t>::create(N);
-
-  on_all_cores( [=] {
-      Edge * local_ptr = edges.localize();
-      Edge * local_end = (edges+nedge).localize();
-      auto local_count = local_end - local_ptr;
-      auto read_count = read_edges.size();
-
-      DVLOG(7) << "local_count " << local_count
-               << " read_count " << read_count;
-      
-      // copy everything in our read buffer that fits locally
-      auto local_max = MIN( local_count, read_count );
-      std::memcpy( local_ptr, &read_edges[0], local_max * sizeof(Edge) );
-      local_offset = local_max;
-      Grappa::barrier();
-
-      // get rid of remaining edges
-      auto mycore = Grappa::mycore();
-      auto likely_consumer = (mycore + 1) % Grappa::cores();
-      while( local_max < read_count ) {
-        Edge e = read_edges[local_max];
-        DVLOG(7) << "Looking for somewhere to place edge " << local_max;
-        
-        int retval = delegate::call( likely_consumer, [=] ()->int {
-            Edge * local_ptr = edges.localize();
-            Edge * local_end = (edges+nedge).localize();
-            auto local_count = local_end - local_ptr;
-
-            DVLOG(7) << "Trying to place edge " << local_max
-                      << " on core " << Grappa::mycore()
-                      << " with local_offset " << local_offset
-                      << " and local_count " << local_count;
-            
-            // do we have space to insert here?
-            if( local_offset < local_count ) {
-              // yes, so do so
-              local_ptr[local_offset] = e;
-              local_offset++;
-
-              if( local_offset < local_count ) {
-                DVLOG(7) << "Succeeded with space available";
-                return 0; // succeeded with more space available
-              } else {
-                DVLOG(7) << "Succeeded with no more space available";
-                return 1; // succeeded with no more space available
-              }
-            } else {
-              // no, so return nack.
-              DVLOG(7) << "Failed with no more space available";
-              return -1; // did not succeed
-            }
-          } );
-
-        // insert succeeded, so move to next edge
-        if( retval >= 0 ) {
-          local_max++;
-        }
-
-        // no more space available on target, so move to next core
-        if( local_max < read_count && retval != 0 ) {
-          likely_consumer = (likely_consumer + 1) % Grappa::cores();
-          CHECK_NE( likely_consumer, Grappa::mycore() ) << "No more space to place edge on cluster?";
-        }
-      }
-      
-      // wait for everybody else to fill in our remaining spaces
-      Grappa::barrier();
-      
-      // discard temporary read buffer
-      read_edges.clear();
-    } );
-
-  // done!
+  TupleGraph tg = load_text( path, header_info.header_end_offset, '%', !header_info.field_double );
+  if( size_nonzero > 0 && tg.nedge != static_cast< int64_t >( size_nonzero ) ) {
+    LOG(WARNING) << "Header says " << size_nonzero << " nonzeros, but read " << tg.nedge;
+  }
   return tg;
 }
 
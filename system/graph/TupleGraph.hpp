@@ -25,6 +25,8 @@
 
 #include <Addressing.hpp>
 #include <GlobalAllocator.hpp>
+#include <cstring>
+#include <functional>
 
 namespace Grappa {
 
@@ -33,7 +35,10 @@ namespace Grappa {
     struct Edge {
       int64_t v0;
       int64_t v1;
-      uint64_t data;
+      uint64_t data; ///< optional payload (see has_data)
+
+      /// Payload as a floating-point weight (how the tsv and real-valued mm loaders store it).
+      double weight() const { double d; std::memcpy( &d, &data, sizeof(d) ); return d; }
     };
 
   private:
@@ -44,10 +49,18 @@ namespace Grappa {
     
     static TupleGraph load_tsv( std::string path );
     static TupleGraph load_mm( std::string path );
+
+    /// Parallel parser for text edge lists ("v0 v1 [value]" per line),
+    /// starting at byte `data_start`; lines starting with `comment` are skipped.
+    static TupleGraph load_text( std::string path, size_t data_start, char comment, bool integer_data );
     
   public:
     GlobalAddress<Edge> edges;
     int64_t nedge; /* Number of edges in graph, in both cases */
+
+    /// Do edges carry a payload in Edge::data? (Set by loaders for formats
+    /// with a weight/value column; otherwise `data` should be ignored.)
+    bool has_data;
   
     /// Use Graph500 Kronecker generator (@see graph/KroneckerGenerator.cpp)
     static TupleGraph Kronecker(int scale, int64_t desired_nedge, 
@@ -56,6 +69,13 @@ namespace Grappa {
     // create new TupleGraph with edges loaded from file
     static TupleGraph Load( std::string path, std::string format );
 
+    /// Visit this core's contiguous share of the edges in a bintsv4 file,
+    /// without building a TupleGraph, in pieces of at most `chunk` edges, so
+    /// the whole share is never held in memory at once. `f` gets (v0,v1)
+    /// int32 pairs and may yield.
+    static void scan_local_bintsv4( const char * filename, int64_t chunk,
+                                    std::function< void( const int32_t * pairs, int64_t n ) > f );
+
      void destroy() { global_free(edges); }
 
     // default contstructor
@@ -63,9 +83,10 @@ namespace Grappa {
       : initialized( false )
       , edges( )
       , nedge(0)
+      , has_data(false)
     { }
 
-    TupleGraph(const TupleGraph& tg): initialized(false), edges(tg.edges), nedge(tg.nedge) { }
+    TupleGraph(const TupleGraph& tg): initialized(false), edges(tg.edges), nedge(tg.nedge), has_data(tg.has_data) { }
 
     TupleGraph& operator=(const TupleGraph& tg) {
       if( initialized ) {
@@ -73,13 +94,14 @@ namespace Grappa {
       }
       edges = tg.edges;
       nedge = tg.nedge;
+      has_data = tg.has_data;
       return *this;
     }
 
     void save( std::string path, std::string format );
 
   protected:
-    TupleGraph(int64_t nedge): initialized(true), edges(global_alloc<Edge>(nedge)), nedge(nedge) {}
+    TupleGraph(int64_t nedge): initialized(true), edges(global_alloc<Edge>(nedge)), nedge(nedge), has_data(false) {}
     
   };
 
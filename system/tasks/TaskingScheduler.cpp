@@ -33,6 +33,10 @@ DEFINE_bool(poll_on_idle, true, "have tasking layer poll aggregator if it has no
 
 DEFINE_uint64( readyq_prefetch_distance, 4, "How far ahead in the ready queue to prefetch contexts" );
 
+DEFINE_uint64( max_workers, 4096, "Most workers per core the scheduler may grow to when all workers are blocked and tasks are waiting (no growth if not above num_starting_workers)" );
+DEFINE_uint64( worker_grow_batch, 64, "Number of workers added at a time when growing the worker pool" );
+DECLARE_uint64( num_starting_workers );
+
 GRAPPA_DEFINE_METRIC( SimpleMetric<uint64_t>, scheduler_context_switches, 0 );
 GRAPPA_DEFINE_METRIC( SimpleMetric<uint64_t>, scheduler_count, 0);
 GRAPPA_DEFINE_METRIC( SimpleMetric<uint64_t>, scheduler_samples, 0);
@@ -48,6 +52,14 @@ GRAPPA_DEFINE_METRIC( SimpleMetric<uint64_t>, scheduler_ready_thread_ticks, 0);
 GRAPPA_DEFINE_METRIC( SimpleMetric<uint64_t>, scheduler_idle_thread_ticks, 0);
 GRAPPA_DEFINE_METRIC( SimpleMetric<uint64_t>, scheduler_idle_useful_thread_ticks, 0);
 
+// worker pool size
+static int64_t scheduler_worker_count() { return Grappa::impl::global_scheduler.worker_count(); }
+GRAPPA_DEFINE_METRIC( CallbackMetric<int64_t>, scheduler_workers, &scheduler_worker_count );
+GRAPPA_DEFINE_METRIC( MaxMetric<uint64_t>, scheduler_workers_peak, 0);
+GRAPPA_DEFINE_METRIC( SimpleMetric<uint64_t>, scheduler_workers_grown, 0);
+GRAPPA_DEFINE_METRIC( SimpleMetric<uint64_t>, scheduler_workers_retired, 0);
+GRAPPA_DEFINE_METRIC( SimpleMetric<uint64_t>, scheduler_worker_growth_failures, 0);
+
 
 namespace Grappa {
 
@@ -69,6 +81,7 @@ TaskingScheduler global_scheduler;
   , num_active_tasks( 0 )
   , task_manager ( NULL )
   , num_workers ( 0 )
+  , worker_growth_exhausted ( false )
   , work_args( NULL )
   , previous_periodic_ts( 0 ) 
   , in_no_switch_region_( false )
@@ -94,7 +107,10 @@ void TaskingScheduler::init ( Worker * master_arg, TaskManager * taskman ) {
 void TaskingScheduler::run ( ) {
   StateTimer::setThreadState( StateTimer::SCHEDULER );
   StateTimer::enterState_scheduler();
-  while (thread_wait( NULL ) != NULL) { } // nothing
+  Worker * died;
+  while ((died = thread_wait( NULL )) != NULL) {
+    destroy_thread( died ); // return its stack to the pool
+  }
 }
 
 /// Schedule Threads from the scheduler until one e
@@ -174,6 +190,8 @@ void workerLoop ( Worker * me, void* args ) {
     StateTimer::setThreadState( StateTimer::FINDWORK );
     sched->num_active_tasks--;
 
+    if (sched->maybeRetireWorker()) break; // pool has grown more than needed
+
     sched->thread_yield( ); // yield to the scheduler
   }
 }
@@ -182,32 +200,67 @@ void workerLoop ( Worker * me, void* args ) {
 /// create worker Threads for executing Tasks
 ///
 /// @param num how many workers to create
-void TaskingScheduler::createWorkers( uint64_t num ) {
-  num_workers += num;
+/// @param may_fail stop early instead of failing if there is no memory
+///                 left for another worker's stack
+/// @return how many workers were created
+uint64_t TaskingScheduler::createWorkers( uint64_t num, bool may_fail ) {
   VLOG(5) << "spawning " << num << " workers; now there are " << num_workers;
-  for (uint64_t i=0; i<num; i++) {
+  uint64_t created = 0;
+  for (; created<num; created++) {
     // spawn a new worker Worker
-    Worker * t = impl::worker_spawn( current_thread, this, workerLoop, work_args);
+    Worker * t = impl::worker_spawn( current_thread, this, workerLoop, work_args, may_fail );
+    if (t == NULL) break;
 
     // place the Worker in the pool of idle workers
     unassigned( t );
   }
-  num_idle += num;
+  num_workers += created;
+  num_idle += created;
+  scheduler_workers_peak.add( num_workers );
+  return created;
 }
 
-#define BASIC_MAX_WORKERS 2
-/// Give the scheduler a chance to spawn more worker Threads,
-/// based on some heuristics.
+/// Give the scheduler a chance to spawn more worker Threads.
+///
+/// Called when a Task is waiting but no idle worker is left. Since the ready
+/// queue is empty too, every worker is blocked (typically on remote
+/// operations), so grow the pool by '--worker_grow_batch' workers, up to
+/// '--max_workers'. Growth is best-effort: if locale shared memory has no
+/// room for more stacks, we keep the workers we have (and the Task keeps
+/// waiting), and don't try again until a worker retires.
 Worker * TaskingScheduler::maybeSpawnCoroutines( ) {
-  // currently only spawn a worker if there are less than some threshold
-  if ( num_workers < BASIC_MAX_WORKERS ) {
-    num_workers += 1;
-    VLOG(5) << "spawning another worker; now there are " << num_workers;
-    return impl::worker_spawn( current_thread, this, workerLoop, work_args ); // current Worker will be coro parent; is this okay?
-  } else {
-    // might have another way to spawn
-    return NULL;
+  if ( num_workers >= FLAGS_max_workers || worker_growth_exhausted ) return NULL;
+
+  uint64_t num = std::min( FLAGS_worker_grow_batch, FLAGS_max_workers - num_workers );
+  bool all_allowed = (max_allowed_active_workers == num_workers);
+  VLOG(3) << "all " << num_workers << " workers blocked with tasks waiting; adding " << num;
+  uint64_t created = createWorkers( num, true ); // current Worker will be coro parent
+  if ( all_allowed ) max_allowed_active_workers = num_workers;
+  scheduler_workers_grown += created;
+
+  if ( created < num ) {
+    VLOG(2) << "out of memory for worker stacks; worker pool stays at " << num_workers;
+    scheduler_worker_growth_failures++;
+    worker_growth_exhausted = true;
   }
+
+  return unassignedQ.dequeue();
+}
+
+/// Called by a worker between Tasks: if the pool has grown beyond
+/// '--num_starting_workers' and more than two growth batches worth of workers
+/// are idle, retire the calling worker (its stack goes back to the pool).
+///
+/// @return true if the calling worker should exit
+bool TaskingScheduler::maybeRetireWorker( ) {
+  if ( num_workers <= FLAGS_num_starting_workers ||
+       num_idle <= 2 * FLAGS_worker_grow_batch ) return false;
+
+  if ( max_allowed_active_workers == num_workers ) max_allowed_active_workers--;
+  num_workers--;
+  scheduler_workers_retired++;
+  worker_growth_exhausted = false; // its stack can be reused
+  return true;
 }
 
 /// Callback for when a worker Worker is run for the first time.
@@ -111,6 +111,9 @@ class TaskingScheduler : public Scheduler {
     /// total number of worker Threads
     uint64_t num_workers;
 
+    /// set when growing the worker pool ran out of memory for stacks
+    bool worker_growth_exhausted;
+
     /// Return an idle worker Worker
     Worker * getWorker ();
 
@@ -172,6 +175,11 @@ class TaskingScheduler : public Scheduler {
 #endif
         }
 
+        // maybe record a time-series sample
+        if( current_ts >= Grappa::impl::next_series_ts ) {
+          Grappa::impl::sample_series( current_ts );
+        }
+
         // if( ( global_communicator.mycore == 0 ) &&
         //     ( current_ts - prev_stats_blob_ts > FLAGS_stats_blob_ticks ) &&
         //     FLAGS_stats_blob_enable &&
@@ -346,14 +354,20 @@ class TaskingScheduler : public Scheduler {
       thr->id = nextId++;
     }
 
-    void createWorkers( uint64_t num );
+    uint64_t createWorkers( uint64_t num, bool may_fail = false );
     Worker* maybeSpawnCoroutines( );
     void onWorkerStart( );
+    bool maybeRetireWorker( );
 
     uint64_t active_task_count() {
       return num_active_tasks;
     }
 
+    /// current size of the worker pool
+    uint64_t worker_count() const {
+      return num_workers;
+    }
+
     /// Mark the Worker as an idle worker
     void unassigned( Worker * thr ) {
       unassignedQ.enqueue( thr );
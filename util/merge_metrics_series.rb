@@ -0,0 +1,66 @@
+#!/usr/bin/env ruby
+# Merge per-core metric time-series files (written with --metrics_series_enable)
+# into one CSV on stdout.
+#
+# usage: merge_metrics_series.rb [--bin SECONDS] metrics.*.series
+#
+# Without --bin, emits one row per core per sample:
+#   time,core,<metric>,...
+# where time is seconds since the earliest core started.
+# With --bin, samples are grouped into SECONDS-wide bins and each metric is
+# summed over cores (using each core's last sample in the bin):
+#   time,cores,<metric>,...
+require 'optparse'
+
+bin = nil
+OptionParser.new do |opts|
+  opts.banner = "usage: #{$0} [--bin SECONDS] FILES..."
+  opts.on("--bin SECONDS", Float, "sum over cores in bins of SECONDS") { |s| bin = s }
+end.parse!
+
+abort "no input files" if ARGV.empty?
+
+series = ARGV.map do |path|
+  File.open(path, "rb") do |f|
+    magic = f.read(8)
+    abort "#{path}: not a metrics series file" unless magic == "GRPSER1\0"
+    core, cores, nmetrics, _ = f.read(16).unpack("l<4")
+    start = f.read(8).unpack("E").first
+    names = nmetrics.times.map { f.gets("\0").chomp("\0") }
+    record = 8 * (1 + nmetrics)
+    rows = []
+    while (buf = f.read(record)) && buf.bytesize == record
+      rows << buf.unpack("E*")
+    end
+    { core: core, start: start, names: names, rows: rows }
+  end
+end
+
+names = series.first[:names]
+series.each do |s|
+  abort "core #{s[:core]} sampled different metrics" unless s[:names] == names
+end
+t0 = series.map { |s| s[:start] }.min
+
+if bin.nil?
+  puts (["time", "core"] + names).join(",")
+  rows = series.flat_map do |s|
+    s[:rows].map { |r| [s[:start] - t0 + r[0], s[:core]] + r[1..-1] }
+  end
+  rows.sort_by { |r| [r[0], r[1]] }.each { |r| puts r.join(",") }
+else
+  # last sample of each core in each bin
+  bins = Hash.new { |h, k| h[k] = {} }
+  series.each do |s|
+    s[:rows].each do |r|
+      b = ((s[:start] - t0 + r[0]) / bin).floor
+      bins[b][s[:core]] = r[1..-1]
+    end
+  end
+  puts (["time", "cores"] + names).join(",")
+  bins.keys.sort.each do |b|
+    per_core = bins[b].values
+    sums = per_core.transpose.map { |vs| vs.inject(:+) }
+    puts ([b * bin, per_core.size] + sums).join(",")
+  end
+end